@@ -0,0 +1,79 @@
+/**
+ * @file fft.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an fft that runs inside of the process.
+ */
+
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "fft.h"
+
+/**
+ * Reorders the values so that every value is at its bit reversed index.
+ * @details After this the even and odd halves of every stage lie next to each
+ * other, like the results the two children return in the fork mode.
+ * @param values the values to reorder.
+ * @param n how many values there are, a power of two.
+ */
+static void fft_bit_reverse(float complex *values, int n) {
+  for (int i = 1, j = 0; i < n; i++) {
+    int bit = n >> 1;
+    for (; (j & bit) != 0; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j) {
+      float complex swap = values[i];
+      values[i] = values[j];
+      values[j] = swap;
+    }
+  }
+}
+
+int fft_inproc(complex_number_list_t *list) {
+  float complex *values = list->values;
+  int n = list->num;
+
+  if (n < 2) {
+    return 0;
+  }
+
+  // the stage of length m needs the factors of the angles -2*pi*k/m, which
+  // are the factors of n at every (n/m)th index
+  float complex *twiddles =
+      (float complex *)malloc((n / 2) * sizeof(float complex));
+  if (twiddles == NULL) {
+    return -1;
+  }
+
+  for (int k = 0; k < n / 2; k++) {
+    double angle = -(2.0 * M_PI) / (double)n * (double)k;
+    twiddles[k] = (float)cos(angle) + I * (float)sin(angle);
+  }
+
+  fft_bit_reverse(values, n);
+
+  for (int m = 2; m <= n; m *= 2) {
+    int half = m / 2;
+    int stride = n / m;
+
+    for (int start = 0; start < n; start += m) {
+      for (int k = 0; k < half; k++) {
+        float complex re = values[start + k];
+        float complex ro = twiddles[k * stride] * values[start + k + half];
+
+        values[start + k] = re + ro;
+        values[start + k + half] = re - ro;
+      }
+    }
+  }
+
+  free(twiddles);
+
+  return 0;
+}
@@ -0,0 +1,28 @@
+/**
+ * @file fft.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an fft that runs inside of the process.
+ *
+ * The fft module. It transforms a list in place, without forking a process
+ * per recursion level.
+ */
+
+#ifndef _FFT /* prevent multiple inclusion */
+#define _FFT
+
+#include "complex_number_list.h"
+
+/**
+ * Transforms the values of the list in place.
+ * @brief Iterative radix-2 Cooley-Tukey fft. The values are reordered by the
+ * bit reversed index first, then the butterflies of every stage combine the
+ * halves like the parent process of the fork mode does. The twiddle factors
+ * are computed once in double precision for the whole list.
+ * @param list the list, its length must be a power of two.
+ * @return Returns 0 if non error has been encountered
+ */
+int fft_inproc(complex_number_list_t *list);
+
+#endif /* _FFT */
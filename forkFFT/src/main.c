@@ -21,6 +21,7 @@
 #include "child.h"
 #include "complex_helper.h"
 #include "complex_number_list.h"
+#include "fft.h"
 #include "parser.h"
 
 /*! \def PI
@@ -30,8 +31,8 @@
 */
 #define PI 3.141592654f
 
-const char *USAGE =
-    "SYNOPSIS\n\tforkFFT [-p]"; /**< Usage message for this program */
+/** Usage message for this program */
+const char *USAGE = "SYNOPSIS\n\tforkFFT [-p] [-m fork|inproc]";
 
 /**
  * Program entry point.
@@ -44,11 +45,23 @@ const char *USAGE =
 int main(int argc, char **argv) {
   int opt;
   bool precise_flag = false;
-  while ((opt = getopt(argc, argv, "p")) != -1) {
+  // the children are started without '-m', so they always fork further
+  bool inproc_flag = false;
+  while ((opt = getopt(argc, argv, "pm:")) != -1) {
     switch (opt) {
     case 'p':
       precise_flag = true;
       break;
+    case 'm':
+      if (strcmp(optarg, "inproc") == 0) {
+        inproc_flag = true;
+      } else if (strcmp(optarg, "fork") == 0) {
+        inproc_flag = false;
+      } else {
+        printf("%s\n", USAGE);
+        return EXIT_FAILURE;
+      }
+      break;
     default:
       printf("%s\n", USAGE);
       return EXIT_FAILURE;
@@ -130,6 +143,23 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  if (inproc_flag) {
+    if (fft_inproc(&complex_list) != 0) {
+      cnl_free(&complex_list);
+
+      return EXIT_FAILURE;
+    }
+
+    for (int i = 0; i < n; ++i) {
+      ch_print_complex_number(cnl_get_at_index(&complex_list, i));
+      printf("\n");
+    }
+
+    cnl_free(&complex_list);
+
+    return EXIT_SUCCESS;
+  }
+
   int parent_to_child_odd[2], child_odd_to_parent[2], parent_to_child_even[2],
       child_even_to_parent[2];
 
@@ -0,0 +1,359 @@
+/**
+ * @file bench.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Runs mygrep on the corpus in every search mode and reports the
+ * latency percentiles and the throughput as JSON.
+ *
+ * @details Every case is run once to warm the page cache and then measured
+ * for the given number of runs. The time of a run is the wall time from
+ * 'fork' to 'waitpid', so it includes starting the process. The output of
+ * mygrep is thrown away. A streamed case gets the input through a pipe that
+ * a second child fills, so mygrep can't map it.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * How often every case is measured if no count is given.
+ */
+#define BENCH_DEFAULT_RUNS 5
+
+/**
+ * Upper bound for the '-r' option.
+ */
+#define BENCH_MAX_RUNS 10000
+
+/**
+ * How many arguments a case passes to mygrep at most.
+ */
+#define BENCH_MAX_ARGS 8
+
+/**
+ * Length of the longest path of an input.
+ */
+#define BENCH_MAX_PATH 4096
+
+/**
+ * Size of the buffer the pipe of a streamed case is filled from.
+ */
+#define BENCH_PIPE_BUFFER (64 * 1024)
+
+/** Usage message for this program */
+static const char *USAGE =
+    "SYNOPSIS\n"
+    "\tbench [-r runs] [-o results.json] mygrep corpusdir\n";
+
+/**
+ * @brief A single benchmark.
+ */
+typedef struct bench_case {
+  const char *name;                 ///< name of the case in the results
+  const char *input;                ///< file of the corpus that is searched
+  bool streamed;                    ///< 'true' if the input comes via a pipe
+  const char *args[BENCH_MAX_ARGS]; ///< arguments before the input, NULL
+                                    ///< terminated
+} bench_case_t;
+
+/**
+ * The cases, the densities of the keywords are described in corpus.c.
+ */
+static const bench_case_t BENCH_CASES[] = {
+    {"mmap_rare", "logs.txt", false, {"-c", "FATAL", NULL}},
+    {"mmap_medium", "logs.txt", false, {"-c", "ERROR", NULL}},
+    {"mmap_dense", "logs.txt", false, {"-c", "INFO", NULL}},
+    {"mmap_lines", "logs.txt", false, {"-n", "WARN", NULL}},
+    {"stream_medium", "logs.txt", true, {"-c", "ERROR", NULL}},
+    {"parallel_medium", "logs.txt", false, {"-j", "4", "-c", "ERROR", NULL}},
+    {"ignore_case_medium", "logs.txt", false, {"-i", "-c", "error", NULL}},
+    {"multi_pattern",
+     "logs.txt",
+     false,
+     {"-c", "-e", "FATAL", "-e", "timeout", "-e", "user=4242", NULL}},
+    {"regex", "logs.txt", false, {"-E", "-c", "ERROR.*retry", NULL}},
+    {"long_lines", "long.txt", false, {"-c", "NEEDLE", NULL}},
+    {"long_lines_stream", "long.txt", true, {"-c", "NEEDLE", NULL}},
+};
+
+/**
+ * Number of cases in BENCH_CASES.
+ */
+#define BENCH_CASES_NUM (sizeof(BENCH_CASES) / sizeof(BENCH_CASES[0]))
+
+/**
+ * Returns the time of a monotonic clock in nanoseconds.
+ */
+static long long bench_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/**
+ * Copies a file into a pipe, runs in a child of its own.
+ * @return Returns EXIT_SUCCESS once the whole file has been written.
+ */
+static int bench_feed(const char *path, int fd) {
+  int input = open(path, O_RDONLY);
+  if (input == -1) {
+    return EXIT_FAILURE;
+  }
+
+  char buffer[BENCH_PIPE_BUFFER];
+  ssize_t len;
+  while ((len = read(input, buffer, sizeof(buffer))) > 0) {
+    for (ssize_t done = 0; done < len;) {
+      ssize_t written = write(fd, buffer + done, len - done);
+      if (written == -1) {
+        // mygrep may stop reading early, that is no error
+        return errno == EPIPE ? EXIT_SUCCESS : EXIT_FAILURE;
+      }
+      done += written;
+    }
+  }
+
+  return len == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * Runs mygrep once for a case.
+ * @param mygrep path of the executable
+ * @param bench_case the case to run
+ * @param path path of the input
+ * @param ns where to store the wall time of the run
+ * @return Returns 0 if mygrep has exited with EXIT_SUCCESS.
+ */
+static int bench_run(const char *mygrep, const bench_case_t *bench_case,
+                     const char *path, long long *ns) {
+  const char *argv[BENCH_MAX_ARGS + 3];
+  int argc = 0;
+
+  argv[argc++] = mygrep;
+  for (int i = 0; bench_case->args[i] != NULL; i += 1) {
+    argv[argc++] = bench_case->args[i];
+  }
+  if (bench_case->streamed == false) {
+    argv[argc++] = path;
+  }
+  argv[argc] = NULL;
+
+  int fds[2] = {-1, -1};
+  if (bench_case->streamed && pipe(fds) == -1) {
+    return -1;
+  }
+
+  long long started = bench_now();
+
+  pid_t feeder = -1;
+  if (bench_case->streamed) {
+    feeder = fork();
+    if (feeder == -1) {
+      close(fds[0]);
+      close(fds[1]);
+      return -1;
+    }
+    if (feeder == 0) {
+      signal(SIGPIPE, SIG_IGN);
+      close(fds[0]);
+      // '_exit', so the child doesn't flush the buffered results a second time
+      _exit(bench_feed(path, fds[1]));
+    }
+    close(fds[1]);
+  }
+
+  pid_t child = fork();
+  if (child == 0) {
+    int null = open("/dev/null", O_WRONLY);
+    if (null == -1 || dup2(null, STDOUT_FILENO) == -1 ||
+        (bench_case->streamed && dup2(fds[0], STDIN_FILENO) == -1)) {
+      _exit(EXIT_FAILURE);
+    }
+    execv(mygrep, (char *const *)argv);
+    _exit(EXIT_FAILURE);
+  }
+
+  if (bench_case->streamed) {
+    close(fds[0]);
+  }
+
+  int result = 0;
+  int status;
+  if (child == -1 || waitpid(child, &status, 0) == -1 ||
+      WIFEXITED(status) == false || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    result = -1;
+  }
+  if (feeder != -1 && (waitpid(feeder, &status, 0) == -1 ||
+                       WIFEXITED(status) == false ||
+                       WEXITSTATUS(status) != EXIT_SUCCESS)) {
+    result = -1;
+  }
+
+  *ns = bench_now() - started;
+
+  return result;
+}
+
+/**
+ * Compares two times for 'qsort'.
+ */
+static int bench_compare(const void *a, const void *b) {
+  long long x = *(const long long *)a;
+  long long y = *(const long long *)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * Returns a percentile of sorted times by the nearest rank.
+ */
+static long long bench_percentile(const long long *sorted, int num,
+                                  int percent) {
+  int rank = (percent * num + 99) / 100;
+
+  return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+/**
+ * Measures a case and prints its results.
+ * @param out where the JSON is written to
+ * @param first 'true' if this is the first case
+ * @return Returns 0 if non error has been encountered.
+ */
+static int bench_case(FILE *out, bool first, const char *mygrep,
+                      const char *dir, const bench_case_t *bench_case,
+                      int runs, long long *times) {
+  char path[BENCH_MAX_PATH];
+  if (snprintf(path, sizeof(path), "%s/%s", dir, bench_case->input) >=
+      (int)sizeof(path)) {
+    return -1;
+  }
+
+  struct stat input_stat;
+  if (stat(path, &input_stat) == -1) {
+    return -1;
+  }
+
+  long long ns;
+  // the warm up run reads the input into the page cache
+  if (bench_run(mygrep, bench_case, path, &ns) != 0) {
+    return -1;
+  }
+
+  long long total = 0;
+  for (int i = 0; i < runs; i += 1) {
+    if (bench_run(mygrep, bench_case, path, &times[i]) != 0) {
+      return -1;
+    }
+    total += times[i];
+  }
+  qsort(times, runs, sizeof(long long), bench_compare);
+
+  long long median = bench_percentile(times, runs, 50);
+
+  fprintf(out, "%s\n  {\"name\": \"%s\", \"input\": \"%s\", \"args\": \"",
+          first ? "" : ",", bench_case->name, bench_case->input);
+  for (int i = 0; bench_case->args[i] != NULL; i += 1) {
+    fprintf(out, "%s%s", i == 0 ? "" : " ", bench_case->args[i]);
+  }
+  fprintf(out,
+          "\", \"streamed\": %s, \"bytes\": %lld, \"runs\": %d, "
+          "\"min_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+          "\"p99_ms\": %.3f, \"max_ms\": %.3f, \"mean_ms\": %.3f, "
+          "\"gb_per_s\": %.3f}",
+          bench_case->streamed ? "true" : "false",
+          (long long)input_stat.st_size, runs, times[0] / 1e6, median / 1e6,
+          bench_percentile(times, runs, 90) / 1e6,
+          bench_percentile(times, runs, 99) / 1e6, times[runs - 1] / 1e6,
+          total / 1e6 / runs,
+          median > 0 ? (double)input_stat.st_size / (double)median : 0.0);
+
+  return 0;
+}
+
+/**
+ * Program entry point.
+ * @param argc The argument counter.
+ * @param argv The argument vector.
+ * @return Returns EXIT_SUCCESS if every case has been measured.
+ */
+int main(int argc, char **argv) {
+  const char *output = NULL;
+  long runs = BENCH_DEFAULT_RUNS;
+  char *end;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "r:o:")) != -1) {
+    switch (opt) {
+    case 'r':
+      errno = 0;
+      runs = strtol(optarg, &end, 10);
+      if (errno != 0 || *end != '\0' || end == optarg || runs < 1 ||
+          runs > BENCH_MAX_RUNS) {
+        fprintf(stderr, "%s\n%s", argv[0], USAGE);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    default:
+      fprintf(stderr, "%s\n%s", argv[0], USAGE);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 2) {
+    fprintf(stderr, "%s\n%s", argv[0], USAGE);
+    return EXIT_FAILURE;
+  }
+  const char *mygrep = argv[optind];
+  const char *dir = argv[optind + 1];
+
+  FILE *out = output == NULL ? stdout : fopen(output, "w");
+  if (out == NULL) {
+    fprintf(stderr, "%s\nError while trying to open %s.\n", argv[0], output);
+    return EXIT_FAILURE;
+  }
+
+  long long *times = malloc(runs * sizeof(long long));
+  if (times == NULL) {
+    fprintf(stderr, "%s\nError while trying to allocate memory.\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  int result = EXIT_SUCCESS;
+  fprintf(out, "{\"runs\": %ld, \"cases\": [", runs);
+
+  for (size_t i = 0; i < BENCH_CASES_NUM; i += 1) {
+    if (bench_case(out, i == 0, mygrep, dir, &BENCH_CASES[i], (int)runs,
+                   times) != 0) {
+      fprintf(stderr, "%s\nError while trying to run %s.\n", argv[0],
+              BENCH_CASES[i].name);
+      result = EXIT_FAILURE;
+      break;
+    }
+  }
+
+  fprintf(out, "]}\n");
+
+  free(times);
+  if (out != stdout && fclose(out) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  return result;
+}
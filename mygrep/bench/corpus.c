@@ -0,0 +1,262 @@
+/**
+ * @file corpus.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Generates the synthetic corpus the benchmarks search.
+ *
+ * @details The corpus only depends on the seed and the size, so results of
+ * different builds can be compared. It consists of
+ *  - logs.txt: log lines whose levels have different densities, 'INFO' is in
+ *    most lines, 'WARN' in every 8th, 'ERROR' in every 64th and 'FATAL' in
+ *    every 4096th line
+ *  - long.txt: lines of 64 KiB up to 1 MiB, every 16th contains 'NEEDLE'
+ */
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * Size of logs.txt if none is given, long.txt gets a quarter of it.
+ */
+#define CORPUS_DEFAULT_SIZE (64L * 1024 * 1024)
+
+/**
+ * Length of the longest path the corpus is written to.
+ */
+#define CORPUS_MAX_PATH 4096
+
+/**
+ * Shortest and longest line of long.txt.
+ */
+#define CORPUS_LONG_MIN (64 * 1024)
+#define CORPUS_LONG_MAX (1024 * 1024)
+
+/** Usage message for this program */
+static const char *USAGE =
+    "SYNOPSIS\n"
+    "\tcorpus [-s seed] [-b bytes] dir\n";
+
+/**
+ * Words the messages are made of.
+ */
+static const char *const CORPUS_WORDS[] = {
+    "request", "response", "user",    "session", "timeout", "connection",
+    "cache",   "miss",     "hit",     "query",   "latency", "retry",
+    "handler", "worker",   "started", "stopped", "payload", "token",
+    "failed",  "accepted", "closed",  "opened",  "upstream", "backend"};
+
+/**
+ * Number of words in CORPUS_WORDS.
+ */
+#define CORPUS_WORDS_NUM (sizeof(CORPUS_WORDS) / sizeof(CORPUS_WORDS[0]))
+
+/**
+ * State of the xorshift generator, the same seed always gives the same
+ * corpus, no matter which libc 'rand' comes from.
+ */
+static uint64_t corpus_state;
+
+/**
+ * Returns the next pseudo random number.
+ */
+static uint64_t corpus_next(void) {
+  corpus_state ^= corpus_state << 13;
+  corpus_state ^= corpus_state >> 7;
+  corpus_state ^= corpus_state << 17;
+
+  return corpus_state;
+}
+
+/**
+ * Returns a pseudo random number below bound.
+ */
+static unsigned long corpus_below(unsigned long bound) {
+  return (unsigned long)(corpus_next() % bound);
+}
+
+/**
+ * Picks the level of a log line by the densities described above.
+ */
+static const char *corpus_level(unsigned long line) {
+  if (line % 4096 == 4095) {
+    return "FATAL";
+  }
+  if (line % 64 == 63) {
+    return "ERROR";
+  }
+  if (line % 8 == 7) {
+    return "WARN";
+  }
+  return corpus_below(16) == 0 ? "DEBUG" : "INFO";
+}
+
+/**
+ * Writes log lines until the file has at least size bytes.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int corpus_write_logs(FILE *out, long size) {
+  long written = 0;
+
+  for (unsigned long line = 0; written < size; line += 1) {
+    int len = fprintf(out,
+                      "2026-10-17T%02lu:%02lu:%02lu.%03luZ host-%02lu "
+                      "service[%lu]: %s",
+                      (line / 3600000) % 24, (line / 60000) % 60,
+                      (line / 1000) % 60, line % 1000, corpus_below(32),
+                      1000 + corpus_below(9000), corpus_level(line));
+    if (len < 0) {
+      return -1;
+    }
+    written += len;
+
+    unsigned long words = 4 + corpus_below(12);
+    for (unsigned long i = 0; i < words; i += 1) {
+      const char *word = CORPUS_WORDS[corpus_below(CORPUS_WORDS_NUM)];
+      if (fprintf(out, " %s", word) < 0) {
+        return -1;
+      }
+      written += 1 + strlen(word);
+    }
+
+    len = fprintf(out, " user=%lu ms=%lu\n", corpus_below(100000),
+                  corpus_below(5000));
+    if (len < 0) {
+      return -1;
+    }
+    written += len;
+  }
+
+  return 0;
+}
+
+/**
+ * Writes long lines until the file has at least size bytes.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int corpus_write_long(FILE *out, long size) {
+  long written = 0;
+
+  for (unsigned long line = 0; written < size; line += 1) {
+    long len = CORPUS_LONG_MIN +
+               (long)corpus_below(CORPUS_LONG_MAX - CORPUS_LONG_MIN);
+    // the needle sits somewhere in the line, not at its start
+    long needle = line % 16 == 15 ? (long)corpus_below(len) : -1;
+    long line_len = 0;
+
+    while (line_len < len) {
+      if (needle >= 0 && line_len >= needle) {
+        if (fputs(" NEEDLE", out) == EOF) {
+          return -1;
+        }
+        line_len += 7;
+        needle = -1;
+      }
+
+      const char *word = CORPUS_WORDS[corpus_below(CORPUS_WORDS_NUM)];
+      if (fprintf(out, " %s", word) < 0) {
+        return -1;
+      }
+      line_len += 1 + strlen(word);
+    }
+
+    if (fputc('\n', out) == EOF) {
+      return -1;
+    }
+    written += line_len + 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Writes a file of the corpus.
+ * @param dir directory of the corpus
+ * @param name name of the file inside dir
+ * @param write writes the lines of the file
+ * @param size how many bytes the file should have at least
+ * @return Returns 0 if non error has been encountered.
+ */
+static int corpus_write(const char *dir, const char *name,
+                        int (*write)(FILE *, long), long size) {
+  char path[CORPUS_MAX_PATH];
+  if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) {
+    return -1;
+  }
+
+  FILE *out = fopen(path, "w");
+  if (out == NULL) {
+    return -1;
+  }
+
+  int result = write(out, size);
+  if (fclose(out) != 0) {
+    result = -1;
+  }
+
+  return result;
+}
+
+/**
+ * Program entry point.
+ * @param argc The argument counter.
+ * @param argv The argument vector.
+ * @return Returns EXIT_SUCCESS if the corpus has been written.
+ */
+int main(int argc, char **argv) {
+  unsigned long long seed = 1;
+  long size = CORPUS_DEFAULT_SIZE;
+  char *end;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "s:b:")) != -1) {
+    switch (opt) {
+    case 's':
+      errno = 0;
+      seed = strtoull(optarg, &end, 10);
+      if (errno != 0 || *end != '\0' || end == optarg) {
+        fprintf(stderr, "%s\n%s", argv[0], USAGE);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'b':
+      errno = 0;
+      size = strtol(optarg, &end, 10);
+      if (errno != 0 || *end != '\0' || end == optarg || size <= 0) {
+        fprintf(stderr, "%s\n%s", argv[0], USAGE);
+        return EXIT_FAILURE;
+      }
+      break;
+    default:
+      fprintf(stderr, "%s\n%s", argv[0], USAGE);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (optind != argc - 1) {
+    fprintf(stderr, "%s\n%s", argv[0], USAGE);
+    return EXIT_FAILURE;
+  }
+  const char *dir = argv[optind];
+
+  if (mkdir(dir, 0777) == -1 && errno != EEXIST) {
+    fprintf(stderr, "%s\nError while trying to create %s.\n", argv[0], dir);
+    return EXIT_FAILURE;
+  }
+
+  // xorshift never leaves a state of 0
+  corpus_state = seed == 0 ? 1 : seed;
+
+  if (corpus_write(dir, "logs.txt", corpus_write_logs, size) != 0 ||
+      corpus_write(dir, "long.txt", corpus_write_long, size / 4) != 0) {
+    fprintf(stderr, "%s\nError while trying to write the corpus.\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
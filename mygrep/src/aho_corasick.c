@@ -0,0 +1,380 @@
+/**
+ * @file aho_corasick.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an Aho-Corasick automaton to search many keywords at once.
+ *
+ * @details The automaton is stored as a single array of 'states_num' rows. To
+ * keep the rows short the bytes are mapped to columns first: every byte value
+ * that appears in a keyword gets its own column, all other bytes share column
+ * 0 (which always leads back to the root). The input is scanned once no matter
+ * how many keywords there are.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aho_corasick.h"
+#include "search.h"
+
+/**
+ * Marks a missing edge while the trie is built.
+ */
+#define AC_NO_STATE UINT32_MAX
+
+/**
+ * Folds a byte for a case insensitive automaton.
+ * @param c byte to fold
+ * @param ignore_case if the byte should be folded at all
+ * @return Returns the folded byte.
+ */
+static unsigned char ac_fold(unsigned char c, bool ignore_case) {
+  if (ignore_case && c >= 'A' && c <= 'Z') {
+    return c + ('a' - 'A');
+  }
+
+  return c;
+}
+
+/**
+ * Assigns a column to every byte that appears in a keyword.
+ */
+static void ac_init_classes(aho_corasick_t *ac, char **keywords,
+                            int keywords_num, bool ignore_case) {
+  memset(ac->classes, 0, sizeof(ac->classes));
+  ac->classes_num = 1;
+
+  for (int i = 0; i < keywords_num; i += 1) {
+    for (const char *c = keywords[i]; *c != '\0'; c += 1) {
+      unsigned char folded = ac_fold((unsigned char)*c, ignore_case);
+      if (ac->classes[folded] == 0) {
+        ac->classes[folded] = ac->classes_num;
+        ac->classes_num += 1;
+      }
+    }
+  }
+
+  if (ignore_case) {
+    for (int c = 'A'; c <= 'Z'; c += 1) {
+      ac->classes[c] = ac->classes[c + ('a' - 'A')];
+    }
+  }
+}
+
+/**
+ * Inserts all keywords into the trie.
+ * @details Edges that don't exist are set to AC_NO_STATE and resolved later by
+ * 'ac_resolve'.
+ */
+static void ac_build_trie(aho_corasick_t *ac, char **keywords,
+                          int keywords_num) {
+  ac->states_num = 1;
+  for (uint32_t column = 0; column < ac->classes_num; column += 1) {
+    ac->table[column] = AC_NO_STATE;
+  }
+
+  for (int i = 0; i < keywords_num; i += 1) {
+    uint32_t state = 0;
+
+    for (const char *c = keywords[i]; *c != '\0'; c += 1) {
+      uint32_t *edge =
+          &ac->table[state * ac->classes_num + ac->classes[(unsigned char)*c]];
+
+      if (*edge == AC_NO_STATE) {
+        uint32_t created = ac->states_num;
+        ac->states_num += 1;
+
+        uint32_t *row = &ac->table[created * ac->classes_num];
+        for (uint32_t column = 0; column < ac->classes_num; column += 1) {
+          row[column] = AC_NO_STATE;
+        }
+
+        *edge = created;
+      }
+
+      state = *edge;
+    }
+
+    ac->accepting[state] = 1;
+  }
+}
+
+/**
+ * Turns the trie into the automaton.
+ * @details Walks the trie breadth first, so the failure state of a state is
+ * always complete before the state itself is looked at. Every missing edge is
+ * replaced with the edge of the failure state.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int ac_resolve(aho_corasick_t *ac) {
+  uint32_t *fail = malloc(ac->states_num * sizeof(uint32_t));
+  uint32_t *queue = malloc(ac->states_num * sizeof(uint32_t));
+  if (fail == NULL || queue == NULL) {
+    free(fail);
+    free(queue);
+    return -1;
+  }
+
+  size_t head = 0;
+  size_t tail = 0;
+
+  for (uint32_t column = 0; column < ac->classes_num; column += 1) {
+    uint32_t child = ac->table[column];
+    if (child == AC_NO_STATE) {
+      ac->table[column] = 0;
+    } else {
+      fail[child] = 0;
+      queue[tail] = child;
+      tail += 1;
+    }
+  }
+
+  while (head < tail) {
+    uint32_t state = queue[head];
+    head += 1;
+
+    uint32_t *row = &ac->table[state * ac->classes_num];
+    const uint32_t *fail_row = &ac->table[fail[state] * ac->classes_num];
+
+    for (uint32_t column = 0; column < ac->classes_num; column += 1) {
+      uint32_t child = row[column];
+      if (child == AC_NO_STATE) {
+        row[column] = fail_row[column];
+      } else {
+        fail[child] = fail_row[column];
+        ac->accepting[child] |= ac->accepting[fail[child]];
+        queue[tail] = child;
+        tail += 1;
+      }
+    }
+  }
+
+  free(fail);
+  free(queue);
+
+  return 0;
+}
+
+int ac_init(aho_corasick_t *ac, char **keywords, int keywords_num,
+            bool ignore_case) {
+  ac->table = NULL;
+  ac->accepting = NULL;
+  ac->matches_empty = false;
+  ac->fold_utf8 = false;
+
+  size_t max_states = 1;
+  for (int i = 0; i < keywords_num; i += 1) {
+    max_states += strlen(keywords[i]);
+    if (keywords[i][0] == '\0') {
+      ac->matches_empty = true;
+    }
+
+    // the classes only fold ASCII letters, a folded keyword with other
+    // characters needs the haystack to be folded the same way
+    for (const char *c = keywords[i]; ignore_case && *c != '\0'; c += 1) {
+      if ((unsigned char)*c >= 0x80) {
+        ac->fold_utf8 = true;
+      }
+    }
+  }
+
+  if (max_states > AC_NO_STATE) {
+    return -1;
+  }
+
+  ac_init_classes(ac, keywords, keywords_num, ignore_case);
+
+  ac->table = malloc(max_states * ac->classes_num * sizeof(uint32_t));
+  ac->accepting = calloc(max_states, sizeof(uint8_t));
+  if (ac->table == NULL || ac->accepting == NULL) {
+    ac_free(ac);
+    return -1;
+  }
+
+  ac_build_trie(ac, keywords, keywords_num);
+  if (ac_resolve(ac) != 0) {
+    ac_free(ac);
+    return -1;
+  }
+
+  ac_init_starts(ac);
+
+  // give back the rows of states that have been shared between keywords
+  uint32_t *table =
+      realloc(ac->table, ac->states_num * ac->classes_num * sizeof(uint32_t));
+  if (table != NULL) {
+    ac->table = table;
+  }
+
+  return 0;
+}
+
+void ac_init_starts(aho_corasick_t *ac) {
+  ac->starts_num = 0;
+  ac->start = 0;
+
+  for (int c = 0; c < 256; c += 1) {
+    // a folded character can start with another byte than the haystack
+    // character, so every multibyte character has to be looked at
+    ac->starts[c] =
+        ac->table[ac->classes[c]] != 0 || (ac->fold_utf8 && c >= 0x80);
+
+    if (ac->starts[c]) {
+      ac->starts_num += 1;
+      ac->start = (unsigned char)c;
+    }
+  }
+}
+
+/**
+ * Skips the bytes that lead back to the root.
+ * @details In the root every byte that no keyword starts with leads back to
+ * it. Those bytes don't depend on each other, so they are skipped much faster
+ * than the table can be walked. A single start byte is found with 'memchr'.
+ * Only called if there are at most AC_SKIP_MAX start bytes.
+ * @param hay the haystack
+ * @param i index of the first byte to look at
+ * @param len length of the haystack
+ * @return Returns the index of the next byte that leaves the root or len.
+ */
+static size_t ac_skip(const aho_corasick_t *ac, const unsigned char *hay,
+                      size_t i, size_t len) {
+  if (ac->starts_num == 1) {
+    const unsigned char *found = memchr(hay + i, ac->start, len - i);
+    return found == NULL ? len : (size_t)(found - hay);
+  }
+
+  while (i < len && ac->starts[hay[i]] == 0) {
+    i += 1;
+  }
+
+  return i;
+}
+
+/**
+ * Finds the first occurrence of any keyword, folding the haystack.
+ * @details Every two byte UTF-8 character is folded with 'search_fold_char'
+ * and both of its folded bytes are fed to the automaton. Folding keeps the
+ * length, so the returned pointer is still the last byte of the occurrence.
+ */
+static const char *ac_find_folded(const aho_corasick_t *ac,
+                                  const char *haystack, size_t haystack_len) {
+  const unsigned char *hay = (const unsigned char *)haystack;
+  const uint32_t classes_num = ac->classes_num;
+
+  const bool skips = ac->starts_num <= AC_SKIP_MAX;
+
+  uint32_t state = 0;
+  size_t i = 0;
+  while (i < haystack_len) {
+    if (state == 0 && skips) {
+      i = ac_skip(ac, hay, i, haystack_len);
+      if (i == haystack_len) {
+        break;
+      }
+    }
+
+    unsigned char folded[2] = {hay[i], 0};
+    size_t step = 1;
+    if (hay[i] >= 0x80) {
+      step = search_fold_char(hay + i, haystack_len - i, folded);
+    }
+
+    for (size_t j = 0; j < step; j += 1) {
+      state = ac->table[state * classes_num + ac->classes[folded[j]]];
+      if (state >= ac->states_num) {
+        // only a damaged compiled pattern file leads outside of the table
+        state = 0;
+      }
+
+      if (ac->accepting[state]) {
+        return haystack + i + j;
+      }
+    }
+
+    i += step;
+  }
+
+  return NULL;
+}
+
+/**
+ * Finds the first occurrence of any keyword, skipping ahead in the root.
+ * @details Kept apart from the plain loop of 'ac_find', checking for the root
+ * at every byte would slow down automatons with many start bytes.
+ */
+static const char *ac_find_skipping(const aho_corasick_t *ac,
+                                    const char *haystack,
+                                    size_t haystack_len) {
+  const unsigned char *hay = (const unsigned char *)haystack;
+  const uint32_t *table = ac->table;
+  const uint16_t *classes = ac->classes;
+  const uint32_t classes_num = ac->classes_num;
+  const uint32_t states_num = ac->states_num;
+
+  uint32_t state = 0;
+  for (size_t i = 0; i < haystack_len; i += 1) {
+    if (state == 0) {
+      i = ac_skip(ac, hay, i, haystack_len);
+      if (i == haystack_len) {
+        break;
+      }
+    }
+
+    state = table[state * classes_num + classes[hay[i]]];
+    if (state >= states_num) {
+      state = 0;
+    }
+
+    if (ac->accepting[state]) {
+      return haystack + i;
+    }
+  }
+
+  return NULL;
+}
+
+const char *ac_find(const aho_corasick_t *ac, const char *haystack,
+                    size_t haystack_len) {
+  if (ac->matches_empty) {
+    return haystack;
+  }
+
+  if (ac->fold_utf8) {
+    return ac_find_folded(ac, haystack, haystack_len);
+  }
+
+  if (ac->starts_num <= AC_SKIP_MAX) {
+    return ac_find_skipping(ac, haystack, haystack_len);
+  }
+
+  const uint32_t *table = ac->table;
+  const uint16_t *classes = ac->classes;
+  const uint32_t classes_num = ac->classes_num;
+  const uint32_t states_num = ac->states_num;
+
+  uint32_t state = 0;
+  for (size_t i = 0; i < haystack_len; i += 1) {
+    state = table[state * classes_num + classes[(unsigned char)haystack[i]]];
+    if (state >= states_num) {
+      state = 0;
+    }
+
+    if (ac->accepting[state]) {
+      return haystack + i;
+    }
+  }
+
+  return NULL;
+}
+
+void ac_free(aho_corasick_t *ac) {
+  free(ac->table);
+  free(ac->accepting);
+  ac->table = NULL;
+  ac->accepting = NULL;
+}
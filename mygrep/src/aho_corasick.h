@@ -0,0 +1,89 @@
+/**
+ * @file aho_corasick.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an Aho-Corasick automaton to search many keywords at once.
+ */
+
+#ifndef _AHO_CORASICK_H
+#define _AHO_CORASICK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Bytes that leave the root are only skipped to if there are at most this
+ * many of them, otherwise nearly every byte leaves it and checking costs more
+ * than it saves.
+ */
+#define AC_SKIP_MAX (16)
+
+typedef struct aho_corasick {
+  uint32_t *table;      ///< flat transition table, 'classes_num' entries per
+                        ///< state, row 0 is the root
+  uint8_t *accepting;   ///< 1 if a keyword ends in the state
+  uint32_t states_num;  ///< how many states the automaton has
+  uint32_t classes_num; ///< how many columns a row of 'table' has
+
+  uint16_t classes[256]; ///< column of every byte value, all bytes that don't
+                         ///< appear in a keyword share column 0
+  uint8_t starts[256];   ///< 1 if the byte value leaves the root
+  int starts_num;        ///< how many byte values leave the root, the others
+                         ///< are only skipped if there are few of them
+  unsigned char start;   ///< the byte value that leaves the root if there is
+                         ///< only one
+
+  bool matches_empty; ///< 'true' if one of the keywords is empty
+  bool fold_utf8;     ///< 'true' if the two byte UTF-8 characters of the
+                      ///< haystack are folded like 'search_fold' has folded
+                      ///< the keywords
+} aho_corasick_t;
+
+/**
+ * Compiles the keywords into a single automaton.
+ * @brief Builds the trie of the keywords and resolves all failure links into
+ * the transition table, so matching needs exactly one lookup per byte. Bytes
+ * that no keyword starts with are skipped without a lookup while nothing is
+ * matched.
+ * @param ac the aho_corasick_t that should be initialized.
+ * @param keywords the keywords to search for
+ * @param keywords_num how many keywords there are
+ * @param ignore_case 'true' if the search should be case insensitive, the
+ * keywords then have to be folded with 'search_fold' already
+ * @return Returns 0 if non error has been encountered.
+ */
+int ac_init(aho_corasick_t *ac, char **keywords, int keywords_num,
+            bool ignore_case);
+
+/**
+ * Finds the bytes that leave the root of the automaton.
+ * @brief Called by 'ac_init', an automaton that has been set up in another
+ * way (e.g. mapped from a file) has to call it once its table and classes are
+ * in place.
+ * @param ac the aho_corasick_t whose 'starts' should be set
+ */
+void ac_init_starts(aho_corasick_t *ac);
+
+/**
+ * Finds the first occurrence of any keyword.
+ * @brief A transition outside of the table (only in a damaged compiled
+ * pattern file) leads back to the root, so the table is never read out of
+ * bounds.
+ * @param ac an initialized aho_corasick_t
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes
+ * @return Returns a pointer to the last byte of the first occurrence (or to
+ * the haystack if an empty keyword exists) or NULL.
+ */
+const char *ac_find(const aho_corasick_t *ac, const char *haystack,
+                    size_t haystack_len);
+
+/**
+ * Frees the given aho_corasick_t.
+ * @param ac the aho_corasick_t that should be freed.
+ */
+void ac_free(aho_corasick_t *ac);
+
+#endif /* _AHO_CORASICK_H */
@@ -0,0 +1,259 @@
+/**
+ * @file approx.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an approximate search for a keyword within a number of
+ * edits ('-k').
+ *
+ * @details A line matches if any of its substrings can be turned into the
+ * keyword with at most k single byte edits. Myers' algorithm keeps the whole
+ * column of the edit distance matrix as two bit vectors, so every haystack
+ * byte costs a handful of word operations instead of a pass over the keyword.
+ *
+ * If the keyword is split into k + 1 pieces, k edits can change at most k of
+ * them, so every match contains at least one piece unchanged. The pieces are
+ * searched with the vectorized search kernels and only lines that contain one
+ * of them are compared with the keyword. Keywords that are too short for
+ * pieces of APPROX_PIECE_MIN bytes are compared with every line.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "approx.h"
+#include "search.h"
+
+/**
+ * The first and the largest window the pieces are searched in.
+ */
+#define APPROX_WINDOW_MIN (4 * 1024)
+#define APPROX_WINDOW_MAX (1024 * 1024)
+
+/**
+ * Splits the keyword into edits + 1 pieces and prepares their searches.
+ * @details Case insensitive keywords with multibyte characters aren't split,
+ * a piece could start in the middle of a character.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int approx_init_pieces(approx_t *approx, const char *keyword,
+                              bool ignore_case) {
+  const size_t pieces_num = (size_t)approx->edits + 1;
+
+  if (approx->len / pieces_num < APPROX_PIECE_MIN) {
+    return 0;
+  }
+
+  for (size_t i = 0; i < approx->len; i += 1) {
+    if (ignore_case && (unsigned char)keyword[i] >= 0x80) {
+      return 0;
+    }
+  }
+
+  approx->pieces_text = malloc(approx->len + pieces_num);
+  if (approx->pieces_text == NULL) {
+    return -1;
+  }
+
+  char *text = approx->pieces_text;
+  for (size_t i = 0; i < pieces_num; i += 1) {
+    size_t start = i * approx->len / pieces_num;
+    size_t end = (i + 1) * approx->len / pieces_num;
+
+    memcpy(text, keyword + start, end - start);
+    text[end - start] = '\0';
+    search_init(&approx->pieces[i], text, ignore_case);
+
+    text += end - start + 1;
+  }
+
+  approx->pieces_num = (int)pieces_num;
+
+  return 0;
+}
+
+int approx_init(approx_t *approx, const char *keyword, int edits,
+                bool ignore_case) {
+  approx->len = strlen(keyword);
+  approx->edits = edits;
+  approx->pieces_text = NULL;
+  approx->pieces_num = 0;
+  approx->fold_utf8 = false;
+
+  if (approx->len > APPROX_MAX_LEN || edits < 1) {
+    return -1;
+  }
+
+  memset(approx->peq, 0, sizeof(approx->peq));
+  for (size_t i = 0; i < approx->len; i += 1) {
+    unsigned char c = (unsigned char)keyword[i];
+
+    approx->peq[c] |= (uint64_t)1 << i;
+    if (ignore_case && c >= 'a' && c <= 'z') {
+      approx->peq[c - ('a' - 'A')] |= (uint64_t)1 << i;
+    }
+    // the uppercase form of a folded multibyte character can differ in
+    // both of its bytes, so the haystack is folded instead
+    if (ignore_case && c >= 0x80) {
+      approx->fold_utf8 = true;
+    }
+  }
+
+  return approx_init_pieces(approx, keyword, ignore_case);
+}
+
+/**
+ * Compares the keyword with every substring of the haystack.
+ * @details Myers' algorithm in the formulation of Hyyrö. The vertical deltas
+ * of the current column are kept in vp (+1) and vn (-1), score is the edit
+ * distance of the whole keyword to the best substring that ends at the current
+ * byte. A newline starts the matrix over, so a match never spans two lines.
+ * With 'fold_utf8' every two byte character is folded before its bytes are
+ * compared, folding keeps the length, so the edits still count bytes.
+ * @return Returns a pointer to the last byte of the first match or NULL.
+ */
+static const char *approx_scan(const approx_t *approx, const char *haystack,
+                               size_t haystack_len) {
+  const uint64_t high = (uint64_t)1 << (approx->len - 1);
+  const int len = (int)approx->len;
+
+  const unsigned char *hay = (const unsigned char *)haystack;
+
+  uint64_t vp = ~(uint64_t)0;
+  uint64_t vn = 0;
+  int score = len;
+
+  // the folded bytes of the character at folded_start
+  unsigned char folded[2];
+  size_t folded_start = 0;
+  size_t folded_end = 0;
+
+  for (size_t i = 0; i < haystack_len; i += 1) {
+    unsigned char c = hay[i];
+
+    if (approx->fold_utf8 && c >= 0x80) {
+      if (i >= folded_end) {
+        folded_start = i;
+        folded_end = i + search_fold_char(hay + i, haystack_len - i, folded);
+      }
+      c = folded[i - folded_start];
+    }
+
+    if (c == '\n') {
+      vp = ~(uint64_t)0;
+      vn = 0;
+      score = len;
+      continue;
+    }
+
+    uint64_t eq = approx->peq[c];
+    uint64_t xv = eq | vn;
+    uint64_t xh = (((eq & vp) + vp) ^ vp) | eq;
+    uint64_t ph = vn | ~(xh | vp);
+    uint64_t mh = vp & xh;
+
+    if ((ph & high) != 0) {
+      score += 1;
+    } else if ((mh & high) != 0) {
+      score -= 1;
+    }
+
+    // the first row stays 0, a match may start anywhere
+    ph <<= 1;
+    mh <<= 1;
+    vp = mh | ~(xv | ph);
+    vn = ph & xv;
+
+    if (score <= approx->edits) {
+      return haystack + i;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Finds the first piece that starts in the first len bytes after start.
+ * @param end end of the haystack, a piece may reach up to it
+ * @return Returns a pointer to the first piece or NULL.
+ */
+static const char *approx_next_piece(const approx_t *approx, const char *start,
+                                     size_t len, const char *end) {
+  const char *first = NULL;
+
+  for (int i = 0; i < approx->pieces_num; i += 1) {
+    const search_t *piece = &approx->pieces[i];
+
+    // only a piece in front of the first one found so far is of interest
+    size_t starts = first != NULL ? (size_t)(first - start) : len;
+    size_t reach = starts + piece->needle_len - 1;
+    if (reach > (size_t)(end - start)) {
+      reach = end - start;
+    }
+
+    const char *found = search_find(piece, start, reach);
+    if (found != NULL) {
+      first = found;
+    }
+  }
+
+  return first;
+}
+
+const char *approx_find(const approx_t *approx, const char *haystack,
+                        size_t haystack_len) {
+  if ((size_t)approx->edits >= approx->len) {
+    // deleting the whole keyword is already enough
+    return haystack_len > 0 ? haystack : NULL;
+  }
+
+  if (approx->pieces_num == 0) {
+    return approx_scan(approx, haystack, haystack_len);
+  }
+
+  const char *end = haystack + haystack_len;
+  const char *current = haystack;
+  // a piece that doesn't occur is never searched further than needed
+  size_t window = APPROX_WINDOW_MIN;
+
+  while (current < end) {
+    size_t left = end - current;
+    size_t len = left < window ? left : window;
+
+    const char *piece = approx_next_piece(approx, current, len, end);
+    if (piece == NULL) {
+      current += len;
+      if (window < APPROX_WINDOW_MAX) {
+        window *= 2;
+      }
+      continue;
+    }
+
+    const char *line_start = piece;
+    while (line_start > haystack && line_start[-1] != '\n') {
+      line_start -= 1;
+    }
+    const char *line_end = memchr(piece, '\n', end - piece);
+    if (line_end == NULL) {
+      line_end = end;
+    }
+
+    const char *found = approx_scan(approx, line_start, line_end - line_start);
+    if (found != NULL) {
+      return found;
+    }
+
+    current = line_end < end ? line_end + 1 : end;
+  }
+
+  return NULL;
+}
+
+void approx_free(approx_t *approx) {
+  free(approx->pieces_text);
+  approx->pieces_text = NULL;
+  approx->pieces_num = 0;
+}
@@ -0,0 +1,87 @@
+/**
+ * @file approx.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides an approximate search for a keyword within a number of
+ * edits ('-k').
+ */
+
+#ifndef _APPROX_H
+#define _APPROX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "search.h"
+
+/**
+ * Length of the longest keyword, the whole keyword fits into one machine
+ * word.
+ */
+#define APPROX_MAX_LEN (64)
+
+/**
+ * Shortest piece of the keyword the filter searches for.
+ */
+#define APPROX_PIECE_MIN (3)
+
+/**
+ * Upper bound of how many pieces the filter searches for.
+ */
+#define APPROX_MAX_PIECES (APPROX_MAX_LEN / APPROX_PIECE_MIN)
+
+typedef struct approx {
+  size_t len; ///< length of the keyword in bytes
+  int edits;  ///< how many insertions, deletions and substitutions a match
+              ///< may have
+
+  uint64_t peq[256]; ///< bit i is set if byte i of the keyword equals the
+                     ///< byte value
+
+  bool fold_utf8; ///< 'true' if the two byte UTF-8 characters of the
+                  ///< haystack are folded like the keyword
+
+  char *pieces_text;                  ///< the NUL terminated pieces
+  search_t pieces[APPROX_MAX_PIECES]; ///< searches for the pieces
+  int pieces_num; ///< how many pieces are searched, 0 if every line is
+                  ///< compared with the keyword
+} approx_t;
+
+/**
+ * Prepares an approximate search for the keyword.
+ * @brief A match may differ from the keyword by up to edits single byte
+ * insertions, deletions and substitutions. Case insensitive searches fold
+ * the haystack like 'search_fold' has folded the keyword.
+ * @param approx the approx_t that should be initialized.
+ * @param keyword NUL terminated keyword of at most APPROX_MAX_LEN bytes,
+ * must outlive the search. If ignore_case is set it has to be folded with
+ * 'search_fold' already.
+ * @param edits how many edits a match may have, at least 1
+ * @param ignore_case 'true' if the search should be case insensitive
+ * @return Returns 0 if non error has been encountered.
+ */
+int approx_init(approx_t *approx, const char *keyword, int edits,
+                bool ignore_case);
+
+/**
+ * Finds the first line that contains the keyword within the allowed edits.
+ * @brief If the keyword is long enough it is split into edits + 1 pieces, one
+ * of them has to occur unchanged in every match. Only lines that contain a
+ * piece are compared with the keyword, using Myers' bit-parallel algorithm.
+ * @param approx an initialized approx_t
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes
+ * @return Returns a pointer to the last byte of the first match or NULL.
+ */
+const char *approx_find(const approx_t *approx, const char *haystack,
+                        size_t haystack_len);
+
+/**
+ * Frees the given approx_t.
+ * @param approx the approx_t that should be freed.
+ */
+void approx_free(approx_t *approx);
+
+#endif /* _APPROX_H */
@@ -6,8 +6,9 @@
  * @brief Provides utility functions to store the executable arguments.
  */
 
-#include <ctype.h>
+#include <errno.h>
 #include <getopt.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,23 +16,47 @@
 
 #include "arguments.h"
 
-int arguments_add_input_file(arguments_t *arg, char *file);
-
-void to_lowercase(char *str) {
-  if (str == NULL)
-    return;
-
-  for (int i = 0; i < strlen(str); i += 1) {
-    str[i] = tolower(str[i]);
-  }
-}
+int arguments_add_keyword(arguments_t *arg, char *keyword);
 
 void arguments_init(arguments_t *arg) {
   arg->output_file = NULL;
 
-  arg->keyword = NULL;
+  arg->keywords = NULL;
+  arg->keywords_num = 0;
+  arg->keywords_capacity = 0;
+  // nothing to free until 'matcher_init' has been called
+  arg->matcher.type = E_MATCHER_LITERAL;
+
+  arg->patterns_file = NULL;
+  arg->compile_patterns = NULL;
+
+  arg->batch_files = NULL;
+  arg->batch_files_num = 0;
+  arg->batch_files_capacity = 0;
 
   arg->case_sensitive = true;
+  arg->regex = false;
+  arg->edits = 0;
+
+  arg->recursive = false;
+  arg->binary_files = E_BINARY_REPORT;
+
+  arg->index_mode = E_INDEX_NONE;
+  arg->index_dir = NULL;
+
+  arg->follow = false;
+
+  arg->threads = 1;
+  arg->stats = false;
+
+  arg->line_numbers = false;
+  arg->byte_offsets = false;
+
+  arg->output_mode = E_OUTPUT_LINES;
+  arg->max_count = -1;
+  arg->context_before = 0;
+  arg->context_after = 0;
+  arg->context = false;
 
   arg->input_files = NULL;
   arg->input_files_num = 0;
@@ -43,9 +68,32 @@ void arguments_free(arguments_t *arg) {
     free(arg->output_file);
   }
 
-  if (arg->keyword != NULL) {
-    free(arg->keyword);
+  matcher_free(&arg->matcher);
+
+  free(arg->patterns_file);
+  free(arg->compile_patterns);
+
+  if (arg->index_dir != NULL) {
+    free(arg->index_dir);
+  }
+
+  if (arg->keywords != NULL) {
+    for (int i = 0; i < arg->keywords_num; i += 1) {
+      free(arg->keywords[i]);
+    }
+    free(arg->keywords);
   }
+  arg->keywords_num = 0;
+  arg->keywords_capacity = 0;
+
+  if (arg->batch_files != NULL) {
+    for (int i = 0; i < arg->batch_files_num; i += 1) {
+      free(arg->batch_files[i]);
+    }
+    free(arg->batch_files);
+  }
+  arg->batch_files_num = 0;
+  arg->batch_files_capacity = 0;
 
   if (arg->input_files != NULL) {
     for (int i = 0; i < arg->input_files_num; i += 1) {
@@ -58,11 +106,33 @@ void arguments_free(arguments_t *arg) {
 }
 
 void arguments_print(arguments_t *arg) {
-  printf("arguments_t { output_file: \"%s\", keyword: \"%s\", case_sensitive: "
-         "%s, input_files: [",
-         arg->output_file ? arg->output_file : "None",
-         arg->keyword ? arg->keyword : "None",
-         arg->case_sensitive ? "true" : "false");
+  printf("arguments_t { output_file: \"%s\", keywords: [",
+         arg->output_file ? arg->output_file : "None");
+
+  for (int i = 0; i < arg->keywords_num; i++) {
+    printf("\"%s\"", arg->keywords[i]);
+    if (i < arg->keywords_num - 1) {
+      printf(", ");
+    }
+  }
+
+  printf("], patterns_file: \"%s\", compile_patterns: \"%s\"",
+         arg->patterns_file ? arg->patterns_file : "None",
+         arg->compile_patterns ? arg->compile_patterns : "None");
+
+  printf(", case_sensitive: %s, regex: %s, edits: %d, recursive: %s, "
+         "index_mode: %d, index_dir: \"%s\", binary_files: %d, follow: %s, "
+         "threads: %d, stats: %s, output_mode: %d, max_count: %ld, "
+         "context_before: %ld, context_after: %ld, line_numbers: %s, "
+         "byte_offsets: %s, input_files: [",
+         arg->case_sensitive ? "true" : "false", arg->regex ? "true" : "false",
+         arg->edits, arg->recursive ? "true" : "false", arg->index_mode,
+         arg->index_dir ? arg->index_dir : "None", arg->binary_files,
+         arg->follow ? "true" : "false", arg->threads,
+         arg->stats ? "true" : "false", arg->output_mode,
+         arg->max_count, arg->context_before, arg->context_after,
+         arg->line_numbers ? "true" : "false",
+         arg->byte_offsets ? "true" : "false");
 
   for (int i = 0; i < arg->input_files_num; i++) {
     printf("\"%s\"", arg->input_files[i]);
@@ -75,36 +145,182 @@ void arguments_print(arguments_t *arg) {
          arg->input_files_num, arg->input_files_capacity);
 }
 
-int arguments_add_input_file(arguments_t *arg, char *file) {
-  if (arg->input_files == NULL || arg->input_files_capacity == 0) {
+/**
+ * Values getopt_long returns for options without a short form.
+ */
+enum ARGUMENTS_LONG_OPTION {
+  ARGUMENTS_OPT_INDEX = 256,
+  ARGUMENTS_OPT_USE_INDEX,
+  ARGUMENTS_OPT_BINARY_FILES,
+  ARGUMENTS_OPT_FOLLOW,
+  ARGUMENTS_OPT_STATS,
+  ARGUMENTS_OPT_COMPILE_PATTERNS,
+  ARGUMENTS_OPT_BATCH
+};
+
+/**
+ * Options that only have a long form.
+ */
+static const struct option ARGUMENTS_LONG_OPTIONS[] = {
+    {"index", required_argument, NULL, ARGUMENTS_OPT_INDEX},
+    {"use-index", required_argument, NULL, ARGUMENTS_OPT_USE_INDEX},
+    {"binary-files", required_argument, NULL, ARGUMENTS_OPT_BINARY_FILES},
+    {"follow", no_argument, NULL, ARGUMENTS_OPT_FOLLOW},
+    {"stats", no_argument, NULL, ARGUMENTS_OPT_STATS},
+    {"compile-patterns", required_argument, NULL,
+     ARGUMENTS_OPT_COMPILE_PATTERNS},
+    {"batch", required_argument, NULL, ARGUMENTS_OPT_BATCH},
+    {NULL, 0, NULL, 0}};
+
+/**
+ * Appends a copy of item to a 'dynamic' list of strings.
+ * @param list pointer to the array of the list
+ * @param num pointer to how many items there are
+ * @param capacity pointer to the capacity of the list
+ * @param item the string to copy into the list
+ * @return Returns 0 if non error has been encountered.
+ */
+static int arguments_list_add(char ***list, int *num, int *capacity,
+                              const char *item) {
+  if (*list == NULL || *capacity == 0) {
     // default capacity
-    arg->input_files_capacity = 8;
-    arg->input_files_num = 0;
+    *capacity = 8;
+    *num = 0;
 
-    arg->input_files =
-        (char **)malloc(arg->input_files_capacity * sizeof(char *));
-    if (arg->input_files == NULL) {
+    *list = (char **)malloc(*capacity * sizeof(char *));
+    if (*list == NULL) {
       return -1;
     }
   }
 
-  if (arg->input_files_num >= arg->input_files_capacity) {
-    arg->input_files_capacity = arg->input_files_capacity * 3 / 2;
+  if (*num >= *capacity) {
+    int grown_capacity = *capacity * 3 / 2;
 
-    arg->input_files = (char **)realloc(
-        arg->input_files, arg->input_files_capacity * sizeof(char *));
-    if (arg->input_files == NULL) {
+    char **grown = (char **)realloc(*list, grown_capacity * sizeof(char *));
+    if (grown == NULL) {
       return -1;
     }
+
+    *list = grown;
+    *capacity = grown_capacity;
   }
 
-  arg->input_files[arg->input_files_num] = (char *)malloc(strlen(file) + 1);
-  if (arg->input_files[arg->input_files_num] == NULL) {
+  (*list)[*num] = strdup(item);
+  if ((*list)[*num] == NULL) {
     return -1;
   }
 
-  strcpy(arg->input_files[arg->input_files_num], file);
-  arg->input_files_num += 1;
+  *num += 1;
+
+  return 0;
+}
+
+int arguments_add_input_file(arguments_t *arg, char *file) {
+  return arguments_list_add(&arg->input_files, &arg->input_files_num,
+                            &arg->input_files_capacity, file);
+}
+
+int arguments_add_keyword(arguments_t *arg, char *keyword) {
+  return arguments_list_add(&arg->keywords, &arg->keywords_num,
+                            &arg->keywords_capacity, keyword);
+}
+
+/**
+ * Adds a keyword and the file its lines are written to ('--batch').
+ * @param arg where to store the keyword and the file
+ * @param pair 'keyword=outfile', split at the last '=' as a path rarely
+ * contains one
+ * @return Returns 0 if non error has been encountered.
+ */
+static int arguments_add_batch(arguments_t *arg, const char *pair) {
+  const char *separator = strrchr(pair, '=');
+  if (separator == NULL || separator[1] == '\0') {
+    return -1;
+  }
+
+  char *keyword = strndup(pair, separator - pair);
+  if (keyword == NULL) {
+    return -1;
+  }
+
+  int result = arguments_add_keyword(arg, keyword);
+  free(keyword);
+  if (result != 0) {
+    return -1;
+  }
+
+  return arguments_list_add(&arg->batch_files, &arg->batch_files_num,
+                            &arg->batch_files_capacity, separator + 1);
+}
+
+/**
+ * Adds every line of the file as a keyword.
+ * @param arg where to store the keywords
+ * @param file_path path of the file with one keyword per line
+ * @return Returns 0 if non error has been encountered.
+ */
+static int arguments_add_keyword_file(arguments_t *arg, const char *file_path) {
+  FILE *file = fopen(file_path, "r");
+  if (file == NULL) {
+    return -1;
+  }
+
+  size_t len = 256;
+  char *line = malloc(len * sizeof(char));
+  if (line == NULL) {
+    fclose(file);
+    return -1;
+  }
+
+  int result = 0;
+  ssize_t read;
+  while ((read = getline(&line, &len, file)) != -1) {
+    if (read > 0 && line[read - 1] == '\n') {
+      line[read - 1] = '\0';
+    }
+
+    if (arguments_add_keyword(arg, line) != 0) {
+      result = -1;
+      break;
+    }
+  }
+
+  free(line);
+  fclose(file);
+
+  return result;
+}
+
+/**
+ * Changes the output mode unless a mode that prints less has been set
+ * already, so '-q' wins over '-l' and '-l' wins over '-c'.
+ * @param arg where to store the output mode
+ * @param mode the requested output mode
+ */
+static void arguments_set_output_mode(arguments_t *arg, output_mode_e mode) {
+  if (mode > arg->output_mode) {
+    arg->output_mode = mode;
+  }
+}
+
+/**
+ * Parses a decimal number and checks its bounds.
+ * @param str the string to parse
+ * @param min smallest allowed value
+ * @param max largest allowed value
+ * @param value where to store the parsed number
+ * @return Returns 0 if str is a number between min and max.
+ */
+static int arguments_parse_number(const char *str, long min, long max,
+                                  long *value) {
+  char *end;
+
+  errno = 0;
+  *value = strtol(str, &end, 10);
+  if (errno != 0 || *end != '\0' || end == str || *value < min ||
+      *value > max) {
+    return -1;
+  }
 
   return 0;
 }
@@ -116,8 +332,16 @@ int arguments_parse(arguments_t *arg, int argc, char **argv) {
 
   int opt;
   int have_seen_i = 0;
+  bool have_keyword_option = false;
+  bool have_binary_option = false;
+  long value;
+  // '-A' and '-B' win over '-C', no matter in which order they are given
+  long context = 0;
+  long context_before = -1;
+  long context_after = -1;
 
-  while ((opt = getopt(argc, argv, "io:")) != -1) {
+  while ((opt = getopt_long(argc, argv, "A:B:C:Ee:F:f:ij:k:lcqm:o:rIanb",
+                            ARGUMENTS_LONG_OPTIONS, NULL)) != -1) {
     switch (opt) {
     case 'i':
       if (have_seen_i > 0) {
@@ -126,6 +350,130 @@ int arguments_parse(arguments_t *arg, int argc, char **argv) {
       arg->case_sensitive = false;
       have_seen_i += 1;
       break;
+    case 'E':
+      arg->regex = true;
+      break;
+    case 'e':
+      if (arguments_add_keyword(arg, optarg) != 0) {
+        return -1;
+      }
+      have_keyword_option = true;
+      break;
+    case 'f':
+      if (arguments_add_keyword_file(arg, optarg) != 0) {
+        return -1;
+      }
+      have_keyword_option = true;
+      break;
+    case 'F':
+    case ARGUMENTS_OPT_COMPILE_PATTERNS:
+      if (arg->patterns_file != NULL || arg->compile_patterns != NULL) {
+        return -1;
+      }
+      if (opt == 'F') {
+        arg->patterns_file = strdup(optarg);
+      } else {
+        arg->compile_patterns = strdup(optarg);
+      }
+      if (arg->patterns_file == NULL && arg->compile_patterns == NULL) {
+        return -1;
+      }
+      break;
+    case ARGUMENTS_OPT_BATCH:
+      if (arguments_add_batch(arg, optarg) != 0) {
+        return -1;
+      }
+      break;
+    case 'j':
+      if (arguments_parse_number(optarg, 1, ARGUMENTS_MAX_THREADS, &value) !=
+          0) {
+        return -1;
+      }
+      arg->threads = (int)value;
+      break;
+    case 'k':
+      if (arguments_parse_number(optarg, 0, APPROX_MAX_LEN, &value) != 0) {
+        return -1;
+      }
+      arg->edits = (int)value;
+      break;
+    case 'A':
+    case 'B':
+    case 'C':
+      if (arguments_parse_number(optarg, 0, LONG_MAX, &value) != 0) {
+        return -1;
+      }
+      arg->context = true;
+      if (opt == 'A') {
+        context_after = value;
+      } else if (opt == 'B') {
+        context_before = value;
+      } else {
+        context = value;
+      }
+      break;
+    case 'n':
+      arg->line_numbers = true;
+      break;
+    case 'b':
+      arg->byte_offsets = true;
+      break;
+    case 'l':
+      arguments_set_output_mode(arg, E_OUTPUT_FILES_WITH_MATCHES);
+      break;
+    case 'c':
+      arguments_set_output_mode(arg, E_OUTPUT_COUNT);
+      break;
+    case 'q':
+      arguments_set_output_mode(arg, E_OUTPUT_QUIET);
+      break;
+    case 'm':
+      if (arguments_parse_number(optarg, 0, LONG_MAX, &value) != 0) {
+        return -1;
+      }
+      arg->max_count = value;
+      break;
+    case 'r':
+      arg->recursive = true;
+      break;
+    case 'I':
+      arg->binary_files = E_BINARY_SKIP;
+      have_binary_option = true;
+      break;
+    case 'a':
+      arg->binary_files = E_BINARY_TEXT;
+      have_binary_option = true;
+      break;
+    case ARGUMENTS_OPT_BINARY_FILES:
+      if (strcmp(optarg, "binary") == 0) {
+        arg->binary_files = E_BINARY_REPORT;
+      } else if (strcmp(optarg, "without-match") == 0) {
+        arg->binary_files = E_BINARY_SKIP;
+      } else if (strcmp(optarg, "text") == 0) {
+        arg->binary_files = E_BINARY_TEXT;
+      } else {
+        return -1;
+      }
+      have_binary_option = true;
+      break;
+    case ARGUMENTS_OPT_FOLLOW:
+      arg->follow = true;
+      break;
+    case ARGUMENTS_OPT_STATS:
+      arg->stats = true;
+      break;
+    case ARGUMENTS_OPT_INDEX:
+    case ARGUMENTS_OPT_USE_INDEX:
+      if (arg->index_dir != NULL) {
+        return -1;
+      }
+      arg->index_mode =
+          opt == ARGUMENTS_OPT_INDEX ? E_INDEX_BUILD : E_INDEX_QUERY;
+      arg->index_dir = strdup(optarg);
+      if (arg->index_dir == NULL) {
+        return -1;
+      }
+      break;
     case 'o':
       arg->output_file = strdup(optarg);
       if (arg->output_file == NULL) {
@@ -137,19 +485,86 @@ int arguments_parse(arguments_t *arg, int argc, char **argv) {
     }
   }
 
-  if (optind < argc) {
-    arg->keyword = strdup(argv[optind]);
-    if (arg->keyword == NULL) {
+  arg->context_before = context_before >= 0 ? context_before : context;
+  arg->context_after = context_after >= 0 ? context_after : context;
+
+  if (arg->index_mode == E_INDEX_BUILD) {
+    // building the index needs nothing but the directory
+    return optind < argc || have_keyword_option ||
+                   arg->compile_patterns != NULL || arg->batch_files_num > 0
+               ? -1
+               : 0;
+  }
+
+  if (arg->compile_patterns != NULL) {
+    // compiling needs nothing but the list and where to write the result to
+    if (optind < argc || have_keyword_option || arg->output_file == NULL ||
+        arg->batch_files_num > 0 || arg->regex || arg->edits > 0 ||
+        arg->index_mode != E_INDEX_NONE ||
+        arguments_add_keyword_file(arg, arg->compile_patterns) != 0) {
       return -1;
     }
 
     if (arg->case_sensitive == false) {
-      to_lowercase(arg->keyword);
+      for (int i = 0; i < arg->keywords_num; i += 1) {
+        search_fold(arg->keywords[i]);
+      }
+    }
+
+    return 0;
+  }
+
+  if (arg->batch_files_num > 0) {
+    // the keywords come with their output files, and every option that
+    // changes what is printed or which lines are searched would have to be
+    // split up among them
+    if (have_keyword_option || arg->patterns_file != NULL || arg->regex ||
+        arg->edits > 0 || arg->output_file != NULL ||
+        arg->output_mode != E_OUTPUT_LINES || arg->max_count >= 0 ||
+        arg->context || arg->recursive || have_binary_option ||
+        arg->index_mode != E_INDEX_NONE || arg->follow || arg->threads > 1 ||
+        arg->stats) {
+      return -1;
+    }
+
+    for (int i = 0; i < arg->keywords_num; i += 1) {
+      if (strchr(arg->keywords[i], '\n') != NULL) {
+        return -1;
+      }
+    }
+    // the input files are all that is left
+    have_keyword_option = true;
+  }
+
+  // the case of a compiled pattern file has been fixed when it was compiled,
+  // and the index needs the keywords to look up their trigrams
+  if (arg->patterns_file != NULL &&
+      (have_keyword_option || arg->regex || arg->edits > 0 ||
+       arg->case_sensitive == false || arg->index_mode != E_INDEX_NONE)) {
+    return -1;
+  }
+  have_keyword_option = have_keyword_option || arg->patterns_file != NULL;
+
+  if (have_keyword_option == false) {
+    if (optind >= argc) {
+      return -1;
+    }
+
+    if (arguments_add_keyword(arg, argv[optind]) != 0) {
+      return -1;
     }
 
     optind += 1;
   }
 
+  // the regular expression engine folds on its own, folding the expression
+  // would turn e.g. '\S' into '\s'
+  if (arg->case_sensitive == false && arg->regex == false) {
+    for (int i = 0; i < arg->keywords_num; i += 1) {
+      search_fold(arg->keywords[i]);
+    }
+  }
+
   while (optind < argc) {
     if (arguments_add_input_file(arg, argv[optind]) == -1) {
       return -1;
@@ -158,5 +573,49 @@ int arguments_parse(arguments_t *arg, int argc, char **argv) {
     optind += 1;
   }
 
+  // searching whole trees shouldn't stop at every object file
+  if (have_binary_option == false &&
+      (arg->recursive || arg->index_mode == E_INDEX_QUERY)) {
+    arg->binary_files = E_BINARY_SKIP;
+  }
+
+  // the index decides which files are searched
+  if (arg->index_mode == E_INDEX_QUERY &&
+      (arg->input_files_num > 0 || arg->recursive)) {
+    return -1;
+  }
+
+  // a followed file never ends, so there is never a count to print
+  if (arg->follow &&
+      (arg->input_files_num == 0 || arg->recursive ||
+       arg->index_mode != E_INDEX_NONE || arg->output_mode == E_OUTPUT_COUNT)) {
+    return -1;
+  }
+
+  // '-k' compares a single keyword with single lines, and an approximate
+  // match doesn't contain the trigrams the index looks up
+  if (arg->edits > 0 &&
+      (arg->regex || arg->keywords_num != 1 ||
+       strchr(arg->keywords[0], '\n') != NULL ||
+       arg->index_mode != E_INDEX_NONE)) {
+    return -1;
+  }
+
+  // like grep, a recursive search without paths searches the working directory
+  if (arg->recursive && arg->input_files_num == 0) {
+    if (arguments_add_input_file(arg, ".") == -1) {
+      return -1;
+    }
+  }
+
+  if (arg->patterns_file != NULL) {
+    return matcher_load(&arg->matcher, arg->patterns_file);
+  }
+
+  if (matcher_init(&arg->matcher, arg->keywords, arg->keywords_num,
+                   !arg->case_sensitive, arg->regex, arg->edits) != 0) {
+    return -1;
+  }
+
   return 0;
 }
@@ -9,13 +9,104 @@
 #ifndef _ARGUMENTS_H
 #define _ARGUMENTS_H
 
+#include <stdbool.h>
+
+#include "matcher.h"
+
+/**
+ * Upper bound for the '-j' option.
+ */
+#define ARGUMENTS_MAX_THREADS 256
+
+/**
+ * @brief What is printed for the inputs, ordered from most to least output.
+ */
+typedef enum OUTPUT_MODE {
+  E_OUTPUT_LINES,              ///< every matching line
+  E_OUTPUT_COUNT,              ///< the number of matching lines ('-c')
+  E_OUTPUT_FILES_WITH_MATCHES, ///< the name of every matching input ('-l')
+  E_OUTPUT_QUIET               ///< nothing, only the exit status ('-q')
+} output_mode_e;
+
+/**
+ * @brief What the trigram index is used for.
+ */
+typedef enum INDEX_MODE {
+  E_INDEX_NONE,  ///< the index is not used
+  E_INDEX_BUILD, ///< build or update the index of 'index_dir' ('--index')
+  E_INDEX_QUERY  ///< search the files of 'index_dir' ('--use-index')
+} index_mode_e;
+
+/**
+ * @brief How files that look binary are handled ('--binary-files').
+ */
+typedef enum BINARY_MODE {
+  E_BINARY_REPORT, ///< print only that the file matches ('binary')
+  E_BINARY_SKIP,   ///< skip the file ('without-match', '-I')
+  E_BINARY_TEXT    ///< search the file like text ('text', '-a')
+} binary_mode_e;
+
 typedef struct arguments {
   char *output_file; ///< path to output file
 
-  char *keyword; ///< keyword to search for
+  char **keywords;       ///< array of keywords to search for
+  int keywords_num;      ///< how many keywords there are
+  int keywords_capacity; ///< the capacity of the 'dynamic' list of keywords
+  matcher_t matcher;     ///< prepared search for all 'keywords'
+
+  char *patterns_file;    ///< compiled pattern file that is searched for
+                          ///< instead of keywords ('-F')
+  char *compile_patterns; ///< keyword list that is compiled into
+                          ///< 'output_file' ('--compile-patterns')
+
+  char **batch_files;       ///< output file of every keyword ('--batch'),
+                            ///< in the order of 'keywords'
+  int batch_files_num;      ///< how many output files there are
+  int batch_files_capacity; ///< the capacity of the 'dynamic' list of output
+                            ///< files
 
   bool case_sensitive; ///< 'true' if the search is case sensitive, default:
                        ///< 'true'
+  bool regex; ///< 'true' if the keywords are extended regular expressions,
+              ///< default: 'false'
+  int edits;  ///< how many edits a match of the keyword may have ('-k'),
+              ///< default: 0
+
+  bool recursive; ///< 'true' if the input files are directories that are
+                  ///< searched recursively, default: 'false'
+  binary_mode_e binary_files; ///< how binary files are handled, default:
+                              ///< E_BINARY_REPORT, E_BINARY_SKIP for
+                              ///< 'recursive' and the index
+
+  index_mode_e index_mode; ///< what the index is used for, default:
+                           ///< E_INDEX_NONE
+  char *index_dir;         ///< the indexed directory
+
+  bool follow; ///< 'true' if the input files are followed and only what is
+               ///< appended to them is searched ('--follow'), default:
+               ///< 'false'
+
+  int threads; ///< how many files are searched in parallel, default: 1
+
+  bool stats; ///< 'true' if the throughput and timing statistics are printed
+              ///< to stderr ('--stats'), default: 'false'
+
+  bool line_numbers; ///< 'true' if lines are prefixed with their number
+                     ///< ('-n'), default: 'false'
+  bool byte_offsets; ///< 'true' if lines are prefixed with their byte offset
+                     ///< ('-b'), default: 'false'
+
+  long context_before; ///< lines of context printed before a matching line
+                       ///< ('-B', '-C'), default: 0
+  long context_after;  ///< lines of context printed after a matching line
+                       ///< ('-A', '-C'), default: 0
+  bool context;        ///< 'true' if '-A', '-B' or '-C' has been given, even
+                       ///< with 0 lines, the groups of lines are then
+                       ///< separated by '--', default: 'false'
+
+  output_mode_e output_mode; ///< what is printed, default: E_OUTPUT_LINES
+  long max_count; ///< stop an input after this many matching lines ('-m'),
+                  ///< default: -1 (no limit)
 
   char **input_files;       ///< array of paths of input files
   int input_files_num;      ///< how many input files there are
@@ -23,12 +114,6 @@ typedef struct arguments {
                             ///< files
 } arguments_t;
 
-/**
- * Modifies the input by transforming it to lowercase
- * @param str input to modify
- */
-void to_lowercase(char *str);
-
 /**
  * Initializes the given arguments.
  * @brief Initializes the arguments_t.
@@ -59,4 +144,12 @@ void arguments_print(arguments_t *arg);
  */
 int arguments_parse(arguments_t *arg, int argc, char **argv);
 
+/**
+ * Appends a copy of file to the input files.
+ * @param arg where to store the input file
+ * @param file path of the input file
+ * @return Returns 0 if non error has been encountered.
+ */
+int arguments_add_input_file(arguments_t *arg, char *file);
+
 #endif /* _ARGUMENTS_H */
@@ -0,0 +1,341 @@
+/**
+ * @file batch.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a search for many keywords at once that writes the lines of
+ * every keyword to a file of its own.
+ *
+ * @details Regular files are mapped and searched as a whole, everything else
+ * (pipes, stdin, files compressed with gzip) is read line per line by a
+ * reader thread.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "arguments.h"
+#include "batch.h"
+#include "reader.h"
+#include "search.h"
+
+/**
+ * @brief An output file of a batch and its keyword.
+ */
+typedef struct batch_output {
+  search_t search; ///< search for the keyword of this file alone
+  int fd;          ///< the opened output file
+  char *buffer;    ///< lines that haven't been written yet
+  size_t len;      ///< how many bytes of buffer are in use
+} batch_output_t;
+
+/**
+ * @brief State of a batch search.
+ */
+typedef struct batch {
+  arguments_t *args;       ///< the arguments of the search
+  batch_output_t *outputs; ///< one output per keyword
+  int outputs_num;         ///< how many outputs there are
+} batch_t;
+
+/**
+ * Writes all bytes, a short write is continued.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_write_all(int fd, const char *data, size_t len) {
+  while (len > 0) {
+    ssize_t written = write(fd, data, len);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    data += written;
+    len -= written;
+  }
+
+  return 0;
+}
+
+/**
+ * Writes the buffer of an output to its file.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_flush(batch_output_t *output) {
+  int result = batch_write_all(output->fd, output->buffer, output->len);
+  output->len = 0;
+
+  return result;
+}
+
+/**
+ * Appends bytes to the buffer of an output, a full buffer is written first.
+ * Bytes that don't fit into an empty buffer are written directly.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_append(batch_output_t *output, const char *data, size_t len) {
+  if (output->len + len > BATCH_BUFFER_SIZE && batch_flush(output) != 0) {
+    return -1;
+  }
+
+  if (len > BATCH_BUFFER_SIZE) {
+    return batch_write_all(output->fd, data, len);
+  }
+
+  memcpy(output->buffer + output->len, data, len);
+  output->len += len;
+
+  return 0;
+}
+
+/**
+ * Writes a matching line to the outputs of all keywords it contains.
+ * @param line the line including its newline, if it has one
+ * @param len length of line in bytes
+ * @param number number of the line, starting with 1 ('-n')
+ * @param offset byte offset of the line in its input ('-b')
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_dispatch(batch_t *batch, const char *line, size_t len,
+                          long number, off_t offset) {
+  const arguments_t *args = batch->args;
+  char prefix[64];
+  int prefix_len = 0;
+
+  if (args->line_numbers) {
+    prefix_len += snprintf(prefix + prefix_len, sizeof(prefix) - prefix_len,
+                           "%ld:", number);
+  }
+  if (args->byte_offsets) {
+    prefix_len += snprintf(prefix + prefix_len, sizeof(prefix) - prefix_len,
+                           "%lld:", (long long)offset);
+  }
+
+  // the matcher has only found one of the keywords, the others may be in
+  // the line as well
+  for (int i = 0; i < batch->outputs_num; i += 1) {
+    batch_output_t *output = &batch->outputs[i];
+    if (batch->outputs_num > 1 &&
+        search_find(&output->search, line, len) == NULL) {
+      continue;
+    }
+
+    if (batch_append(output, prefix, prefix_len) != 0 ||
+        batch_append(output, line, len) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Searches a whole buffer for matching lines.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_search_buffer(batch_t *batch, const char *buffer,
+                               size_t len) {
+  const char *end = buffer + len;
+  const char *pos = buffer;
+  const char *counted = buffer;
+  long number = 1;
+
+  while (pos < end) {
+    const char *match = matcher_find(&batch->args->matcher, pos, end - pos);
+    if (match == NULL) {
+      break;
+    }
+
+    const char *line_start = match;
+    while (line_start > pos && line_start[-1] != '\n') {
+      line_start -= 1;
+    }
+    const char *line_end = memchr(match, '\n', end - match);
+    line_end = line_end == NULL ? end : line_end + 1;
+
+    if (batch->args->line_numbers) {
+      number += search_count_newlines(counted, line_start - counted);
+      counted = line_start;
+    }
+
+    if (batch_dispatch(batch, line_start, line_end - line_start, number,
+                       line_start - buffer) != 0) {
+      return -1;
+    }
+
+    pos = line_end;
+  }
+
+  return 0;
+}
+
+/**
+ * Searches an input that can't be mapped line per line.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_search_stream(batch_t *batch, int fd, bool gzip) {
+  reader_t reader;
+  int started = gzip ? reader_start_gzip(&reader, fd)
+                     : reader_start_fd(&reader, fd);
+  if (started != 0) {
+    return -1;
+  }
+
+  const char *line;
+  char *spare = NULL;
+  size_t capacity = 0;
+  long number = 0;
+  off_t offset = 0;
+  int result = 0;
+  ssize_t len;
+
+  while ((len = reader_getline(&reader, &line, &spare, &capacity)) != -1) {
+    number += 1;
+
+    if (matcher_find(&batch->args->matcher, line, len) != NULL &&
+        batch_dispatch(batch, line, len, number, offset) != 0) {
+      result = -1;
+      break;
+    }
+
+    offset += len;
+  }
+
+  if (result == 0 && reader_failed(&reader)) {
+    result = -1;
+  }
+
+  free(spare);
+  reader_finish(&reader);
+
+  return result;
+}
+
+/**
+ * Searches a single input.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_search_fd(batch_t *batch, int fd) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1) {
+    return -1;
+  }
+
+  bool gzip = reader_is_gzip(fd, 0);
+  if (S_ISREG(file_stat.st_mode) == false || gzip) {
+    return batch_search_stream(batch, fd, gzip);
+  }
+
+  if (file_stat.st_size == 0) {
+    return 0;
+  }
+
+  char *mapped =
+      mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapped == MAP_FAILED) {
+    return batch_search_stream(batch, fd, false);
+  }
+  madvise(mapped, file_stat.st_size, MADV_SEQUENTIAL);
+
+  int result = batch_search_buffer(batch, mapped, file_stat.st_size);
+  munmap(mapped, file_stat.st_size);
+
+  return result;
+}
+
+/**
+ * Opens the output files and prepares the search of every keyword.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_open(batch_t *batch) {
+  arguments_t *args = batch->args;
+
+  batch->outputs = calloc(args->batch_files_num, sizeof(batch_output_t));
+  if (batch->outputs == NULL) {
+    return -1;
+  }
+
+  for (int i = 0; i < args->batch_files_num; i += 1) {
+    batch_output_t *output = &batch->outputs[i];
+
+    output->buffer = malloc(BATCH_BUFFER_SIZE);
+    if (output->buffer == NULL) {
+      return -1;
+    }
+
+    output->fd =
+        open(args->batch_files[i], O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (output->fd == -1) {
+      fprintf(stderr, "Failed to open the output file %s: %s\n",
+              args->batch_files[i], strerror(errno));
+      free(output->buffer);
+      return -1;
+    }
+
+    search_init(&output->search, args->keywords[i], !args->case_sensitive);
+    batch->outputs_num += 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Writes what is left in the buffers and closes the output files.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int batch_close(batch_t *batch) {
+  int result = 0;
+
+  for (int i = 0; i < batch->outputs_num; i += 1) {
+    batch_output_t *output = &batch->outputs[i];
+
+    if (batch_flush(output) != 0) {
+      result = -1;
+    }
+    if (close(output->fd) != 0) {
+      result = -1;
+    }
+    free(output->buffer);
+  }
+  free(batch->outputs);
+
+  return result;
+}
+
+int batch_search(arguments_t *args) {
+  batch_t batch = {.args = args, .outputs = NULL, .outputs_num = 0};
+
+  int result = batch_open(&batch);
+
+  if (result == 0 && args->input_files_num == 0) {
+    result = batch_search_fd(&batch, STDIN_FILENO);
+  }
+
+  for (int i = 0; result == 0 && i < args->input_files_num; i += 1) {
+    int fd = open(args->input_files[i], O_RDONLY);
+    if (fd == -1) {
+      fprintf(stderr, "Failed to open the file %s: %s\n",
+              args->input_files[i], strerror(errno));
+      result = -1;
+      break;
+    }
+
+    result = batch_search_fd(&batch, fd);
+    close(fd);
+  }
+
+  if (batch_close(&batch) != 0) {
+    result = -1;
+  }
+
+  return result;
+}
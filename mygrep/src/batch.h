@@ -0,0 +1,32 @@
+/**
+ * @file batch.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a search for many keywords at once that writes the lines of
+ * every keyword to a file of its own.
+ */
+
+#ifndef _BATCH_H
+#define _BATCH_H
+
+#include "arguments.h"
+
+/**
+ * Size of the buffer of every output file.
+ */
+#define BATCH_BUFFER_SIZE (64 * 1024)
+
+/**
+ * Searches the inputs for all keywords of a batch ('--batch').
+ * @brief Every input is read once. The matcher of all keywords finds the
+ * matching lines, only those are compared with every keyword on its own and
+ * written to the output files of all keywords they contain. Every output file
+ * has a buffer of its own, so the writes don't depend on how the matches of
+ * the keywords are interleaved. Without input files stdin is searched.
+ * @param args pointer to an arguments_t with 'batch_files'
+ * @return Returns 0 if non error has been encountered.
+ */
+int batch_search(arguments_t *args);
+
+#endif /* _BATCH_H */
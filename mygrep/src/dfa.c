@@ -0,0 +1,1223 @@
+/**
+ * @file dfa.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a regular expression engine based on a lazily built DFA.
+ *
+ * @details The expression is compiled into a Thompson NFA by a recursive
+ * descent parser. Searching simulates the NFA through a DFA whose states are
+ * sets of NFA states. A DFA state is only built the first time a byte leads
+ * into it, so the exponential blow up of a full subset construction never
+ * happens. The states are kept in a cache of 'DFA_MAX_STATES' entries which is
+ * cleared when it runs full, so every byte costs at most one NFA step and the
+ * search stays linear.
+ *
+ * Lines are matched independently: a newline resets the automaton, '^' is
+ * only passable at the start of a line and '$' only before a newline or the
+ * end of the haystack. The search is unanchored, every step adds the start of
+ * the expression to the next state again.
+ */
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "dfa.h"
+#include "search.h"
+
+/**
+ * How many DFA states a thread caches before the cache is cleared.
+ */
+#define DFA_MAX_STATES 4096
+
+/**
+ * Size of the hash table that maps NFA state sets to DFA states, must be a
+ * power of two and larger than DFA_MAX_STATES.
+ */
+#define DFA_HASH_SIZE 16384
+
+/**
+ * Largest count allowed in a '{m,n}' repetition.
+ */
+#define DFA_MAX_REPEAT 255
+
+/**
+ * Marks a transition that hasn't been computed yet.
+ */
+#define DFA_UNKNOWN -1
+
+/**
+ * @brief Part of the NFA that is built by the parser.
+ * @details Every fragment ends in an epsilon state whose 'out' is still -1,
+ * which makes joining fragments trivial.
+ */
+typedef struct fragment {
+  int start; ///< first state of the fragment
+  int end;   ///< last state of the fragment, an unpatched E_NFA_EPSILON
+} fragment_t;
+
+/**
+ * @brief State of the recursive descent parser.
+ */
+typedef struct dfa_parser {
+  const char *pattern; ///< the expression
+  size_t pos;          ///< index of the next character to parse
+  bool ignore_case;    ///< add both cases of every letter to the sets
+  bool error;          ///< set on the first syntax or allocation error
+
+  nfa_state_t *states; ///< the NFA that is built
+  int states_num;      ///< how many states there are
+  int states_capacity; ///< how many states 'states' can hold
+} dfa_parser_t;
+
+/**
+ * @brief A state of the lazily built DFA.
+ */
+typedef struct dfa_state {
+  int *nfa;           ///< sorted indices of the NFA states of this state
+  int nfa_num;        ///< how many NFA states there are
+  bool accepting;     ///< 'true' if the expression has matched
+  bool eol_accepting; ///< 'true' if the expression matches at a line end
+  int next[256];      ///< next DFA state per byte or DFA_UNKNOWN
+} dfa_state_t;
+
+/**
+ * @brief DFA states of a single thread.
+ */
+typedef struct dfa_cache {
+  dfa_state_t *states; ///< the cached DFA states
+  int states_num;      ///< how many states are in use
+  int hash[DFA_HASH_SIZE]; ///< index into 'states' or -1
+
+  int line_start; ///< DFA state at the start of a line or DFA_UNKNOWN
+
+  int *mark;      ///< generation an NFA state has last been added in
+  int generation; ///< the current generation
+  int *stack;     ///< stack for the closure, one entry per NFA state
+  int *set;       ///< the NFA state set that is built
+  int set_num;    ///< how many NFA states are in 'set'
+} dfa_cache_t;
+
+static fragment_t dfa_parse_alternation(dfa_parser_t *parser);
+static void dfa_cache_free(void *arg);
+
+/**
+ * Adds a new NFA state.
+ * @param parser the parser
+ * @param type type of the new state
+ * @return Returns the index of the state or -1 if the allocation failed.
+ */
+static int dfa_add_state(dfa_parser_t *parser, nfa_type_e type) {
+  if (parser->states_num >= parser->states_capacity) {
+    int capacity = parser->states_capacity == 0
+                       ? 64
+                       : parser->states_capacity * 3 / 2;
+    nfa_state_t *grown =
+        realloc(parser->states, capacity * sizeof(nfa_state_t));
+    if (grown == NULL) {
+      parser->error = true;
+      return -1;
+    }
+
+    parser->states = grown;
+    parser->states_capacity = capacity;
+  }
+
+  nfa_state_t *state = &parser->states[parser->states_num];
+  state->type = type;
+  state->out = -1;
+  state->out1 = -1;
+  memset(state->set, 0, sizeof(state->set));
+
+  parser->states_num += 1;
+  return parser->states_num - 1;
+}
+
+/**
+ * Creates a fragment that consists of a single state followed by its end.
+ * @param parser the parser
+ * @param type type of the state
+ * @return Returns the fragment, on error start is -1.
+ */
+static fragment_t dfa_single(dfa_parser_t *parser, nfa_type_e type) {
+  fragment_t fragment = {-1, -1};
+
+  int state = dfa_add_state(parser, type);
+  int end = dfa_add_state(parser, E_NFA_EPSILON);
+  if (state == -1 || end == -1) {
+    return fragment;
+  }
+
+  parser->states[state].out = end;
+  fragment.start = state;
+  fragment.end = end;
+  return fragment;
+}
+
+/**
+ * Creates a fragment that matches nothing, e.g. for '()'.
+ */
+static fragment_t dfa_empty(dfa_parser_t *parser) {
+  fragment_t fragment = {-1, -1};
+
+  int state = dfa_add_state(parser, E_NFA_EPSILON);
+  if (state == -1) {
+    return fragment;
+  }
+
+  fragment.start = state;
+  fragment.end = state;
+  return fragment;
+}
+
+/**
+ * Sets a byte in the bitmap of a set.
+ */
+static void dfa_set_add(uint8_t *set, unsigned char c) {
+  set[c / 8] |= (uint8_t)(1u << (c % 8));
+}
+
+/**
+ * Checks if a byte is in the bitmap of a set.
+ */
+static bool dfa_set_has(const uint8_t *set, unsigned char c) {
+  return (set[c / 8] & (1u << (c % 8))) != 0;
+}
+
+/**
+ * Adds all bytes the ctype function accepts to the set.
+ * @param set the bitmap
+ * @param is a function from ctype.h, only called with ASCII values
+ */
+static void dfa_set_add_class(uint8_t *set, int (*is)(int)) {
+  for (int c = 0; c < 128; c += 1) {
+    if (is(c)) {
+      dfa_set_add(set, (unsigned char)c);
+    }
+  }
+}
+
+/**
+ * ctype style check for the '\\w' escape.
+ */
+static int dfa_is_word(int c) { return isalnum(c) || c == '_'; }
+
+/**
+ * Adds the set of a '\\d', '\\w' or '\\s' escape (or their uppercase
+ * negations).
+ * @param set the bitmap
+ * @param escape the letter after the backslash
+ * @return Returns true if escape is one of the supported letters.
+ */
+static bool dfa_set_add_escape(uint8_t *set, char escape) {
+  uint8_t class_set[32] = {0};
+
+  switch (tolower((unsigned char)escape)) {
+  case 'd':
+    dfa_set_add_class(class_set, isdigit);
+    break;
+  case 'w':
+    dfa_set_add_class(class_set, dfa_is_word);
+    break;
+  case 's':
+    dfa_set_add_class(class_set, isspace);
+    break;
+  default:
+    return false;
+  }
+
+  bool negate = isupper((unsigned char)escape);
+  for (int i = 0; i < 32; i += 1) {
+    set[i] |= negate ? (uint8_t)~class_set[i] : class_set[i];
+  }
+  if (negate) {
+    set['\n' / 8] &= (uint8_t) ~(1u << ('\n' % 8));
+  }
+
+  return true;
+}
+
+/**
+ * Adds a named class like [:alpha:] to the set.
+ * @param set the bitmap
+ * @param name the name of the class, not NUL terminated
+ * @param len length of name
+ * @return Returns true if the name is known.
+ */
+static bool dfa_set_add_named(uint8_t *set, const char *name, size_t len) {
+  static const struct {
+    const char *name;
+    int (*is)(int);
+  } classes[] = {{"alnum", isalnum}, {"alpha", isalpha}, {"blank", isblank},
+                 {"cntrl", iscntrl}, {"digit", isdigit}, {"graph", isgraph},
+                 {"lower", islower}, {"print", isprint}, {"punct", ispunct},
+                 {"space", isspace}, {"upper", isupper}, {"xdigit", isxdigit}};
+
+  for (size_t i = 0; i < sizeof(classes) / sizeof(classes[0]); i += 1) {
+    if (strlen(classes[i].name) == len &&
+        strncmp(classes[i].name, name, len) == 0) {
+      dfa_set_add_class(set, classes[i].is);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Adds the other case of every ASCII letter in the set.
+ */
+static void dfa_set_fold(uint8_t *set) {
+  for (int c = 'a'; c <= 'z'; c += 1) {
+    int upper = c - ('a' - 'A');
+    if (dfa_set_has(set, (unsigned char)c) ||
+        dfa_set_has(set, (unsigned char)upper)) {
+      dfa_set_add(set, (unsigned char)c);
+      dfa_set_add(set, (unsigned char)upper);
+    }
+  }
+}
+
+/**
+ * Parses a bracket expression, the opening '[' has already been consumed.
+ * @param parser the parser
+ * @param set the bitmap to fill
+ */
+static void dfa_parse_bracket(dfa_parser_t *parser, uint8_t *set) {
+  const char *pattern = parser->pattern;
+  bool negate = false;
+
+  if (pattern[parser->pos] == '^') {
+    negate = true;
+    parser->pos += 1;
+  }
+
+  bool first = true;
+  while (pattern[parser->pos] != ']' || first) {
+    first = false;
+
+    char c = pattern[parser->pos];
+    if (c == '\0') {
+      parser->error = true;
+      return;
+    }
+
+    if (c == '[' && pattern[parser->pos + 1] == ':') {
+      const char *name = pattern + parser->pos + 2;
+      const char *name_end = strstr(name, ":]");
+      if (name_end == NULL ||
+          dfa_set_add_named(set, name, name_end - name) == false) {
+        parser->error = true;
+        return;
+      }
+      parser->pos = name_end + 2 - pattern;
+      continue;
+    }
+
+    if (c == '\\' && pattern[parser->pos + 1] != '\0') {
+      parser->pos += 1;
+      if (dfa_set_add_escape(set, pattern[parser->pos])) {
+        parser->pos += 1;
+        continue;
+      }
+      c = pattern[parser->pos];
+    }
+    parser->pos += 1;
+
+    unsigned char low = (unsigned char)c;
+    unsigned char high = low;
+    if (pattern[parser->pos] == '-' && pattern[parser->pos + 1] != ']' &&
+        pattern[parser->pos + 1] != '\0') {
+      high = (unsigned char)pattern[parser->pos + 1];
+      parser->pos += 2;
+      if (high < low) {
+        parser->error = true;
+        return;
+      }
+    }
+
+    for (int b = low; b <= high; b += 1) {
+      dfa_set_add(set, (unsigned char)b);
+    }
+  }
+  parser->pos += 1;
+
+  // '[^a-z]' must not match 'A' either, so fold before negating
+  if (parser->ignore_case) {
+    dfa_set_fold(set);
+  }
+
+  if (negate) {
+    for (int i = 0; i < 32; i += 1) {
+      set[i] = (uint8_t)~set[i];
+    }
+    // a negated set never matches across lines
+    set['\n' / 8] &= (uint8_t) ~(1u << ('\n' % 8));
+  }
+}
+
+/**
+ * Parses a single atom: a literal, '.', a bracket expression, an escape, an
+ * anchor or a group.
+ */
+static fragment_t dfa_parse_atom(dfa_parser_t *parser) {
+  fragment_t fragment = {-1, -1};
+  char c = parser->pattern[parser->pos];
+
+  switch (c) {
+  case '(':
+    parser->pos += 1;
+    fragment = dfa_parse_alternation(parser);
+    if (parser->pattern[parser->pos] != ')') {
+      parser->error = true;
+      return fragment;
+    }
+    parser->pos += 1;
+    return fragment;
+  case '^':
+    parser->pos += 1;
+    return dfa_single(parser, E_NFA_BOL);
+  case '$':
+    parser->pos += 1;
+    return dfa_single(parser, E_NFA_EOL);
+  case '*':
+  case '+':
+  case '?':
+  case '{':
+  case '\0':
+    // nothing to repeat
+    parser->error = true;
+    return fragment;
+  default:
+    break;
+  }
+
+  fragment = dfa_single(parser, E_NFA_SET);
+  if (fragment.start == -1) {
+    return fragment;
+  }
+  uint8_t *set = parser->states[fragment.start].set;
+
+  parser->pos += 1;
+  if (c == '.') {
+    memset(set, 0xFF, 32);
+    set['\n' / 8] &= (uint8_t) ~(1u << ('\n' % 8));
+  } else if (c == '[') {
+    dfa_parse_bracket(parser, set);
+  } else if (c == '\\') {
+    char escaped = parser->pattern[parser->pos];
+    if (escaped == '\0') {
+      parser->error = true;
+      return fragment;
+    }
+    parser->pos += 1;
+
+    if (dfa_set_add_escape(set, escaped) == false) {
+      dfa_set_add(set, (unsigned char)escaped);
+    }
+  } else {
+    dfa_set_add(set, (unsigned char)c);
+  }
+
+  if (parser->ignore_case) {
+    dfa_set_fold(set);
+  }
+
+  return fragment;
+}
+
+/**
+ * Appends fragment b to fragment a.
+ */
+static fragment_t dfa_concat(dfa_parser_t *parser, fragment_t a,
+                             fragment_t b) {
+  parser->states[a.end].out = b.start;
+  a.end = b.end;
+  return a;
+}
+
+/**
+ * Wraps the fragment into a loop: '*' if skippable, '+' otherwise.
+ */
+static fragment_t dfa_loop(dfa_parser_t *parser, fragment_t fragment,
+                           bool skippable) {
+  fragment_t result = {-1, -1};
+
+  int split = dfa_add_state(parser, E_NFA_SPLIT);
+  int end = dfa_add_state(parser, E_NFA_EPSILON);
+  if (split == -1 || end == -1) {
+    return result;
+  }
+
+  parser->states[split].out = fragment.start;
+  parser->states[split].out1 = end;
+  parser->states[fragment.end].out = split;
+
+  result.start = skippable ? split : fragment.start;
+  result.end = end;
+  return result;
+}
+
+/**
+ * Makes the fragment optional ('?').
+ */
+static fragment_t dfa_optional(dfa_parser_t *parser, fragment_t fragment) {
+  fragment_t result = {-1, -1};
+
+  int split = dfa_add_state(parser, E_NFA_SPLIT);
+  if (split == -1) {
+    return result;
+  }
+
+  parser->states[split].out = fragment.start;
+  parser->states[split].out1 = fragment.end;
+
+  result.start = split;
+  result.end = fragment.end;
+  return result;
+}
+
+/**
+ * Parses the numbers of a '{m}', '{m,}' or '{m,n}' repetition, the '{' has
+ * already been consumed.
+ * @param parser the parser
+ * @param min where to store m
+ * @param max where to store n, -1 if there is no upper bound
+ */
+static void dfa_parse_bounds(dfa_parser_t *parser, long *min, long *max) {
+  const char *start = parser->pattern + parser->pos;
+  char *end;
+
+  *min = strtol(start, &end, 10);
+  if (end == start || *min > DFA_MAX_REPEAT) {
+    parser->error = true;
+    return;
+  }
+  *max = *min;
+
+  if (*end == ',') {
+    const char *max_start = end + 1;
+    *max = strtol(max_start, &end, 10);
+    if (end == max_start) {
+      *max = -1;
+    } else if (*max < *min || *max > DFA_MAX_REPEAT) {
+      parser->error = true;
+      return;
+    }
+  }
+
+  if (*end != '}') {
+    parser->error = true;
+    return;
+  }
+  parser->pos = end + 1 - parser->pattern;
+}
+
+/**
+ * Expands a '{m,n}' repetition of the atom that starts at atom_pos.
+ * @details The NFA has no counters, so the atom is parsed again for every
+ * copy that is needed.
+ */
+static fragment_t dfa_repeat(dfa_parser_t *parser, fragment_t atom,
+                             size_t atom_pos, long min, long max) {
+  size_t after = parser->pos;
+  fragment_t result = dfa_empty(parser);
+  fragment_t copy = atom;
+  long copies = max == -1 ? min + 1 : max;
+
+  for (long i = 0; i < copies && parser->error == false; i += 1) {
+    if (i > 0) {
+      parser->pos = atom_pos;
+      copy = dfa_parse_atom(parser);
+      if (parser->error) {
+        break;
+      }
+    }
+
+    if (i >= min) {
+      copy = max == -1 ? dfa_loop(parser, copy, true)
+                       : dfa_optional(parser, copy);
+    }
+    if (result.start == -1 || copy.start == -1) {
+      parser->error = true;
+      break;
+    }
+    result = dfa_concat(parser, result, copy);
+  }
+
+  parser->pos = after;
+  return result;
+}
+
+/**
+ * Parses an atom followed by any number of '*', '+', '?' or a single
+ * '{m,n}'.
+ */
+static fragment_t dfa_parse_repetition(dfa_parser_t *parser) {
+  size_t atom_pos = parser->pos;
+  fragment_t fragment = dfa_parse_atom(parser);
+  bool repeated = false;
+
+  while (parser->error == false && fragment.start != -1) {
+    char c = parser->pattern[parser->pos];
+
+    if (c == '*' || c == '+') {
+      parser->pos += 1;
+      fragment = dfa_loop(parser, fragment, c == '*');
+    } else if (c == '?') {
+      parser->pos += 1;
+      fragment = dfa_optional(parser, fragment);
+    } else if (c == '{' && repeated == false) {
+      long min;
+      long max;
+      parser->pos += 1;
+      dfa_parse_bounds(parser, &min, &max);
+      if (parser->error) {
+        break;
+      }
+      fragment = dfa_repeat(parser, fragment, atom_pos, min, max);
+    } else {
+      break;
+    }
+
+    repeated = true;
+  }
+
+  if (fragment.start == -1) {
+    parser->error = true;
+  }
+
+  return fragment;
+}
+
+/**
+ * Parses a sequence of repetitions up to the next '|' or ')'.
+ */
+static fragment_t dfa_parse_concatenation(dfa_parser_t *parser) {
+  fragment_t fragment = dfa_empty(parser);
+
+  while (parser->error == false) {
+    char c = parser->pattern[parser->pos];
+    if (c == '\0' || c == '|' || c == ')') {
+      break;
+    }
+
+    fragment_t next = dfa_parse_repetition(parser);
+    if (parser->error) {
+      break;
+    }
+    fragment = dfa_concat(parser, fragment, next);
+  }
+
+  return fragment;
+}
+
+/**
+ * Parses concatenations separated by '|'.
+ */
+static fragment_t dfa_parse_alternation(dfa_parser_t *parser) {
+  fragment_t fragment = dfa_parse_concatenation(parser);
+
+  while (parser->error == false && parser->pattern[parser->pos] == '|') {
+    parser->pos += 1;
+    fragment_t other = dfa_parse_concatenation(parser);
+    if (parser->error) {
+      break;
+    }
+
+    int split = dfa_add_state(parser, E_NFA_SPLIT);
+    int end = dfa_add_state(parser, E_NFA_EPSILON);
+    if (split == -1 || end == -1) {
+      break;
+    }
+
+    parser->states[split].out = fragment.start;
+    parser->states[split].out1 = other.start;
+    parser->states[fragment.end].out = end;
+    parser->states[other.end].out = end;
+
+    fragment.start = split;
+    fragment.end = end;
+  }
+
+  return fragment;
+}
+
+/**
+ * Extracts the literal every match has to start with.
+ * @details Only looks at the start of the expression and gives up at the
+ * first special character. A literal that is followed by '*', '?' or '{' is
+ * not required and therefore dropped. Expressions with an alternation don't
+ * have a common prefix.
+ * @param pattern the expression
+ * @return Returns the prefix (which may be empty) or NULL.
+ */
+static char *dfa_extract_prefix(const char *pattern) {
+  if (strchr(pattern, '|') != NULL) {
+    return strdup("");
+  }
+
+  char *prefix = malloc(strlen(pattern) + 1);
+  if (prefix == NULL) {
+    return NULL;
+  }
+
+  size_t pos = 0;
+  size_t len = 0;
+  if (pattern[pos] == '^') {
+    pos += 1;
+  }
+
+  while (pattern[pos] != '\0') {
+    char c = pattern[pos];
+    size_t step = 1;
+
+    if (c == '\\') {
+      c = pattern[pos + 1];
+      // only escaped punctuation is a literal, \d and friends are sets
+      if (c == '\0' || isalnum((unsigned char)c)) {
+        break;
+      }
+      step = 2;
+    } else if (strchr(".[]()*+?{}|^$", c) != NULL) {
+      break;
+    }
+
+    char next = pattern[pos + step];
+    if (next == '*' || next == '?' || next == '{') {
+      break;
+    }
+
+    prefix[len] = c;
+    len += 1;
+    pos += step;
+  }
+
+  prefix[len] = '\0';
+  return prefix;
+}
+
+/**
+ * Folds the two byte UTF-8 characters of the expression in place.
+ * @details ASCII letters are left alone, they are folded in the sets by
+ * 'dfa_set_fold' and folding them here would turn '\\D' into '\\d'.
+ */
+static void dfa_fold_pattern(char *pattern) {
+  unsigned char *str = (unsigned char *)pattern;
+  size_t len = strlen(pattern);
+
+  size_t i = 0;
+  while (i < len) {
+    if (str[i] < 0x80) {
+      i += 1;
+      continue;
+    }
+    i += search_fold_char(str + i, len - i, str + i);
+  }
+}
+
+/**
+ * Compiles the expression, see 'dfa_compile'.
+ * @param pattern the expression, its non ASCII characters already folded if
+ * 'fold_utf8' is set
+ */
+static int dfa_compile_pattern(dfa_t *dfa, const char *pattern,
+                               bool ignore_case) {
+  dfa_parser_t parser;
+  parser.pattern = pattern;
+  parser.pos = 0;
+  parser.ignore_case = ignore_case;
+  parser.error = false;
+  parser.states = NULL;
+  parser.states_num = 0;
+  parser.states_capacity = 0;
+
+  fragment_t fragment = dfa_parse_alternation(&parser);
+  if (parser.error == false && pattern[parser.pos] != '\0') {
+    // unbalanced ')'
+    parser.error = true;
+  }
+
+  int match = -1;
+  if (parser.error == false) {
+    match = dfa_add_state(&parser, E_NFA_MATCH);
+  }
+  if (parser.error || match == -1) {
+    free(parser.states);
+    return -1;
+  }
+  parser.states[fragment.end].out = match;
+
+  dfa->states = parser.states;
+  dfa->states_num = parser.states_num;
+  dfa->start = fragment.start;
+
+  dfa->prefix = dfa_extract_prefix(pattern);
+  if (dfa->prefix == NULL) {
+    free(dfa->states);
+    return -1;
+  }
+  dfa->has_prefix = dfa->prefix[0] != '\0';
+  if (ignore_case) {
+    search_fold(dfa->prefix);
+  }
+  search_init(&dfa->prefix_search, dfa->prefix, ignore_case);
+
+  // the caches of the worker threads are freed when the threads exit
+  if (pthread_key_create(&dfa->cache_key, dfa_cache_free) != 0) {
+    free(dfa->prefix);
+    free(dfa->states);
+    return -1;
+  }
+
+  return 0;
+}
+
+int dfa_compile(dfa_t *dfa, const char *pattern, bool ignore_case) {
+  bool non_ascii = false;
+  for (const char *c = pattern; *c != '\0'; c += 1) {
+    non_ascii = non_ascii || (unsigned char)*c >= 0x80;
+  }
+
+  // an ASCII expression can't tell folded UTF-8 from unfolded UTF-8
+  dfa->fold_utf8 = ignore_case && non_ascii;
+  if (dfa->fold_utf8 == false) {
+    return dfa_compile_pattern(dfa, pattern, ignore_case);
+  }
+
+  char *folded = strdup(pattern);
+  if (folded == NULL) {
+    return -1;
+  }
+  dfa_fold_pattern(folded);
+
+  int result = dfa_compile_pattern(dfa, folded, ignore_case);
+  free(folded);
+
+  return result;
+}
+
+/**
+ * Frees a cache and all of its states.
+ * @param arg pointer to the dfa_cache_t
+ */
+static void dfa_cache_free(void *arg) {
+  dfa_cache_t *cache = arg;
+  if (cache == NULL) {
+    return;
+  }
+
+  for (int i = 0; i < cache->states_num; i += 1) {
+    free(cache->states[i].nfa);
+  }
+
+  free(cache->states);
+  free(cache->mark);
+  free(cache->stack);
+  free(cache->set);
+  free(cache);
+}
+
+/**
+ * Drops all cached DFA states.
+ */
+static void dfa_cache_clear(dfa_cache_t *cache) {
+  for (int i = 0; i < cache->states_num; i += 1) {
+    free(cache->states[i].nfa);
+  }
+
+  cache->states_num = 0;
+  cache->line_start = DFA_UNKNOWN;
+  for (int i = 0; i < DFA_HASH_SIZE; i += 1) {
+    cache->hash[i] = -1;
+  }
+}
+
+/**
+ * Returns the cache of the calling thread and creates it if needed.
+ * @return Returns the cache or NULL if the allocation failed.
+ */
+static dfa_cache_t *dfa_cache_get(const dfa_t *dfa) {
+  dfa_cache_t *cache = pthread_getspecific(dfa->cache_key);
+  if (cache != NULL) {
+    return cache;
+  }
+
+  cache = malloc(sizeof(dfa_cache_t));
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  cache->states = malloc(DFA_MAX_STATES * sizeof(dfa_state_t));
+  cache->mark = calloc(dfa->states_num, sizeof(int));
+  // a state can be pushed once per incoming edge, at most two per state
+  cache->stack = malloc((2 * dfa->states_num + 1) * sizeof(int));
+  cache->set = malloc(dfa->states_num * sizeof(int));
+  cache->states_num = 0;
+  cache->generation = 0;
+  if (cache->states == NULL || cache->mark == NULL || cache->stack == NULL ||
+      cache->set == NULL || pthread_setspecific(dfa->cache_key, cache) != 0) {
+    dfa_cache_free(cache);
+    return NULL;
+  }
+
+  dfa_cache_clear(cache);
+  return cache;
+}
+
+/**
+ * Adds the epsilon closure of an NFA state to the set that is built.
+ * @details Only states that read a byte, the pending '$' anchors and the match
+ * state are kept in the set, everything else is just passed through.
+ * @param dfa the compiled expression
+ * @param cache the cache of the calling thread
+ * @param start the NFA state to start at
+ * @param at_line_start if '^' is passable
+ * @param at_line_end if '$' is passable
+ */
+static void dfa_closure(const dfa_t *dfa, dfa_cache_t *cache, int start,
+                        bool at_line_start, bool at_line_end) {
+  int top = 0;
+  cache->stack[top] = start;
+  top += 1;
+
+  while (top > 0) {
+    top -= 1;
+    int index = cache->stack[top];
+    if (index == -1 || cache->mark[index] == cache->generation) {
+      continue;
+    }
+    cache->mark[index] = cache->generation;
+
+    const nfa_state_t *state = &dfa->states[index];
+    switch (state->type) {
+    case E_NFA_SPLIT:
+      cache->stack[top] = state->out1;
+      top += 1;
+      cache->stack[top] = state->out;
+      top += 1;
+      break;
+    case E_NFA_EPSILON:
+      cache->stack[top] = state->out;
+      top += 1;
+      break;
+    case E_NFA_BOL:
+      if (at_line_start) {
+        cache->stack[top] = state->out;
+        top += 1;
+      }
+      break;
+    case E_NFA_EOL:
+      if (at_line_end) {
+        cache->stack[top] = state->out;
+        top += 1;
+      } else {
+        cache->set[cache->set_num] = index;
+        cache->set_num += 1;
+      }
+      break;
+    case E_NFA_SET:
+    case E_NFA_MATCH:
+      cache->set[cache->set_num] = index;
+      cache->set_num += 1;
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+/**
+ * Starts a new set, every NFA state can be added once per set.
+ */
+static void dfa_set_begin(dfa_cache_t *cache) {
+  cache->generation += 1;
+  cache->set_num = 0;
+}
+
+/**
+ * Compares two NFA state indices for qsort.
+ */
+static int dfa_compare_index(const void *a, const void *b) {
+  int left = *(const int *)a;
+  int right = *(const int *)b;
+  return (left > right) - (left < right);
+}
+
+/**
+ * Checks if the pending '$' anchors of a set lead to a match.
+ */
+static bool dfa_accepts_at_eol(const dfa_t *dfa, dfa_cache_t *cache,
+                               const int *set, int set_num) {
+  bool found = false;
+
+  dfa_set_begin(cache);
+  for (int i = 0; i < set_num; i += 1) {
+    if (dfa->states[set[i]].type == E_NFA_EOL) {
+      dfa_closure(dfa, cache, set[i], false, true);
+    }
+  }
+
+  for (int i = 0; i < cache->set_num; i += 1) {
+    if (dfa->states[cache->set[i]].type == E_NFA_MATCH) {
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * Looks up the DFA state of the set that has just been built and creates it
+ * if it doesn't exist yet.
+ * @return Returns the index of the DFA state, DFA_UNKNOWN if the cache is full
+ * and -2 if an allocation failed.
+ */
+static int dfa_state_for_set(const dfa_t *dfa, dfa_cache_t *cache) {
+  qsort(cache->set, cache->set_num, sizeof(int), dfa_compare_index);
+
+  uint32_t hash = 2166136261u;
+  for (int i = 0; i < cache->set_num; i += 1) {
+    hash = (hash ^ (uint32_t)cache->set[i]) * 16777619u;
+  }
+
+  uint32_t slot = hash & (DFA_HASH_SIZE - 1);
+  while (cache->hash[slot] != -1) {
+    const dfa_state_t *state = &cache->states[cache->hash[slot]];
+    if (state->nfa_num == cache->set_num &&
+        memcmp(state->nfa, cache->set, cache->set_num * sizeof(int)) == 0) {
+      return cache->hash[slot];
+    }
+    slot = (slot + 1) & (DFA_HASH_SIZE - 1);
+  }
+
+  if (cache->states_num >= DFA_MAX_STATES) {
+    return DFA_UNKNOWN;
+  }
+
+  dfa_state_t *state = &cache->states[cache->states_num];
+  state->nfa_num = cache->set_num;
+  state->nfa = malloc((cache->set_num + 1) * sizeof(int));
+  if (state->nfa == NULL) {
+    return -2;
+  }
+  memcpy(state->nfa, cache->set, cache->set_num * sizeof(int));
+
+  state->accepting = false;
+  for (int i = 0; i < state->nfa_num; i += 1) {
+    if (dfa->states[state->nfa[i]].type == E_NFA_MATCH) {
+      state->accepting = true;
+    }
+  }
+  for (int i = 0; i < 256; i += 1) {
+    state->next[i] = DFA_UNKNOWN;
+  }
+
+  // invalidates cache->set
+  state->eol_accepting =
+      dfa_accepts_at_eol(dfa, cache, state->nfa, state->nfa_num);
+
+  cache->hash[slot] = cache->states_num;
+  cache->states_num += 1;
+  return cache->states_num - 1;
+}
+
+/**
+ * Returns the DFA state at the start of a line.
+ * @return Returns the index of the state or -2 if an allocation failed.
+ */
+static int dfa_line_start(const dfa_t *dfa, dfa_cache_t *cache) {
+  if (cache->line_start != DFA_UNKNOWN) {
+    return cache->line_start;
+  }
+
+  for (int attempt = 0; attempt < 2; attempt += 1) {
+    dfa_set_begin(cache);
+    dfa_closure(dfa, cache, dfa->start, true, false);
+
+    int state = dfa_state_for_set(dfa, cache);
+    if (state != DFA_UNKNOWN) {
+      cache->line_start = state;
+      return state;
+    }
+    dfa_cache_clear(cache);
+  }
+
+  return -2;
+}
+
+/**
+ * Computes the transition of a DFA state on a byte.
+ * @details If the cache is full it is cleared and the source state is built
+ * again, so the returned index is valid in the new cache.
+ * @return Returns the index of the next state or -2 if an allocation failed.
+ */
+static int dfa_step(const dfa_t *dfa, dfa_cache_t *cache, int from,
+                    unsigned char c) {
+  int *source = cache->states[from].nfa;
+  int source_num = cache->states[from].nfa_num;
+  bool cleared = false;
+
+  while (true) {
+    dfa_set_begin(cache);
+    for (int i = 0; i < source_num; i += 1) {
+      const nfa_state_t *state = &dfa->states[source[i]];
+      if (state->type == E_NFA_SET && dfa_set_has(state->set, c)) {
+        dfa_closure(dfa, cache, state->out, false, false);
+      }
+    }
+    // unanchored search, a match may start at every byte
+    dfa_closure(dfa, cache, dfa->start, false, false);
+
+    int next = dfa_state_for_set(dfa, cache);
+    if (next == -2) {
+      return next;
+    }
+    if (next != DFA_UNKNOWN) {
+      if (cleared == false) {
+        cache->states[from].next[c] = next;
+      }
+      if (cleared) {
+        free(source);
+      }
+      return next;
+    }
+
+    if (cleared) {
+      // a single set can always be stored in an empty cache
+      free(source);
+      return -2;
+    }
+
+    // the cache is full, keep the source set alive and start over
+    int *copy = malloc((source_num + 1) * sizeof(int));
+    if (copy == NULL) {
+      return -2;
+    }
+    memcpy(copy, source, source_num * sizeof(int));
+    source = copy;
+
+    dfa_cache_clear(cache);
+    cleared = true;
+  }
+}
+
+/**
+ * Runs the DFA over the haystack, see 'dfa_find'.
+ */
+static const char *dfa_scan(const dfa_t *dfa, dfa_cache_t *cache,
+                            const char *haystack, size_t haystack_len) {
+  int line_start = dfa_line_start(dfa, cache);
+  if (line_start < 0) {
+    return NULL;
+  }
+
+  const unsigned char *hay = (const unsigned char *)haystack;
+  const bool fold_utf8 = dfa->fold_utf8;
+  // the folded character, its second byte is fed in the next step
+  unsigned char folded[2];
+  bool pending = false;
+
+  int state = line_start;
+  for (size_t i = 0; i < haystack_len; i += 1) {
+    const dfa_state_t *current = &cache->states[state];
+    if (current->accepting) {
+      return haystack + i;
+    }
+
+    unsigned char c = hay[i];
+    if (fold_utf8) {
+      if (pending) {
+        c = folded[1];
+        pending = false;
+      } else if (c >= 0x80) {
+        pending = search_fold_char(hay + i, haystack_len - i, folded) == 2;
+        c = folded[0];
+      }
+    }
+
+    if (c == '\n') {
+      if (current->eol_accepting) {
+        return haystack + i;
+      }
+
+      // clearing the cache may have moved the state of the line start
+      state = dfa_line_start(dfa, cache);
+      if (state < 0) {
+        return NULL;
+      }
+      continue;
+    }
+
+    int next = current->next[c];
+    if (next == DFA_UNKNOWN) {
+      next = dfa_step(dfa, cache, state, c);
+      if (next < 0) {
+        return NULL;
+      }
+    }
+    state = next;
+  }
+
+  // the last line may end without a newline
+  if (haystack_len > 0 && haystack[haystack_len - 1] != '\n') {
+    const dfa_state_t *current = &cache->states[state];
+    if (current->accepting || current->eol_accepting) {
+      return haystack + haystack_len - 1;
+    }
+  }
+
+  return NULL;
+}
+
+const char *dfa_find(const dfa_t *dfa, const char *haystack,
+                     size_t haystack_len) {
+  dfa_cache_t *cache = dfa_cache_get(dfa);
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  if (dfa->has_prefix == false) {
+    return dfa_scan(dfa, cache, haystack, haystack_len);
+  }
+
+  // only lines that contain the prefix can match
+  const char *current = haystack;
+  const char *end = haystack + haystack_len;
+  while (current < end) {
+    const char *hit = search_find(&dfa->prefix_search, current, end - current);
+    if (hit == NULL) {
+      return NULL;
+    }
+
+    const char *line_start = hit;
+    while (line_start > current && line_start[-1] != '\n') {
+      line_start -= 1;
+    }
+    const char *line_end = memchr(hit, '\n', end - hit);
+    line_end = line_end == NULL ? end : line_end + 1;
+
+    const char *found = dfa_scan(dfa, cache, line_start, line_end - line_start);
+    if (found != NULL) {
+      return found;
+    }
+
+    current = line_end;
+  }
+
+  return NULL;
+}
+
+void dfa_free(dfa_t *dfa) {
+  dfa_cache_free(pthread_getspecific(dfa->cache_key));
+  pthread_setspecific(dfa->cache_key, NULL);
+  pthread_key_delete(dfa->cache_key);
+
+  free(dfa->prefix);
+  free(dfa->states);
+}
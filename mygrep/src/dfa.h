@@ -0,0 +1,86 @@
+/**
+ * @file dfa.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a regular expression engine based on a lazily built DFA.
+ */
+
+#ifndef _DFA_H
+#define _DFA_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "search.h"
+
+/**
+ * @brief Type of a state of the nondeterministic automaton.
+ */
+typedef enum NFA_TYPE {
+  E_NFA_EPSILON, ///< continues with 'out' without reading a byte
+  E_NFA_SPLIT,   ///< continues with 'out' and 'out1' without reading a byte
+  E_NFA_SET,     ///< reads one byte of 'set' and continues with 'out'
+  E_NFA_BOL,     ///< continues with 'out' at the start of a line ('^')
+  E_NFA_EOL,     ///< continues with 'out' at the end of a line ('$')
+  E_NFA_MATCH    ///< the expression has matched
+} nfa_type_e;
+
+typedef struct nfa_state {
+  nfa_type_e type; ///< what the state does
+  int out;         ///< next state, -1 while the fragment is not finished
+  int out1;        ///< second next state of E_NFA_SPLIT
+  uint8_t set[32]; ///< bitmap of the bytes E_NFA_SET accepts
+} nfa_state_t;
+
+typedef struct dfa {
+  nfa_state_t *states; ///< the compiled nondeterministic automaton
+  int states_num;      ///< how many states there are
+  int start;           ///< index of the start state
+  bool fold_utf8;      ///< 'true' if two byte UTF-8 input is folded for '-i'
+
+  bool has_prefix; ///< 'true' if every match starts with 'prefix'
+  char *prefix;    ///< literal every match starts with, used as prefilter
+  search_t prefix_search; ///< prepared search for 'prefix'
+
+  pthread_key_t cache_key; ///< every thread builds its own DFA states
+} dfa_t;
+
+/**
+ * Compiles an extended regular expression.
+ * @brief Supports literals, '.', bracket expressions (with ranges, negation and
+ * [:class:] names), the escapes \\d \\w \\s and their negations, grouping,
+ * alternation, '*', '+', '?', '{m}', '{m,}', '{m,n}', '^' and '$'. Bytes are
+ * matched one by one, '.' matches a single byte. With ignore_case the two byte
+ * UTF-8 characters of the expression and the haystack are folded with
+ * 'search_fold_char', like the prefix is.
+ * @param dfa the dfa_t that should be initialized.
+ * @param pattern the NUL terminated expression
+ * @param ignore_case 'true' if letters should match both cases
+ * @return Returns 0 if non error has been encountered and -1 if the expression
+ * is invalid.
+ */
+int dfa_compile(dfa_t *dfa, const char *pattern, bool ignore_case);
+
+/**
+ * Finds the first line in the haystack that contains a match.
+ * @brief The haystack is scanned once without backtracking. The DFA states
+ * are built on demand and cached per thread, the cache is cleared when it is
+ * full.
+ * @param dfa a compiled dfa_t
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes
+ * @return Returns a pointer into the first matching line or NULL.
+ */
+const char *dfa_find(const dfa_t *dfa, const char *haystack,
+                     size_t haystack_len);
+
+/**
+ * Frees the given dfa_t and the DFA states of the calling thread.
+ * @param dfa the dfa_t that should be freed.
+ */
+void dfa_free(dfa_t *dfa);
+
+#endif /* _DFA_H */
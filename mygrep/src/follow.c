@@ -0,0 +1,561 @@
+/**
+ * @file follow.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a search of files that are still being written to.
+ *
+ * @details Every followed file has a watch of its own for modifications and
+ * shares a watch of its directory with the other files in it. The directory
+ * tells when a file is created or moved in under the followed name, which is
+ * how a rotated log file shows up.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "arguments.h"
+#include "follow.h"
+#include "logic.h"
+#include "output.h"
+#include "search.h"
+#include "stats.h"
+
+/**
+ * Size the read buffer starts with, it only grows for longer lines.
+ */
+#define FOLLOW_BUFFER_SIZE (256 * 1024)
+
+/**
+ * Events of a followed file.
+ */
+#define FOLLOW_FILE_EVENTS (IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/**
+ * Events of the directory of a followed file.
+ */
+#define FOLLOW_DIR_EVENTS (IN_CREATE | IN_MOVED_TO)
+
+/**
+ * @brief A followed file.
+ */
+typedef struct follow_file {
+  const char *path;   ///< path of the file as given on the command line
+  const char *base;   ///< name of the file inside its directory
+  int fd;             ///< the opened file or -1 if it doesn't exist (yet)
+  int wd;             ///< watch of the file or -1
+  int dir_wd;         ///< watch of the directory of the file
+  off_t offset;       ///< everything before has been searched
+  long line;          ///< line number of the line at 'offset' ('-n')
+  bool done;          ///< 'true' if the file is finished ('-l', '-m')
+  file_state_t state; ///< the state of the search, kept across reads
+} follow_file_t;
+
+/**
+ * @brief State of the event loop.
+ */
+typedef struct follow {
+  arguments_t *args;    ///< the arguments of the search
+  int inotify;          ///< the inotify instance of all watches
+  follow_file_t *files; ///< the followed files
+  int files_num;        ///< how many files there are
+  int active;           ///< how many files are not finished yet
+  char *buffer;         ///< shared read buffer
+  size_t capacity;      ///< size of buffer in bytes
+} follow_t;
+
+/**
+ * Checks if nothing more of a file has to be searched.
+ */
+static bool follow_is_done(const arguments_t *args,
+                           const file_state_t *state) {
+  if (args->max_count >= 0 && state->matches >= args->max_count) {
+    return true;
+  }
+
+  return state->matches > 0 &&
+         (args->output_mode == E_OUTPUT_FILES_WITH_MATCHES || state->binary);
+}
+
+/**
+ * Records the statistics of a file that isn't followed any longer
+ * ('--stats').
+ * @return Returns 0 if non error has been encountered.
+ */
+static int follow_record(follow_t *follow, follow_file_t *file) {
+  if (follow->args->stats == false) {
+    return 0;
+  }
+
+  file->state.stats.matches = file->state.matches;
+  return stats_add(file->path, &file->state.stats);
+}
+
+/**
+ * Stops following a file and emits its summary.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int follow_finish(follow_t *follow, follow_file_t *file) {
+  if (file->wd != -1) {
+    inotify_rm_watch(follow->inotify, file->wd);
+    file->wd = -1;
+  }
+  if (file->fd != -1) {
+    close(file->fd);
+    file->fd = -1;
+  }
+
+  file->done = true;
+  follow->active -= 1;
+
+  if (follow_record(follow, file) != 0) {
+    return -1;
+  }
+
+  return process_finish(follow->args, &file->state);
+}
+
+/**
+ * Searches complete lines of the read buffer.
+ * @details A keyword with a newline only matches at the end of a line, so the
+ * lines are then searched one by one like a stream does.
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int follow_search(follow_t *follow, follow_file_t *file, size_t len) {
+  arguments_t *args = follow->args;
+  char *buffer = follow->buffer;
+
+  file_state_seek(&file->state, buffer, file->offset, file->line);
+
+  if (args->matcher.multiline == false) {
+    return process_buffer(buffer, len, args, &file->state);
+  }
+
+  size_t start = 0;
+  while (start < len && follow_is_done(args, &file->state) == false) {
+    const char *end = memchr(buffer + start, '\n', len - start);
+    size_t line_end = end == NULL ? len : (size_t)(end - buffer) + 1;
+
+    int result =
+        process_buffer(buffer + start, line_end - start, args, &file->state);
+    if (result != 0) {
+      return result;
+    }
+    start = line_end;
+  }
+
+  return 0;
+}
+
+/**
+ * Searches everything that has been appended to a file since it has been read
+ * the last time.
+ * @param follow the event loop
+ * @param file the file to read
+ * @param final 'true' if the file is read for the last time, a line without a
+ * newline at its end is then searched as well
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int follow_read(follow_t *follow, follow_file_t *file, bool final) {
+  arguments_t *args = follow->args;
+
+  if (file->fd == -1 || file->done) {
+    return 0;
+  }
+
+  struct stat file_stat;
+  if (fstat(file->fd, &file_stat) == -1) {
+    return -1;
+  }
+
+  if (file_stat.st_size < file->offset) {
+    fprintf(stderr, "%s: file truncated\n", file->path);
+    file->offset = 0;
+    file->line = 1;
+  }
+
+  while (file->offset < file_stat.st_size) {
+    size_t left = file_stat.st_size - file->offset;
+    size_t want = left < follow->capacity ? left : follow->capacity;
+
+    long long started = args->stats ? stats_now() : 0;
+    ssize_t len = pread(file->fd, follow->buffer, want, file->offset);
+    if (args->stats) {
+      file->state.stats.io_ns += stats_now() - started;
+    }
+    if (len == -1 && errno == EINTR) {
+      continue;
+    }
+    if (len == -1) {
+      return -1;
+    }
+    if (len == 0) {
+      break;
+    }
+
+    // the last line may still be written
+    size_t complete = len;
+    while (complete > 0 && follow->buffer[complete - 1] != '\n') {
+      complete -= 1;
+    }
+
+    if (complete == 0 && final) {
+      complete = len;
+    } else if (complete == 0 && (size_t)len < left) {
+      // a line longer than the buffer
+      char *grown = realloc(follow->buffer, follow->capacity * 2);
+      if (grown == NULL) {
+        return -1;
+      }
+      follow->buffer = grown;
+      follow->capacity *= 2;
+      continue;
+    } else if (complete == 0) {
+      break;
+    }
+
+    if (args->binary_files != E_BINARY_TEXT &&
+        file->state.probed < PROCESS_BINARY_PROBE) {
+      file->state.probed += complete;
+      if (process_is_binary(follow->buffer, complete)) {
+        if (args->binary_files == E_BINARY_SKIP) {
+          return follow_finish(follow, file);
+        }
+        file->state.binary = true;
+        file->state.probed = PROCESS_BINARY_PROBE;
+      }
+    }
+
+    started = args->stats ? stats_now() : 0;
+    int result = follow_search(follow, file, complete);
+    long long searched = args->stats ? stats_now() : 0;
+
+    // the output references the buffer, which is overwritten by the next read
+    if (output_flush() != 0) {
+      return -1;
+    }
+    if (args->stats) {
+      file->state.stats.match_ns += searched - started;
+      file->state.stats.output_ns += stats_now() - searched;
+    }
+    if (result != 0) {
+      return result;
+    }
+
+    if (follow_is_done(args, &file->state)) {
+      return follow_finish(follow, file);
+    }
+
+    if (args->line_numbers) {
+      file->line += search_count_newlines(follow->buffer, complete);
+    }
+    file->offset += complete;
+  }
+
+  return 0;
+}
+
+/**
+ * Moves the offset of a file behind its last complete line.
+ * @details Without '-n' the file is read backwards from its end, with '-n'
+ * every line before has to be counted anyway.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int follow_skip(follow_t *follow, follow_file_t *file) {
+  struct stat file_stat;
+  if (fstat(file->fd, &file_stat) == -1) {
+    return -1;
+  }
+
+  file->offset = 0;
+  file->line = 1;
+
+  off_t position = follow->args->line_numbers ? 0 : file_stat.st_size;
+  long lines = 0;
+  while (follow->args->line_numbers ? position < file_stat.st_size
+                                    : position > 0) {
+    size_t len = follow->capacity;
+    off_t from = position;
+    if (follow->args->line_numbers == false) {
+      len = position < (off_t)len ? (size_t)position : len;
+      from = position - len;
+    }
+
+    ssize_t read = pread(file->fd, follow->buffer, len, from);
+    if (read == -1 && errno == EINTR) {
+      continue;
+    }
+    if (read <= 0) {
+      return read == 0 ? 0 : -1;
+    }
+
+    size_t last = read;
+    while (last > 0 && follow->buffer[last - 1] != '\n') {
+      last -= 1;
+    }
+
+    if (follow->args->line_numbers) {
+      lines += search_count_newlines(follow->buffer, read);
+      if (last > 0) {
+        file->offset = from + last;
+        file->line = 1 + lines;
+      }
+      position += read;
+    } else if (last > 0) {
+      file->offset = from + last;
+      return 0;
+    } else {
+      position = from;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Opens a followed file and watches it.
+ * @param follow the event loop
+ * @param file the file to open
+ * @param at_end 'true' if only what is appended from now on is searched,
+ * otherwise the whole file is
+ * @return Returns 0 if the file is followed, 1 if it doesn't exist and -1 on
+ * error.
+ */
+static int follow_open(follow_t *follow, follow_file_t *file, bool at_end) {
+  file->fd = open(file->path, O_RDONLY | O_CLOEXEC);
+  if (file->fd == -1) {
+    return errno == ENOENT ? 1 : -1;
+  }
+
+  struct stat file_stat;
+  if (fstat(file->fd, &file_stat) == -1 ||
+      S_ISREG(file_stat.st_mode) == false) {
+    close(file->fd);
+    file->fd = -1;
+    errno = EINVAL;
+    return -1;
+  }
+
+  file->wd = inotify_add_watch(follow->inotify, file->path, FOLLOW_FILE_EVENTS);
+  if (file->wd == -1) {
+    close(file->fd);
+    file->fd = -1;
+    return -1;
+  }
+
+  if (at_end) {
+    return follow_skip(follow, file);
+  }
+
+  file->offset = 0;
+  file->line = 1;
+
+  return 0;
+}
+
+/**
+ * Starts to follow a file and watches its directory.
+ * @return Returns 0 if the file is followed and -1 on error.
+ */
+static int follow_add(follow_t *follow, follow_file_t *file, const char *path) {
+  file->path = path;
+  file->fd = -1;
+  file->wd = -1;
+  file->done = false;
+  file_state_init(&file->state, path, NULL);
+
+  const char *slash = strrchr(path, '/');
+  file->base = slash == NULL ? path : slash + 1;
+
+  // the directory is only needed to watch it
+  char *dir = strdup(slash == NULL ? "." : path);
+  if (dir == NULL) {
+    return -1;
+  }
+  if (slash != NULL) {
+    dir[slash == path ? 1 : slash - path] = '\0';
+  }
+  file->dir_wd = inotify_add_watch(follow->inotify, dir, FOLLOW_DIR_EVENTS);
+  free(dir);
+  if (file->dir_wd == -1) {
+    return -1;
+  }
+
+  int opened = follow_open(follow, file, true);
+  if (opened == 1) {
+    fprintf(stderr, "%s: waiting for the file to be created\n", path);
+    return 0;
+  }
+
+  return opened;
+}
+
+/**
+ * Switches to the file that has been created under the name of a followed
+ * file. The rest of the old file is searched first.
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int follow_replace(follow_t *follow, follow_file_t *file) {
+  if (file->fd != -1) {
+    int result = follow_read(follow, file, true);
+    if (result != 0 || file->done) {
+      return result;
+    }
+
+    if (file->wd != -1) {
+      inotify_rm_watch(follow->inotify, file->wd);
+      file->wd = -1;
+    }
+    close(file->fd);
+    file->fd = -1;
+
+    fprintf(stderr, "%s: file replaced, following the new file\n",
+            file->path);
+  }
+
+  int opened = follow_open(follow, file, false);
+  if (opened == 1) {
+    // already gone again, wait for the next one
+    return 0;
+  }
+  if (opened != 0) {
+    return -1;
+  }
+
+  return follow_read(follow, file, false);
+}
+
+/**
+ * Handles one event of the inotify instance.
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int follow_event(follow_t *follow, const struct inotify_event *event) {
+  for (int i = 0; i < follow->files_num; i += 1) {
+    follow_file_t *file = &follow->files[i];
+    int result = 0;
+
+    if (file->done) {
+      continue;
+    }
+
+    if (event->mask & IN_Q_OVERFLOW) {
+      // events have been lost, every file could have changed
+      result = follow_read(follow, file, false);
+    } else if (event->wd == file->wd) {
+      if (event->mask & IN_MODIFY) {
+        result = follow_read(follow, file, false);
+      }
+      // the old file is kept open, its writer may not have noticed yet
+      if (event->mask & IN_IGNORED) {
+        file->wd = -1;
+      } else if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF)) {
+        inotify_rm_watch(follow->inotify, file->wd);
+        file->wd = -1;
+      }
+    } else if (event->wd == file->dir_wd && event->len > 0 &&
+               (event->mask & FOLLOW_DIR_EVENTS) &&
+               strcmp(event->name, file->base) == 0) {
+      result = follow_replace(follow, file);
+    }
+
+    if (result != 0) {
+      return result;
+    }
+  }
+
+  return 0;
+}
+
+int follow_files(arguments_t *args) {
+  follow_t follow;
+  follow.args = args;
+  follow.files_num = args->input_files_num;
+  follow.active = args->input_files_num;
+  follow.capacity = FOLLOW_BUFFER_SIZE;
+  follow.buffer = malloc(follow.capacity * sizeof(char));
+  follow.files = malloc(follow.files_num * sizeof(follow_file_t));
+  follow.inotify = inotify_init1(IN_CLOEXEC);
+
+  int result = 0;
+  if (follow.buffer == NULL || follow.files == NULL || follow.inotify == -1) {
+    result = -1;
+    follow.files_num = 0;
+  }
+
+  for (int i = 0; i < follow.files_num; i += 1) {
+    if (follow_add(&follow, &follow.files[i], args->input_files[i]) != 0) {
+      fprintf(stderr, "Failed to follow the file %s: %s\n",
+              args->input_files[i], strerror(errno));
+      follow.files_num = i;
+      result = -1;
+      break;
+    }
+
+    // '-m 0'
+    if (follow_is_done(args, &follow.files[i].state) &&
+        follow_finish(&follow, &follow.files[i]) != 0) {
+      follow.files_num = i + 1;
+      result = -1;
+      break;
+    }
+  }
+
+  // aligned like the events inside it
+  char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+  while (result == 0 && follow.active > 0) {
+    if (output_flush() != 0) {
+      result = -1;
+      break;
+    }
+
+    ssize_t len = read(follow.inotify, events, sizeof(events));
+    if (len == -1 && errno == EINTR) {
+      continue;
+    }
+    if (len <= 0) {
+      result = -1;
+      break;
+    }
+
+    for (char *current = events; current < events + len;) {
+      const struct inotify_event *event = (struct inotify_event *)current;
+
+      result = follow_event(&follow, event);
+      if (result != 0) {
+        break;
+      }
+
+      current += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  for (int i = 0; i < follow.files_num; i += 1) {
+    if (follow.files[i].fd != -1) {
+      close(follow.files[i].fd);
+    }
+    if (follow.files[i].done == false &&
+        follow_record(&follow, &follow.files[i]) != 0) {
+      result = -1;
+    }
+  }
+  if (follow.inotify != -1) {
+    close(follow.inotify);
+  }
+  free(follow.files);
+  free(follow.buffer);
+
+  return result;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file follow.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a search of files that are still being written to.
+ */
+
+#ifndef _FOLLOW_H
+#define _FOLLOW_H
+
+#include "arguments.h"
+
+/**
+ * Follows all input files and searches what is appended to them.
+ * @brief The search starts behind the last complete line of every file, like
+ * 'tail -n 0 -F'. All files are watched by a single inotify instance, a file
+ * is only read again after it has been modified and only from the offset up
+ * to which it has been searched. A line is only searched once its newline has
+ * been written. A file that is shorter than this offset has been truncated and
+ * is searched from its start again. If another file is created or moved under
+ * the name of a followed file, the rest of the old file is searched and the
+ * new file is followed from its start on. The same happens for a file that
+ * doesn't exist yet when the search starts.
+ * @param args pointer to an arguments_t
+ * @return Returns 0 once every file has been finished ('-l', '-m'), -1 on
+ * error and PROCESS_DONE if the search has been finished early ('-q').
+ */
+int follow_files(arguments_t *args);
+
+#endif /* _FOLLOW_H */
@@ -0,0 +1,1200 @@
+/**
+ * @file index.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a persistent trigram index to narrow down the files a
+ * search has to read.
+ *
+ * @details The index file only contains fixed size records and offsets
+ * relative to its start, so it is used directly from a read only mapping:
+ *
+ * - index_header_t
+ * - index_file_t for every file, sorted by path
+ * - index_dir_t for every directory, sorted by path
+ * - index_trigram_t for every trigram that occurs, sorted by trigram
+ * - the posting lists, the ascending file numbers of every trigram
+ * - the NUL terminated paths of the files and directories, relative to the
+ *   indexed directory
+ *
+ * A trigram is made of three consecutive bytes with ASCII letters folded to
+ * lower case, packed into the lower 24 bits of an uint32_t.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "arguments.h"
+#include "index.h"
+#include "logic.h"
+#include "walk.h"
+
+/**
+ * Identifies an index file.
+ */
+#define INDEX_MAGIC "MYGREPIX"
+
+/**
+ * Version of the layout, an index with another version is rebuilt.
+ */
+#define INDEX_VERSION 2
+
+/**
+ * How many different trigrams there are.
+ */
+#define INDEX_TRIGRAMS (1 << 24)
+
+/**
+ * Set in 'index_file_t.flags' if the file is binary, it has no trigrams and
+ * is only searched with '-a'.
+ */
+#define INDEX_FLAG_BINARY 1
+
+/**
+ * @brief Start of the index file.
+ */
+typedef struct index_header {
+  char magic[8];         ///< INDEX_MAGIC without the NUL
+  uint32_t version;      ///< INDEX_VERSION
+  uint32_t files_num;    ///< how many files are indexed
+  uint32_t trigrams_num; ///< how many different trigrams occur
+  uint32_t dirs_num;     ///< how many directories are indexed
+
+  uint64_t files_offset;    ///< offset of the index_file_t records
+  uint64_t dirs_offset;     ///< offset of the index_dir_t records
+  uint64_t trigrams_offset; ///< offset of the index_trigram_t records
+  uint64_t postings_offset; ///< offset of the posting lists
+  uint64_t strings_offset;  ///< offset of the paths
+  uint64_t size;            ///< size of the whole index file
+} index_header_t;
+
+/**
+ * @brief An indexed file.
+ */
+typedef struct index_file {
+  uint64_t path;       ///< offset of the path inside the paths
+  int64_t mtime_sec;   ///< modification time when the file has been indexed
+  int64_t mtime_nsec;  ///< nanoseconds of 'mtime_sec'
+  uint64_t size;       ///< size when the file has been indexed
+  uint32_t flags;      ///< INDEX_FLAG_*
+  uint32_t reserved;   ///< always 0
+} index_file_t;
+
+/**
+ * @brief An indexed directory, a file added to it changes its modification
+ * time.
+ */
+typedef struct index_dir {
+  uint64_t path;      ///< offset of the path inside the paths, "" for the root
+  int64_t mtime_sec;  ///< modification time when the directory has been read
+  int64_t mtime_nsec; ///< nanoseconds of 'mtime_sec'
+} index_dir_t;
+
+/**
+ * @brief A trigram and the files it occurs in.
+ */
+typedef struct index_trigram {
+  uint32_t trigram;      ///< the packed trigram
+  uint32_t postings_num; ///< how many files contain the trigram
+  uint64_t postings;     ///< index of the first file number of the trigram
+} index_trigram_t;
+
+/**
+ * @brief A loaded index file.
+ */
+typedef struct index {
+  char *mapping; ///< the mapped index file
+  size_t size;   ///< size of the mapping
+
+  const index_header_t *header;   ///< start of the mapping
+  const index_file_t *files;      ///< the indexed files
+  const index_dir_t *dirs;        ///< the indexed directories
+  const index_trigram_t *trigrams; ///< the trigrams
+  const uint32_t *postings;       ///< the posting lists
+  const char *strings;            ///< the paths
+} index_t;
+
+/**
+ * @brief A file while the index is built.
+ */
+typedef struct index_entry {
+  char *path;         ///< path relative to the indexed directory
+  int64_t mtime_sec;  ///< see 'index_file_t'
+  int64_t mtime_nsec; ///< see 'index_file_t'
+  uint64_t size;      ///< see 'index_file_t'
+  uint32_t flags;     ///< see 'index_file_t'
+  int old;            ///< number in the old index if unchanged, else -1
+
+  uint32_t *trigrams;    ///< the distinct trigrams of the file
+  uint32_t trigrams_num; ///< how many trigrams there are
+} index_entry_t;
+
+/**
+ * @brief A directory while the index is built.
+ */
+typedef struct index_dir_entry {
+  char *path;         ///< path relative to the indexed directory
+  int64_t mtime_sec;  ///< see 'index_dir_t'
+  int64_t mtime_nsec; ///< see 'index_dir_t'
+} index_dir_entry_t;
+
+/**
+ * @brief State of 'index_build', shared between the walker threads.
+ */
+typedef struct index_builder {
+  size_t prefix_len; ///< length of the directory part of the walked paths
+
+  index_t old;  ///< the previous index
+  bool has_old; ///< 'true' if the previous index could be loaded
+
+  index_entry_t *entries; ///< all files found so far
+  int entries_num;        ///< how many files there are
+  int entries_capacity;   ///< the capacity of 'entries'
+
+  index_dir_entry_t *dirs; ///< all directories found so far
+  int dirs_num;            ///< how many directories there are
+  int dirs_capacity;       ///< the capacity of 'dirs'
+
+  pthread_key_t seen_key; ///< per thread bitmap of the trigrams of a file
+  pthread_mutex_t mutex;  ///< guards 'entries' and 'dirs'
+} index_builder_t;
+
+/**
+ * Folds ASCII letters to lower case, the same way for files and keywords.
+ */
+static unsigned char index_fold(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c | 0x20;
+  }
+  return c;
+}
+
+/**
+ * Builds the path of the index file of a directory.
+ * @return Returns the path, which has to be freed, or NULL.
+ */
+static char *index_path(const char *dir) {
+  return walk_join(dir, INDEX_FILE_NAME);
+}
+
+/**
+ * Checks if a name is the index file or its temporary file.
+ */
+static bool index_is_own(const char *name) {
+  return strncmp(name, INDEX_FILE_NAME, strlen(INDEX_FILE_NAME)) == 0;
+}
+
+/**
+ * Checks that count records of size bytes at offset are inside the index.
+ */
+static bool index_fits(const index_t *index, uint64_t offset, uint64_t count,
+                       uint64_t size) {
+  return offset <= index->size && count <= (index->size - offset) / size;
+}
+
+/**
+ * Maps an index file and checks that its records are inside the file.
+ * @param index the index_t that should be loaded
+ * @param path path of the index file
+ * @return Returns 0 if the index has been loaded and -1 if it doesn't exist
+ * or is invalid.
+ */
+static int index_load(index_t *index, const char *path) {
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return -1;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1 ||
+      (size_t)file_stat.st_size < sizeof(index_header_t)) {
+    close(fd);
+    return -1;
+  }
+
+  index->size = file_stat.st_size;
+  index->mapping = mmap(NULL, index->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (index->mapping == MAP_FAILED) {
+    return -1;
+  }
+
+  const index_header_t *header = (const index_header_t *)index->mapping;
+  index->header = header;
+
+  bool valid =
+      memcmp(header->magic, INDEX_MAGIC, sizeof(header->magic)) == 0 &&
+      header->version == INDEX_VERSION && header->size == index->size &&
+      index_fits(index, header->files_offset, header->files_num,
+                 sizeof(index_file_t)) &&
+      index_fits(index, header->dirs_offset, header->dirs_num,
+                 sizeof(index_dir_t)) &&
+      index_fits(index, header->trigrams_offset, header->trigrams_num,
+                 sizeof(index_trigram_t)) &&
+      index_fits(index, header->strings_offset, 0, 1) &&
+      (header->files_num + header->dirs_num == 0 ||
+       index->mapping[index->size - 1] == '\0');
+
+  if (valid) {
+    index->files =
+        (const index_file_t *)(index->mapping + header->files_offset);
+    index->dirs = (const index_dir_t *)(index->mapping + header->dirs_offset);
+    index->trigrams =
+        (const index_trigram_t *)(index->mapping + header->trigrams_offset);
+    index->postings =
+        (const uint32_t *)(index->mapping + header->postings_offset);
+    index->strings = index->mapping + header->strings_offset;
+
+    uint64_t postings_num =
+        (header->strings_offset - header->postings_offset) / sizeof(uint32_t);
+    valid = header->postings_offset <= header->strings_offset;
+
+    for (uint32_t i = 0; valid && i < header->trigrams_num; i += 1) {
+      const index_trigram_t *trigram = &index->trigrams[i];
+      valid = trigram->postings <= postings_num &&
+              trigram->postings_num <= postings_num - trigram->postings;
+    }
+    for (uint32_t i = 0; valid && i < header->files_num; i += 1) {
+      valid = index->files[i].path <
+              index->size - header->strings_offset;
+    }
+    for (uint32_t i = 0; valid && i < header->dirs_num; i += 1) {
+      valid = index->dirs[i].path < index->size - header->strings_offset;
+    }
+  }
+
+  if (valid == false) {
+    munmap(index->mapping, index->size);
+    return -1;
+  }
+
+  return 0;
+}
+
+/**
+ * Unmaps a loaded index.
+ */
+static void index_unload(index_t *index) {
+  munmap(index->mapping, index->size);
+}
+
+/**
+ * Finds the posting list of a trigram.
+ * @return Returns the index_trigram_t or NULL if no file contains it.
+ */
+static const index_trigram_t *index_find_trigram(const index_t *index,
+                                                 uint32_t trigram) {
+  uint32_t low = 0;
+  uint32_t high = index->header->trigrams_num;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    uint32_t current = index->trigrams[middle].trigram;
+
+    if (current == trigram) {
+      return &index->trigrams[middle];
+    }
+    if (current < trigram) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Finds a file in the index by its relative path.
+ * @return Returns the number of the file or -1.
+ */
+static int index_find_file(const index_t *index, const char *path) {
+  uint32_t low = 0;
+  uint32_t high = index->header->files_num;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    int order = strcmp(index->strings + index->files[middle].path, path);
+
+    if (order == 0) {
+      return (int)middle;
+    }
+    if (order < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Finds a directory in the index by its relative path.
+ * @return Returns the number of the directory or -1.
+ */
+static int index_find_dir(const index_t *index, const char *path) {
+  uint32_t low = 0;
+  uint32_t high = index->header->dirs_num;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    int order = strcmp(index->strings + index->dirs[middle].path, path);
+
+    if (order == 0) {
+      return (int)middle;
+    }
+    if (order < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return -1;
+}
+
+/**
+ * Collects the distinct trigrams of a buffer.
+ * @param seen zeroed bitmap of all trigrams, zeroed again on return
+ * @param buffer the bytes of the file
+ * @param len length of buffer in bytes
+ * @param entry where to store the trigrams
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_collect(uint8_t *seen, const char *buffer, size_t len,
+                         index_entry_t *entry) {
+  uint32_t capacity = 256;
+  entry->trigrams = malloc(capacity * sizeof(uint32_t));
+  entry->trigrams_num = 0;
+  if (entry->trigrams == NULL) {
+    return -1;
+  }
+
+  int result = 0;
+  uint32_t trigram = 0;
+  for (size_t i = 0; i < len; i += 1) {
+    trigram = ((trigram << 8) | index_fold(buffer[i])) & (INDEX_TRIGRAMS - 1);
+    if (i < 2 || (seen[trigram >> 3] & (1 << (trigram & 7))) != 0) {
+      continue;
+    }
+
+    if (entry->trigrams_num >= capacity) {
+      uint32_t *grown =
+          realloc(entry->trigrams, capacity * 2 * sizeof(uint32_t));
+      if (grown == NULL) {
+        result = -1;
+        break;
+      }
+      entry->trigrams = grown;
+      capacity *= 2;
+    }
+
+    seen[trigram >> 3] |= 1 << (trigram & 7);
+    entry->trigrams[entry->trigrams_num] = trigram;
+    entry->trigrams_num += 1;
+  }
+
+  for (uint32_t i = 0; i < entry->trigrams_num; i += 1) {
+    seen[entry->trigrams[i] >> 3] = 0;
+  }
+
+  return result;
+}
+
+/**
+ * Reads a changed or new file and collects its trigrams.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_read_file(index_builder_t *builder, int fd,
+                           index_entry_t *entry) {
+  if (entry->size == 0) {
+    return 0;
+  }
+
+  char *mapping = mmap(NULL, entry->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+  madvise(mapping, entry->size, MADV_SEQUENTIAL);
+
+  int result = 0;
+  if (process_is_binary(mapping, entry->size)) {
+    entry->flags |= INDEX_FLAG_BINARY;
+  } else {
+    uint8_t *seen = pthread_getspecific(builder->seen_key);
+    if (seen == NULL) {
+      seen = calloc(INDEX_TRIGRAMS / 8, 1);
+      if (seen == NULL || pthread_setspecific(builder->seen_key, seen) != 0) {
+        free(seen);
+        result = -1;
+      }
+    }
+
+    if (result == 0) {
+      result = index_collect(seen, mapping, entry->size, entry);
+    }
+  }
+
+  munmap(mapping, entry->size);
+
+  return result;
+}
+
+/**
+ * Adds a file found by the walk to the index, see 'walk_file_fn'.
+ * @details Unchanged files are only looked up in the old index, their
+ * trigrams are copied from it once the walk is over.
+ */
+static int index_add_file(void *context, char *path) {
+  index_builder_t *builder = context;
+
+  const char *name = strrchr(path, '/');
+  name = name == NULL ? path : name + 1;
+  if (index_is_own(name)) {
+    // the index itself and its temporary file
+    free(path);
+    return 0;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  struct stat file_stat;
+  if (fd == -1 || fstat(fd, &file_stat) == -1) {
+    fprintf(stderr, "Failed to open the file %s: %s\n", path, strerror(errno));
+    if (fd != -1) {
+      close(fd);
+    }
+    free(path);
+    return 0;
+  }
+
+  index_entry_t entry;
+  entry.path = strdup(path + builder->prefix_len);
+  entry.mtime_sec = file_stat.st_mtim.tv_sec;
+  entry.mtime_nsec = file_stat.st_mtim.tv_nsec;
+  entry.size = file_stat.st_size;
+  entry.flags = 0;
+  entry.old = -1;
+  entry.trigrams = NULL;
+  entry.trigrams_num = 0;
+  free(path);
+
+  if (entry.path == NULL) {
+    close(fd);
+    return -1;
+  }
+
+  if (builder->has_old) {
+    int old = index_find_file(&builder->old, entry.path);
+    if (old != -1) {
+      const index_file_t *file = &builder->old.files[old];
+      if (file->mtime_sec == entry.mtime_sec &&
+          file->mtime_nsec == entry.mtime_nsec && file->size == entry.size) {
+        entry.old = old;
+        entry.flags = file->flags;
+      }
+    }
+  }
+
+  int result = 0;
+  if (entry.old == -1) {
+    result = index_read_file(builder, fd, &entry);
+  }
+  close(fd);
+
+  if (result == 0) {
+    pthread_mutex_lock(&builder->mutex);
+    if (builder->entries_num >= builder->entries_capacity) {
+      int grown_capacity = builder->entries_capacity * 2;
+      index_entry_t *grown =
+          realloc(builder->entries, grown_capacity * sizeof(index_entry_t));
+      if (grown == NULL) {
+        result = -1;
+      } else {
+        builder->entries = grown;
+        builder->entries_capacity = grown_capacity;
+      }
+    }
+    if (result == 0) {
+      builder->entries[builder->entries_num] = entry;
+      builder->entries_num += 1;
+    }
+    pthread_mutex_unlock(&builder->mutex);
+  }
+
+  if (result != 0) {
+    free(entry.path);
+    free(entry.trigrams);
+  }
+
+  return result;
+}
+
+/**
+ * Records the modification time of a directory before its entries are read,
+ * see 'walk_directory_fn'.
+ */
+static int index_add_dir(void *context, const char *path,
+                         const struct stat *dir_stat) {
+  index_builder_t *builder = context;
+
+  index_dir_entry_t dir;
+  // the indexed directory itself may be given without a trailing '/'
+  dir.path = strdup(strlen(path) > builder->prefix_len
+                        ? path + builder->prefix_len
+                        : "");
+  dir.mtime_sec = dir_stat->st_mtim.tv_sec;
+  dir.mtime_nsec = dir_stat->st_mtim.tv_nsec;
+  if (dir.path == NULL) {
+    return -1;
+  }
+
+  int result = 0;
+  pthread_mutex_lock(&builder->mutex);
+  if (builder->dirs_num >= builder->dirs_capacity) {
+    int grown_capacity = builder->dirs_capacity * 2;
+    index_dir_entry_t *grown =
+        realloc(builder->dirs, grown_capacity * sizeof(index_dir_entry_t));
+    if (grown == NULL) {
+      result = -1;
+    } else {
+      builder->dirs = grown;
+      builder->dirs_capacity = grown_capacity;
+    }
+  }
+  if (result == 0) {
+    builder->dirs[builder->dirs_num] = dir;
+    builder->dirs_num += 1;
+  }
+  pthread_mutex_unlock(&builder->mutex);
+
+  if (result != 0) {
+    free(dir.path);
+  }
+
+  return result;
+}
+
+/**
+ * Orders directories by their path.
+ */
+static int index_compare_dirs(const void *a, const void *b) {
+  return strcmp(((const index_dir_entry_t *)a)->path,
+                ((const index_dir_entry_t *)b)->path);
+}
+
+/**
+ * Orders entries by their path.
+ */
+static int index_compare_entries(const void *a, const void *b) {
+  return strcmp(((const index_entry_t *)a)->path,
+                ((const index_entry_t *)b)->path);
+}
+
+/**
+ * Copies the trigrams of the unchanged files from the old index.
+ * @details The old posting lists are inverted back into one trigram list per
+ * file: first counted, then filled.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_reuse(index_builder_t *builder) {
+  const index_t *old = &builder->old;
+  uint32_t old_num = old->header->files_num;
+
+  int *old_to_new = malloc((old_num + 1) * sizeof(int));
+  if (old_to_new == NULL) {
+    return -1;
+  }
+  for (uint32_t i = 0; i < old_num; i += 1) {
+    old_to_new[i] = -1;
+  }
+  for (int i = 0; i < builder->entries_num; i += 1) {
+    if (builder->entries[i].old != -1) {
+      old_to_new[builder->entries[i].old] = i;
+    }
+  }
+
+  for (int pass = 0; pass < 2; pass += 1) {
+    for (uint32_t i = 0; i < old->header->trigrams_num; i += 1) {
+      const index_trigram_t *trigram = &old->trigrams[i];
+      const uint32_t *postings = old->postings + trigram->postings;
+
+      for (uint32_t j = 0; j < trigram->postings_num; j += 1) {
+        if (postings[j] >= old_num || old_to_new[postings[j]] == -1) {
+          continue;
+        }
+
+        index_entry_t *entry = &builder->entries[old_to_new[postings[j]]];
+        if (pass == 1) {
+          entry->trigrams[entry->trigrams_num] = trigram->trigram;
+        }
+        entry->trigrams_num += 1;
+      }
+    }
+
+    if (pass == 0) {
+      for (int i = 0; i < builder->entries_num; i += 1) {
+        index_entry_t *entry = &builder->entries[i];
+        if (entry->old == -1) {
+          continue;
+        }
+
+        entry->trigrams = malloc((entry->trigrams_num + 1) * sizeof(uint32_t));
+        if (entry->trigrams == NULL) {
+          free(old_to_new);
+          return -1;
+        }
+        entry->trigrams_num = 0;
+      }
+    }
+  }
+
+  free(old_to_new);
+
+  return 0;
+}
+
+/**
+ * Writes padding until offset is a multiple of 8.
+ * @return Returns the padded offset.
+ */
+static uint64_t index_align(FILE *file, uint64_t offset) {
+  while (offset % 8 != 0) {
+    fputc(0, file);
+    offset += 1;
+  }
+  return offset;
+}
+
+/**
+ * Inverts the trigram lists of all entries and writes the index file.
+ * @param builder the builder with all entries and directories sorted by path
+ * @param path where to write the index
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_write(index_builder_t *builder, const char *path) {
+  // first the number of files of every trigram, later its record number
+  uint32_t *slots = calloc(INDEX_TRIGRAMS, sizeof(uint32_t));
+  if (slots == NULL) {
+    return -1;
+  }
+
+  uint64_t postings_num = 0;
+  for (int i = 0; i < builder->entries_num; i += 1) {
+    index_entry_t *entry = &builder->entries[i];
+    for (uint32_t j = 0; j < entry->trigrams_num; j += 1) {
+      slots[entry->trigrams[j]] += 1;
+    }
+    postings_num += entry->trigrams_num;
+  }
+
+  uint32_t trigrams_num = 0;
+  for (uint32_t t = 0; t < INDEX_TRIGRAMS; t += 1) {
+    trigrams_num += slots[t] != 0;
+  }
+
+  index_trigram_t *trigrams =
+      malloc((trigrams_num + 1) * sizeof(index_trigram_t));
+  uint32_t *postings = malloc((postings_num + 1) * sizeof(uint32_t));
+  if (trigrams == NULL || postings == NULL) {
+    free(trigrams);
+    free(postings);
+    free(slots);
+    return -1;
+  }
+
+  uint64_t next = 0;
+  for (uint32_t t = 0, k = 0; t < INDEX_TRIGRAMS; t += 1) {
+    if (slots[t] == 0) {
+      continue;
+    }
+
+    trigrams[k].trigram = t;
+    trigrams[k].postings_num = 0;
+    trigrams[k].postings = next;
+    next += slots[t];
+    slots[t] = k;
+    k += 1;
+  }
+
+  // the entries are sorted, so every posting list ends up sorted
+  for (int i = 0; i < builder->entries_num; i += 1) {
+    index_entry_t *entry = &builder->entries[i];
+    for (uint32_t j = 0; j < entry->trigrams_num; j += 1) {
+      index_trigram_t *trigram = &trigrams[slots[entry->trigrams[j]]];
+      postings[trigram->postings + trigram->postings_num] = i;
+      trigram->postings_num += 1;
+    }
+  }
+  free(slots);
+
+  int result = -1;
+  FILE *file = fopen(path, "w");
+  if (file != NULL) {
+    index_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, INDEX_MAGIC, sizeof(header.magic));
+    header.version = INDEX_VERSION;
+    header.files_num = builder->entries_num;
+    header.trigrams_num = trigrams_num;
+    header.dirs_num = builder->dirs_num;
+
+    uint64_t offset = sizeof(header);
+    header.files_offset = offset;
+    offset += builder->entries_num * sizeof(index_file_t);
+    header.dirs_offset = offset;
+    offset += builder->dirs_num * sizeof(index_dir_t);
+    header.trigrams_offset = offset;
+    offset += trigrams_num * sizeof(index_trigram_t);
+    header.postings_offset = offset;
+    offset += postings_num * sizeof(uint32_t);
+    offset = (offset + 7) / 8 * 8;
+    header.strings_offset = offset;
+    for (int i = 0; i < builder->entries_num; i += 1) {
+      offset += strlen(builder->entries[i].path) + 1;
+    }
+    for (int i = 0; i < builder->dirs_num; i += 1) {
+      offset += strlen(builder->dirs[i].path) + 1;
+    }
+    header.size = offset;
+
+    fwrite(&header, sizeof(header), 1, file);
+
+    uint64_t path_offset = 0;
+    for (int i = 0; i < builder->entries_num; i += 1) {
+      index_entry_t *entry = &builder->entries[i];
+      index_file_t record;
+      memset(&record, 0, sizeof(record));
+      record.path = path_offset;
+      record.mtime_sec = entry->mtime_sec;
+      record.mtime_nsec = entry->mtime_nsec;
+      record.size = entry->size;
+      record.flags = entry->flags;
+
+      fwrite(&record, sizeof(record), 1, file);
+      path_offset += strlen(entry->path) + 1;
+    }
+
+    for (int i = 0; i < builder->dirs_num; i += 1) {
+      index_dir_entry_t *dir = &builder->dirs[i];
+      index_dir_t record;
+      memset(&record, 0, sizeof(record));
+      record.path = path_offset;
+      record.mtime_sec = dir->mtime_sec;
+      record.mtime_nsec = dir->mtime_nsec;
+
+      fwrite(&record, sizeof(record), 1, file);
+      path_offset += strlen(dir->path) + 1;
+    }
+
+    fwrite(trigrams, sizeof(index_trigram_t), trigrams_num, file);
+    fwrite(postings, sizeof(uint32_t), postings_num, file);
+    index_align(file, header.postings_offset + postings_num * sizeof(uint32_t));
+
+    for (int i = 0; i < builder->entries_num; i += 1) {
+      fputs(builder->entries[i].path, file);
+      fputc('\0', file);
+    }
+    for (int i = 0; i < builder->dirs_num; i += 1) {
+      fputs(builder->dirs[i].path, file);
+      fputc('\0', file);
+    }
+
+    result = ferror(file) ? -1 : 0;
+    if (fclose(file) != 0) {
+      result = -1;
+    }
+  }
+
+  free(trigrams);
+  free(postings);
+
+  return result;
+}
+
+int index_build(const char *dir, int threads) {
+  struct stat dir_stat;
+  if (stat(dir, &dir_stat) == -1 || S_ISDIR(dir_stat.st_mode) == false) {
+    fprintf(stderr, "Failed to index %s: not a directory\n", dir);
+    return -1;
+  }
+
+  index_builder_t builder;
+  size_t dir_len = strlen(dir);
+  builder.prefix_len = dir_len + (dir_len > 0 && dir[dir_len - 1] != '/');
+  builder.entries_num = 0;
+  builder.entries_capacity = 1024;
+  builder.entries = malloc(builder.entries_capacity * sizeof(index_entry_t));
+  builder.dirs_num = 0;
+  builder.dirs_capacity = 64;
+  builder.dirs = malloc(builder.dirs_capacity * sizeof(index_dir_entry_t));
+
+  char *index_file = index_path(dir);
+  char *temporary = walk_join(dir, INDEX_FILE_NAME ".tmp");
+  if (builder.entries == NULL || builder.dirs == NULL || index_file == NULL ||
+      temporary == NULL) {
+    free(builder.entries);
+    free(builder.dirs);
+    free(index_file);
+    free(temporary);
+    return -1;
+  }
+
+  builder.has_old = index_load(&builder.old, index_file) == 0;
+  pthread_key_create(&builder.seen_key, free);
+  pthread_mutex_init(&builder.mutex, NULL);
+
+  char *paths[] = {(char *)dir};
+  int result =
+      walk_paths(paths, 1, threads, index_add_file, index_add_dir, &builder);
+
+  // the walker threads free their bitmaps on exit, this one is left
+  free(pthread_getspecific(builder.seen_key));
+  pthread_setspecific(builder.seen_key, NULL);
+
+  qsort(builder.entries, builder.entries_num, sizeof(index_entry_t),
+        index_compare_entries);
+  qsort(builder.dirs, builder.dirs_num, sizeof(index_dir_entry_t),
+        index_compare_dirs);
+
+  if (result == 0 && builder.has_old) {
+    result = index_reuse(&builder);
+  }
+  if (builder.has_old) {
+    index_unload(&builder.old);
+  }
+
+  if (result == 0) {
+    result = index_write(&builder, temporary);
+  }
+  if (result == 0 && rename(temporary, index_file) != 0) {
+    result = -1;
+  }
+  if (result != 0) {
+    unlink(temporary);
+  }
+
+  for (int i = 0; i < builder.entries_num; i += 1) {
+    free(builder.entries[i].path);
+    free(builder.entries[i].trigrams);
+  }
+  free(builder.entries);
+  for (int i = 0; i < builder.dirs_num; i += 1) {
+    free(builder.dirs[i].path);
+  }
+  free(builder.dirs);
+  free(index_file);
+  free(temporary);
+  pthread_mutex_destroy(&builder.mutex);
+  pthread_key_delete(builder.seen_key);
+
+  return result;
+}
+
+/**
+ * Compares two posting lists by their length.
+ */
+static int index_compare_trigrams(const void *a, const void *b) {
+  uint32_t a_num = (*(const index_trigram_t *const *)a)->postings_num;
+  uint32_t b_num = (*(const index_trigram_t *const *)b)->postings_num;
+  return (a_num > b_num) - (a_num < b_num);
+}
+
+/**
+ * Checks if a sorted posting list contains a file.
+ */
+static bool index_contains(const uint32_t *postings, uint32_t postings_num,
+                           uint32_t file) {
+  uint32_t low = 0;
+  uint32_t high = postings_num;
+
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (postings[middle] == file) {
+      return true;
+    }
+    if (postings[middle] < file) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Marks every file that contains all trigrams of a literal.
+ * @details The shortest posting list is taken as it is, every file in it is
+ * looked up in the other lists. Trigrams with non ASCII bytes are left out
+ * when ignoring the case, their folded form may differ from the file.
+ * @param index the loaded index
+ * @param literal the literal every match contains
+ * @param ignore_case 'true' if the search ignores the case
+ * @param candidates one flag per file, set for every file that may match
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_mark(const index_t *index, const char *literal,
+                      bool ignore_case, bool *candidates) {
+  size_t len = strlen(literal);
+  uint32_t files_num = index->header->files_num;
+
+  const index_trigram_t **lists =
+      malloc((len + 1) * sizeof(const index_trigram_t *));
+  if (lists == NULL) {
+    return -1;
+  }
+
+  size_t lists_num = 0;
+  uint32_t trigram = 0;
+  for (size_t i = 0; i < len; i += 1) {
+    unsigned char c = literal[i];
+    trigram = ((trigram << 8) | index_fold(c)) & (INDEX_TRIGRAMS - 1);
+    if (i < 2) {
+      continue;
+    }
+    if (ignore_case &&
+        ((literal[i] | literal[i - 1] | literal[i - 2]) & 0x80) != 0) {
+      continue;
+    }
+
+    const index_trigram_t *found = index_find_trigram(index, trigram);
+    if (found == NULL) {
+      // no file contains the literal
+      free(lists);
+      return 0;
+    }
+    lists[lists_num] = found;
+    lists_num += 1;
+  }
+
+  if (lists_num == 0) {
+    // too short to narrow anything down
+    for (uint32_t i = 0; i < files_num; i += 1) {
+      candidates[i] = true;
+    }
+    free(lists);
+    return 0;
+  }
+
+  qsort(lists, lists_num, sizeof(const index_trigram_t *),
+        index_compare_trigrams);
+
+  const uint32_t *shortest = index->postings + lists[0]->postings;
+  for (uint32_t i = 0; i < lists[0]->postings_num; i += 1) {
+    uint32_t file = shortest[i];
+    bool all = file < files_num;
+
+    for (size_t j = 1; all && j < lists_num; j += 1) {
+      all = index_contains(index->postings + lists[j]->postings,
+                           lists[j]->postings_num, file);
+    }
+
+    if (all) {
+      candidates[file] = true;
+    }
+  }
+
+  free(lists);
+
+  return 0;
+}
+
+/**
+ * Marks the files that may match any of the keywords.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_mark_keywords(const index_t *index, arguments_t *args,
+                               bool *candidates) {
+  bool ignore_case = args->case_sensitive == false;
+
+  if (args->regex) {
+    // the only literal known about an expression is its prefix
+    const char *prefix =
+        args->matcher.regex.has_prefix ? args->matcher.regex.prefix : "";
+    return index_mark(index, prefix, ignore_case, candidates);
+  }
+
+  for (int i = 0; i < args->keywords_num; i += 1) {
+    if (index_mark(index, args->keywords[i], ignore_case, candidates) != 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * Adds every file of a directory that has been created after the index,
+ * see 'walk_file_fn'.
+ */
+static int index_add_new(void *context, char *path) {
+  arguments_t *args = context;
+
+  const char *name = strrchr(path, '/');
+  name = name == NULL ? path : name + 1;
+
+  int result = 0;
+  if (index_is_own(name) == false) {
+    result = arguments_add_input_file(args, path);
+  }
+  free(path);
+
+  return result;
+}
+
+/**
+ * Adds the entries of a changed directory that the index doesn't know.
+ * @details Such files are searched without looking at their trigrams, new
+ * subdirectories are walked completely.
+ * @param index the loaded index
+ * @param args where the files are added
+ * @param dir path of the directory
+ * @param relative path of the directory relative to the indexed directory
+ * @return Returns 0 if non error has been encountered.
+ */
+static int index_add_unknown(const index_t *index, arguments_t *args,
+                             const char *dir, const char *relative) {
+  DIR *stream = opendir(dir);
+  if (stream == NULL) {
+    // removed since its status has been read
+    return 0;
+  }
+
+  int result = 0;
+  while (result == 0) {
+    struct dirent *entry = readdir(stream);
+    if (entry == NULL) {
+      break;
+    }
+
+    const char *name = entry->d_name;
+    if ((name[0] == '.' &&
+         (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) ||
+        index_is_own(name)) {
+      continue;
+    }
+
+    char *path = walk_join(dir, name);
+    char *entry_relative = walk_join(relative, name);
+    if (path == NULL || entry_relative == NULL) {
+      free(path);
+      free(entry_relative);
+      result = -1;
+      break;
+    }
+
+    struct stat entry_stat;
+    if (lstat(path, &entry_stat) == 0) {
+      if (S_ISREG(entry_stat.st_mode) &&
+          index_find_file(index, entry_relative) == -1) {
+        result = arguments_add_input_file(args, path);
+      } else if (S_ISDIR(entry_stat.st_mode) &&
+                 index_find_dir(index, entry_relative) == -1) {
+        result = walk_paths(&path, 1, 1, index_add_new, NULL, args);
+      }
+    }
+
+    free(path);
+    free(entry_relative);
+  }
+
+  closedir(stream);
+
+  return result;
+}
+
+int index_query(arguments_t *args) {
+  char *index_file = index_path(args->index_dir);
+  if (index_file == NULL) {
+    return -1;
+  }
+
+  index_t index;
+  if (index_load(&index, index_file) != 0) {
+    fprintf(stderr, "No valid index in %s, build it with '--index %s'\n",
+            args->index_dir, args->index_dir);
+    free(index_file);
+    return 1;
+  }
+  free(index_file);
+
+  uint32_t files_num = index.header->files_num;
+  bool *candidates = calloc(files_num + 1, sizeof(bool));
+  if (candidates == NULL) {
+    index_unload(&index);
+    return -1;
+  }
+
+  int result = index_mark_keywords(&index, args, candidates);
+
+  for (uint32_t i = 0; result == 0 && i < files_num; i += 1) {
+    const index_file_t *file = &index.files[i];
+    char *path = walk_join(args->index_dir, index.strings + file->path);
+    if (path == NULL) {
+      result = -1;
+      break;
+    }
+
+    struct stat file_stat;
+    if (stat(path, &file_stat) == -1) {
+      // removed since the index has been built
+      free(path);
+      continue;
+    }
+
+    bool changed = file_stat.st_mtim.tv_sec != file->mtime_sec ||
+                   file_stat.st_mtim.tv_nsec != file->mtime_nsec ||
+                   (uint64_t)file_stat.st_size != file->size;
+    bool binary = (file->flags & INDEX_FLAG_BINARY) != 0;
+    // a binary file has no trigrams, with '-a' it is searched like text
+    bool candidate =
+        binary ? args->binary_files == E_BINARY_TEXT : candidates[i];
+
+    if (changed || candidate) {
+      result = arguments_add_input_file(args, path);
+    }
+    free(path);
+  }
+
+  // added files are only noticed by the modification time of their directory,
+  // the indexed directory itself always looks changed since the index file
+  // has been renamed into it
+  for (uint32_t i = 0; result == 0 && i < index.header->dirs_num; i += 1) {
+    const index_dir_t *dir = &index.dirs[i];
+    const char *relative = index.strings + dir->path;
+    char *path = walk_join(args->index_dir, relative);
+    if (path == NULL) {
+      result = -1;
+      break;
+    }
+
+    struct stat dir_stat;
+    if (stat(path, &dir_stat) == 0 &&
+        (dir_stat.st_mtim.tv_sec != dir->mtime_sec ||
+         dir_stat.st_mtim.tv_nsec != dir->mtime_nsec)) {
+      result = index_add_unknown(&index, args, path, relative);
+    }
+    free(path);
+  }
+
+  free(candidates);
+  index_unload(&index);
+
+  if (result != 0) {
+    return result;
+  }
+
+  return process_files(args);
+}
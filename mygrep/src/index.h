@@ -0,0 +1,50 @@
+/**
+ * @file index.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a persistent trigram index to narrow down the files a
+ * search has to read.
+ */
+
+#ifndef _INDEX_H
+#define _INDEX_H
+
+#include "arguments.h"
+
+/**
+ * Name of the index file inside the indexed directory.
+ */
+#define INDEX_FILE_NAME ".mygrep-index"
+
+/**
+ * Builds or updates the index of a directory.
+ * @brief Walks the directory like '-r' and stores for every file the set of
+ * (ASCII case folded) trigrams it contains, inverted into one sorted list of
+ * files per trigram, and the modification time of every directory. If an
+ * index exists already, files whose modification time and size are unchanged
+ * are not read again. The index is written to a temporary file and renamed
+ * into place, so a running query never sees a half written index.
+ * @param dir the directory to index
+ * @param threads how many threads read the files
+ * @return Returns 0 if non error has been encountered.
+ */
+int index_build(const char *dir, int threads);
+
+/**
+ * Searches the indexed directory 'args->index_dir'.
+ * @brief Every file that contains all trigrams of a keyword is searched like
+ * an input file given on the command line. Files that have been changed since
+ * the index has been built are always searched. Directories whose
+ * modification time has changed are read again, the files in them that the
+ * index doesn't know (and all files of new subdirectories) are searched as
+ * well. Binary files are only searched with '-a', all of them, since they
+ * have no trigrams.
+ * @param args pointer to an arguments_t, the candidate files are added to its
+ * input files
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int index_query(arguments_t *args);
+
+#endif /* _INDEX_H */
@@ -6,18 +6,73 @@
  * @brief Provides utility functions to process files.
  */
 
+#include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
 
 #include "arguments.h"
 #include "logic.h"
+#include "matcher.h"
 #include "output.h"
+#include "parallel.h"
+#include "reader.h"
+#include "search.h"
+#include "walk.h"
 
-int process_line(const char *line, arguments_t *args);
+int process_line(const char *line, size_t len, arguments_t *args,
+                 file_state_t *state);
+static int process_gzip(FILE *file, arguments_t *args, file_state_t *state);
+static int process_pipe(FILE *file, arguments_t *args, file_state_t *state);
+static int process_read(FILE *file, reader_t *reader, arguments_t *args,
+                        file_state_t *state);
+static int process_stream(FILE *file, reader_t *reader, arguments_t *args,
+                          file_state_t *state);
+static int process_window(FILE *file, reader_t *reader, arguments_t *args,
+                          file_state_t *state);
+static int process_mapped(FILE *file, arguments_t *args, file_state_t *state);
+
+/**
+ * Searches a file found by the walk, see 'walk_file_fn'.
+ * @details Files that can't be opened are reported and skipped, the walk
+ * goes on.
+ */
+static int process_walk_file(void *context, char *path) {
+  arguments_t *args = context;
+
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open the file %s: %s\n", path, strerror(errno));
+    free(path);
+    return 0;
+  }
+
+  int result = process_file(file, path, args);
+  fclose(file);
+  free(path);
+
+  return result;
+}
 
 int process_files(arguments_t *args) {
+  if (args->recursive) {
+    if (args->threads > 1) {
+      return parallel_process_tree(args);
+    }
+
+    return walk_paths(args->input_files, args->input_files_num, 1,
+                      process_walk_file, NULL, args);
+  }
+
+  if (args->threads > 1 && args->input_files_num > 1) {
+    return parallel_process_files(args);
+  }
+
   for (int i = 0; i < args->input_files_num; i++) {
     char *file_path = args->input_files[i];
     FILE *file = fopen(file_path, "r");
@@ -27,54 +82,1634 @@ int process_files(arguments_t *args) {
       return 1;
     }
 
-    process_file(file, args);
-
+    int result = process_file(file, file_path, args);
     fclose(file);
+
+    if (result != 0) {
+      return result;
+    }
   }
 
   return 0;
 }
 
-int process_file(FILE *file, arguments_t *args) {
-  size_t len = 256;
-  char *line = malloc(len * sizeof(char));
-  if (line == NULL) {
+int process_file(FILE *file, const char *name, arguments_t *args) {
+  return process_file_buffered(file, name, args, NULL);
+}
+
+void file_state_init(file_state_t *state, const char *name,
+                     output_buffer_t *out) {
+  state->name = name;
+  state->out = out;
+  state->matches = 0;
+  state->binary = false;
+  state->probed = 0;
+  state->printed = -1;
+  state->after = 0;
+  memset(&state->stats, 0, sizeof(state->stats));
+  file_state_seek(state, NULL, 0, 1);
+}
+
+void file_state_seek(file_state_t *state, const char *start, off_t offset,
+                     long line) {
+  state->start = start;
+  state->offset = offset;
+  state->counted = start;
+  state->line = line;
+}
+
+/**
+ * Emits output of the search.
+ * @param state the state of the current input, see 'file_state_t.out'
+ * @param line bytes to emit
+ * @param len length of line in bytes
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit(file_state_t *state, const char *line, size_t len) {
+  if (state->out == NULL) {
+    return output_write(line, len);
+  }
+
+  return output_buffer_append(state->out, line, len);
+}
+
+/**
+ * Emits output that stays valid until the next 'output_flush'.
+ * @details Same as 'process_emit', but lets the output gather the line
+ * directly from e.g. a memory mapping instead of copying it.
+ */
+static int process_emit_stable(file_state_t *state, const char *line,
+                               size_t len) {
+  if (state->out == NULL) {
+    return output_write_stable(line, len);
+  }
+
+  return output_buffer_append(state->out, line, len);
+}
+
+/**
+ * Formats a number followed by a separator.
+ * @details Called for every printed line with '-n' or '-b', where 'snprintf'
+ * would take longer than counting the newlines.
+ * @param dest where to write to, needs space for 21 bytes
+ * @param value the number to format
+ * @param separator ':' for a matching line, '-' for a line of context
+ * @return Returns how many bytes have been written.
+ */
+static int process_format_number(char *dest, unsigned long long value,
+                                 char separator) {
+  char digits[20];
+  int len = 0;
+
+  do {
+    digits[len] = '0' + value % 10;
+    value /= 10;
+    len += 1;
+  } while (value > 0);
+
+  for (int i = 0; i < len; i += 1) {
+    dest[i] = digits[len - 1 - i];
+  }
+  dest[len] = separator;
+
+  return len + 1;
+}
+
+/**
+ * Emits the prefix of '-n' and '-b' for a line at a known position.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param line line number of the line
+ * @param offset offset of the line in the input
+ * @param separator ':' for a matching line, '-' for a line of context
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_prefix(const arguments_t *args, file_state_t *state,
+                               long line, off_t offset, char separator) {
+  char prefix[64];
+  int len = 0;
+
+  if (args->line_numbers) {
+    len += process_format_number(prefix + len, line, separator);
+  }
+
+  if (args->byte_offsets) {
+    len += process_format_number(prefix + len, offset, separator);
+  }
+
+  if (len == 0) {
+    return 0;
+  }
+
+  return process_emit(state, prefix, len);
+}
+
+/**
+ * Emits the line number and byte offset of a printed line.
+ * @details The newlines since the last printed line are only counted now, so
+ * lines that aren't printed never cost anything.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param line_start start of the printed line inside the current buffer
+ * @param separator ':' for a matching line, '-' for a line of context
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_position(const arguments_t *args, file_state_t *state,
+                                 const char *line_start, char separator) {
+  if (args->line_numbers) {
+    state->line +=
+        search_count_newlines(state->counted, line_start - state->counted);
+    state->counted = line_start;
+  }
+
+  return process_emit_prefix(args, state, state->line,
+                             state->offset + (line_start - state->start),
+                             separator);
+}
+
+/**
+ * Emits a line of a buffer that stays valid until 'output_flush'.
+ * @details With a prefix the line is copied behind it, referencing it would
+ * split the output into twice as many slices as there are lines.
+ * @param separator ':' for a matching line, '-' for a line of context
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_line(const arguments_t *args, file_state_t *state,
+                             const char *line_start, const char *line_end,
+                             char separator) {
+  if (args->line_numbers == false && args->byte_offsets == false) {
+    return process_emit_stable(state, line_start, line_end - line_start);
+  }
+
+  if (process_emit_position(args, state, line_start, separator) != 0) {
+    return -1;
+  }
+
+  return process_emit(state, line_start, line_end - line_start);
+}
+
+/**
+ * Adds a searched part of the input to its statistics ('--stats').
+ * @details The lines are only counted with '-n', by finishing its lazy
+ * counter. Counting them for the statistics alone would be a second pass
+ * over the whole buffer, so without '-n' they are left unknown.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param buffer the searched bytes, starting at the start of a line
+ * @param len length of buffer in bytes
+ * @param first_line line number of the first line of buffer
+ */
+static void process_count_scanned(const arguments_t *args, file_state_t *state,
+                                  const char *buffer, size_t len,
+                                  long first_line) {
+  if (args->stats == false || len == 0) {
+    return;
+  }
+
+  state->stats.bytes += len;
+  if (args->line_numbers == false) {
+    state->stats.lines_unknown = true;
+    return;
+  }
+
+  const char *end = buffer + len;
+  state->line += search_count_newlines(state->counted, end - state->counted);
+  state->counted = end;
+  state->stats.lines += state->line - first_line;
+  if (end[-1] != '\n') {
+    // the last line has been cut by the end of the input or the early stop
+    state->stats.lines += 1;
+  }
+}
+
+/**
+ * Counts a matching line and checks if the input has to be searched any
+ * further.
+ * @param args pointer to an arguments_t
+ * @param state the state of the current input
+ * @return Returns 0 to continue, 1 if the rest of the input can be skipped and
+ * PROCESS_DONE if the whole search is finished ('-q').
+ */
+static int process_count_match(const arguments_t *args, file_state_t *state) {
+  state->matches += 1;
+
+  switch (args->output_mode) {
+  case E_OUTPUT_QUIET:
+    return PROCESS_DONE;
+  case E_OUTPUT_FILES_WITH_MATCHES:
+    return 1;
+  case E_OUTPUT_LINES:
+    if (state->binary) {
+      // a binary file is only reported once
+      return 1;
+    }
+    // fall through
+  case E_OUTPUT_COUNT:
+    if (args->max_count >= 0 && state->matches >= args->max_count) {
+      return 1;
+    }
+    return 0;
+  default:
+    return 0;
+  }
+}
+
+/**
+ * Checks if the matching lines of the input are printed.
+ */
+static bool process_prints_lines(const arguments_t *args,
+                                 const file_state_t *state) {
+  return args->output_mode == E_OUTPUT_LINES && state->binary == false;
+}
+
+/**
+ * Checks if lines of context are printed around the matching lines.
+ */
+static bool process_prints_context(const arguments_t *args,
+                                   const file_state_t *state) {
+  return process_prints_lines(args, state) && args->context;
+}
+
+/**
+ * Emits the separator '--' if the next printed line doesn't directly follow
+ * the last one.
+ * @details In front of the first printed line of the input the separator
+ * depends on the inputs before, see 'output_group'. Output that is collected
+ * for the file pool only gets marked, it is written in the order of the
+ * inputs later on.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param offset offset of the next printed line in the input
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_separator(const arguments_t *args, file_state_t *state,
+                                  off_t offset) {
+  if (process_prints_context(args, state) == false ||
+      state->printed == offset) {
+    return 0;
+  }
+
+  if (state->printed < 0) {
+    // the group starts here, asking again for the same line is a no-op
+    state->printed = offset;
+    if (state->out != NULL) {
+      state->out->group = true;
+      return 0;
+    }
+    return output_group();
+  }
+
+  return process_emit(state, "--\n", 3);
+}
+
+/**
+ * Remembers a printed matching line, the trailing context starts behind it.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param end offset behind the matching line in the input
+ */
+static void process_printed_match(const arguments_t *args, file_state_t *state,
+                                  off_t end) {
+  state->printed = end;
+  state->after = args->context_after;
+}
+
+/**
+ * Finds the start of the lines of context in front of a line.
+ * @details Only looks at the lines in front of the match, so lines without a
+ * match never cost anything.
+ * @param lower start of the first line that may be context
+ * @param line_start start of the line the context is for
+ * @param lines how many lines of context there are at most
+ * @return Returns the start of the first line of context.
+ */
+static const char *process_context_start(const char *lower,
+                                         const char *line_start, long lines) {
+  const char *start = line_start;
+
+  while (lines > 0 && start > lower) {
+    // start[-1] is the newline of the line in front
+    start -= 1;
+    while (start > lower && start[-1] != '\n') {
+      start -= 1;
+    }
+    lines -= 1;
+  }
+
+  return start;
+}
+
+/**
+ * Finds the end of the trailing context that is still missing.
+ * @param from start of the first line of trailing context
+ * @param limit the trailing context ends here at the latest
+ * @param lines how many lines of trailing context are missing, decreased by
+ * the number of lines found
+ * @return Returns the end of the last line of trailing context.
+ */
+static const char *process_context_end(const char *from, const char *limit,
+                                       long *lines) {
+  while (*lines > 0 && from < limit) {
+    const char *end = memchr(from, '\n', limit - from);
+    from = end == NULL ? limit : end + 1;
+    *lines -= 1;
+  }
+
+  return from;
+}
+
+/**
+ * Emits lines of the current buffer as context, each with its own prefix.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param start start of the first line
+ * @param end end of the last line
+ * @param stable 'true' if the buffer stays valid until 'output_flush'
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_context(const arguments_t *args, file_state_t *state,
+                                const char *start, const char *end,
+                                bool stable) {
+  if (start >= end) {
+    return 0;
+  }
+
+  if (process_emit_separator(args, state,
+                             state->offset + (start - state->start)) != 0) {
     return -1;
   }
 
-  while (getline(&line, &len, file) != -1) {
-    if (process_line(line, args) != 0) {
+  while (start < end) {
+    const char *line_end = memchr(start, '\n', end - start);
+    line_end = line_end == NULL ? end : line_end + 1;
+
+    int result;
+    if (stable) {
+      result = process_emit_line(args, state, start, line_end, '-');
+    } else {
+      result = process_emit_position(args, state, start, '-') != 0
+                   ? -1
+                   : process_emit(state, start, line_end - start);
+    }
+    if (result != 0) {
       return -1;
     }
+    start = line_end;
   }
 
-  free(line);
+  state->printed = state->offset + (end - state->start);
+
+  return 0;
+}
+
+/**
+ * Emits the context of a matching line of the current buffer.
+ * @details First the rest of the trailing context of the last match, then the
+ * lines in front of the matching line and the separator between them.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param from start of the lines that haven't been printed yet
+ * @param line_start start of the matching line
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_around(const arguments_t *args, file_state_t *state,
+                               const char *from, const char *line_start) {
+  const char *after_end = process_context_end(from, line_start, &state->after);
+  if (process_emit_context(args, state, from, after_end, true) != 0) {
+    return -1;
+  }
+
+  const char *before =
+      process_context_start(after_end, line_start, args->context_before);
+  if (process_emit_context(args, state, before, line_start, true) != 0) {
+    return -1;
+  }
+
+  return process_emit_separator(args, state,
+                                state->offset + (line_start - state->start));
+}
+
+int process_finish(const arguments_t *args, file_state_t *state) {
+  char line[64];
+
+  if (args->output_mode == E_OUTPUT_FILES_WITH_MATCHES && state->matches > 0) {
+    if (process_emit(state, state->name, strlen(state->name)) != 0) {
+      return -1;
+    }
+    return process_emit(state, "\n", 1);
+  }
+
+  if (args->output_mode == E_OUTPUT_LINES && state->binary &&
+      state->matches > 0) {
+    int len = snprintf(line, sizeof(line), "Binary file ");
+    if (process_emit(state, line, len) != 0 ||
+        process_emit(state, state->name, strlen(state->name)) != 0) {
+      return -1;
+    }
+    return process_emit(state, " matches\n", 9);
+  }
+
+  if (args->output_mode == E_OUTPUT_COUNT) {
+    // the name is only needed to tell multiple files apart
+    if (args->input_files_num > 1 || args->recursive ||
+        args->index_dir != NULL) {
+      if (process_emit(state, state->name, strlen(state->name)) != 0 ||
+          process_emit(state, ":", 1) != 0) {
+        return -1;
+      }
+    }
+
+    int len = snprintf(line, sizeof(line), "%ld\n", state->matches);
+    return process_emit(state, line, len);
+  }
+
+  return 0;
+}
+
+int process_file_buffered(FILE *file, const char *name, arguments_t *args,
+                          output_buffer_t *out) {
+  file_state_t state;
+  file_state_init(&state, name, out);
+
+  // the output of the file pool is written by the printing thread
+  long long started = args->stats ? stats_now() : 0;
+  long long output_started = args->stats && out == NULL ? output_time() : 0;
+
+  int result = process_gzip(file, args, &state);
+  if (result == 1) {
+    result = process_mapped(file, args, &state);
+  }
+  if (result == 1) {
+    result = process_pipe(file, args, &state);
+  }
+  if (result == 1) {
+    result = process_read(file, NULL, args, &state);
+  }
+
+  if (result != 0 && result != PROCESS_DONE) {
+    return result;
+  }
+
+  if (process_finish(args, &state) != 0) {
+    return -1;
+  }
+
+  if (args->stats) {
+    if (out == NULL) {
+      state.stats.output_ns = output_time() - output_started;
+    }
+    state.stats.matches = state.matches;
+    state.stats.match_ns = stats_now() - started - state.stats.io_ns -
+                           state.stats.output_ns;
+    if (stats_add(name, &state.stats) != 0) {
+      return -1;
+    }
+  }
+
+  return result;
+}
+
+int process_buffer(const char *buffer, size_t len, arguments_t *args,
+                   file_state_t *state) {
+  const char *current = buffer;
+  const char *end = buffer + len;
+  long first_line = state->line;
+  bool stopped = false;
+
+  if (args->max_count == 0) {
+    return 0;
+  }
+
+  while (current < end) {
+    const char *hit = matcher_find(&args->matcher, current, end - current);
+    if (hit == NULL) {
+      break;
+    }
+
+    int stop = process_count_match(args, state);
+    if (stop == PROCESS_DONE) {
+      process_count_scanned(args, state, buffer, hit - buffer + 1,
+                            first_line);
+      return PROCESS_DONE;
+    }
+
+    // current always points to the start of a line
+    const char *line_start = hit;
+    while (line_start > current && line_start[-1] != '\n') {
+      line_start -= 1;
+    }
+
+    const char *line_end = memchr(hit, '\n', end - hit);
+    line_end = line_end == NULL ? end : line_end + 1;
+
+    if (process_prints_context(args, state)) {
+      if (process_emit_around(args, state, current, line_start) != 0) {
+        return -1;
+      }
+      process_printed_match(args, state,
+                            state->offset + (line_end - state->start));
+    }
+
+    if (process_prints_lines(args, state) &&
+        process_emit_line(args, state, line_start, line_end, ':') != 0) {
+      return -1;
+    }
+
+    current = line_end;
+    if (stop != 0) {
+      stopped = true;
+      break;
+    }
+  }
+
+  // the trailing context of the last match, even if it stopped the search
+  if (process_prints_context(args, state)) {
+    const char *after_end = process_context_end(current, end, &state->after);
+    if (process_emit_context(args, state, current, after_end, true) != 0) {
+      return -1;
+    }
+    current = after_end;
+  }
+
+  process_count_scanned(args, state, buffer,
+                        (stopped ? current : end) - buffer, first_line);
+
+  return 0;
+}
+
+bool process_is_binary(const char *buffer, size_t len) {
+  if (len > PROCESS_BINARY_PROBE) {
+    len = PROCESS_BINARY_PROBE;
+  }
+
+  return search_is_binary(buffer, len);
+}
+
+/**
+ * Decompresses a file compressed with gzip and searches it.
+ * @details The file is decompressed by a reader thread while the previous
+ * buffer is searched, see 'reader_start_gzip'. The decompressed bytes are
+ * searched like a stream, in place in the buffers they have been inflated
+ * into, line numbers and offsets are counted in them.
+ * @param file file to read from, nothing must have been read with stdio yet
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 if non error has been encountered, 1 if the file isn't
+ * compressed and PROCESS_DONE if the whole search is finished.
+ */
+static int process_gzip(FILE *file, arguments_t *args, file_state_t *state) {
+  int fd = fileno(file);
+  off_t offset = ftello(file);
+  if (fd == -1 || offset == -1 || reader_is_gzip(fd, offset) == false) {
+    return 1;
+  }
+
+  if (lseek(fd, offset, SEEK_SET) == -1) {
+    return -1;
+  }
+
+  reader_t reader;
+  if (reader_start_gzip(&reader, fd) != 0) {
+    return -1;
+  }
+
+  int result = process_read(file, &reader, args, state);
+  reader_finish(&reader);
+
+  return result;
+}
+
+/**
+ * Searches a pipe or another stream that isn't a regular file.
+ * @details A reader thread reads the stream into two buffers in turns, so the
+ * producer can go on writing while the previous buffer is searched, see
+ * 'reader_start_fd'.
+ * @param file file to read from, nothing must have been read with stdio yet
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 if non error has been encountered, 1 if the file is a
+ * regular file and PROCESS_DONE if the whole search is finished.
+ */
+static int process_pipe(FILE *file, arguments_t *args, file_state_t *state) {
+  int fd = fileno(file);
+  struct stat file_stat;
+  if (fd == -1 || fstat(fd, &file_stat) == -1 ||
+      S_ISREG(file_stat.st_mode) || args->max_count == 0) {
+    return 1;
+  }
+
+  reader_t reader;
+  if (reader_start_fd(&reader, fd) != 0) {
+    return -1;
+  }
+
+  int result = process_read(file, &reader, args, state);
+  reader_finish(&reader);
+
+  return result;
+}
+
+/**
+ * Reads the given file through a window or line per line, whatever the
+ * matcher needs.
+ * @param file file to read from, nothing must have been read with stdio yet
+ * @param reader reader thread to read from instead of file or NULL
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int process_read(FILE *file, reader_t *reader, arguments_t *args,
+                        file_state_t *state) {
+  // a match of a regular expression has no upper bound on its length, so it
+  // can't be found across the edge of a window
+  if (args->matcher.type == E_MATCHER_REGEX || args->matcher.multiline) {
+    return process_stream(file, reader, args, state);
+  }
+
+  return process_window(file, reader, args, state);
+}
+
+/**
+ * Memory maps the file and searches it with 'process_buffer'.
+ * @details Only regular files can be mapped, everything else (stdin from a
+ * pipe or a terminal, fifos, ...) has to be read with 'process_stream'. The
+ * mapping starts at the current position of the file so that nothing that has
+ * already been read gets searched again.
+ * @param file file to search
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 or PROCESS_DONE if the file has been searched, 1 if the
+ * file can't be mapped and -1 if an error has been encountered.
+ */
+static int process_mapped(FILE *file, arguments_t *args, file_state_t *state) {
+  if (args->matcher.multiline) {
+    return 1;
+  }
+
+  int fd = fileno(file);
+  struct stat file_stat;
+  if (fd == -1 || fstat(fd, &file_stat) == -1 ||
+      S_ISREG(file_stat.st_mode) == false) {
+    return 1;
+  }
+
+  off_t offset = ftello(file);
+  if (offset == -1 || offset >= file_stat.st_size) {
+    // nothing left to search, let the stream handle the edge cases
+    return 1;
+  }
+
+  // the pages are only read while they are searched, so the time of that is
+  // part of the search
+  long long started = args->stats ? stats_now() : 0;
+  size_t size = file_stat.st_size;
+  char *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (mapping == MAP_FAILED) {
+    return 1;
+  }
+  if (args->stats) {
+    state->stats.io_ns += stats_now() - started;
+  }
+
+  // probed before the read ahead is raised, a skipped file only costs the
+  // pages of the probe
+  if (args->binary_files != E_BINARY_TEXT &&
+      process_is_binary(mapping + offset, size - offset)) {
+    if (args->binary_files == E_BINARY_SKIP) {
+      munmap(mapping, size);
+      return 0;
+    }
+    state->binary = true;
+  }
+  madvise(mapping, size, MADV_SEQUENTIAL);
+
+  file_state_seek(state, mapping + offset, offset, 1);
+
+  int result;
+  if (state->out == NULL && state->binary == false &&
+      parallel_should_split(args, size - offset)) {
+    // only split when called serially, the file pool keeps all threads busy
+    result = parallel_process_buffer(mapping + offset, size - offset, offset,
+                                     args, state);
+  } else {
+    result = process_buffer(mapping + offset, size - offset, args, state);
+  }
+
+  // the output may still reference the mapping
+  if (state->out == NULL && output_flush() != 0) {
+    result = -1;
+  }
+
+  started = args->stats ? stats_now() : 0;
+  munmap(mapping, size);
+  if (args->stats) {
+    state->stats.io_ns += stats_now() - started;
+  }
+
+  return result;
+}
+
+/**
+ * @brief A line that has left its buffer, but may still be printed as leading
+ * context.
+ */
+typedef struct held_line {
+  char *line;      ///< the line, a buffer of getline is handed over instead
+                   ///< of copied
+  size_t capacity; ///< capacity of line
+  size_t len;      ///< length of the line in bytes
+  long number;     ///< line number of the line
+  off_t offset;    ///< offset of the line in the input
+} held_line_t;
+
+/**
+ * Emits a held line as context.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_emit_held(const arguments_t *args, file_state_t *state,
+                             const held_line_t *held) {
+  if (process_emit_separator(args, state, held->offset) != 0 ||
+      process_emit_prefix(args, state, held->number, held->offset, '-') !=
+          0 ||
+      process_emit(state, held->line, held->len) != 0) {
+    return -1;
+  }
+
+  state->printed = held->offset + held->len;
+
+  return 0;
+}
+
+/**
+ * @brief State of 'process_window'.
+ */
+typedef struct window {
+  char *buffer;    ///< the window, the input is read into it
+  size_t capacity; ///< size of buffer in bytes, with 'in_place' only the
+                   ///< size the limits of the window are computed from
+  bool in_place;   ///< 'true' if buffer is a buffer of the reader, which is
+                   ///< searched in place, see 'reader_take'
+  size_t filled;   ///< how many bytes of buffer are used
+  size_t line;     ///< start of the current line in buffer
+  size_t scan;     ///< where the next search starts, never before 'line'
+  size_t context;  ///< start of the lines in front of 'line' that can still
+                   ///< be printed as context, never behind 'line'
+  off_t offset;    ///< offset of buffer in the input
+  bool matched;    ///< 'true' if the current line has matched, the rest of it
+                   ///< is printed or skipped without a search
+  bool finished;   ///< 'true' if the input is finished after the current line
+  bool spilled;    ///< 'true' if the start of the current line has left the
+                   ///< window
+  long spilled_line;    ///< line number of the spilled line ('-n')
+  off_t spilled_offset; ///< offset of the spilled line ('-b')
+  FILE *spill;      ///< temporary file with the spilled part of the line
+  size_t spill_len; ///< how many bytes of the current line are in spill
+  char *held;       ///< the lines in front of the spilled line that can still
+                    ///< be printed as context, at most a quarter of the window
+  size_t held_len;  ///< how many bytes of held are used
+  long held_line;   ///< line number of the first held line ('-n')
+  off_t held_offset; ///< offset of the first held line ('-b')
+} window_t;
+
+/**
+ * Emits the spilled start of the current line in pieces.
+ * @param state the state of the input
+ * @param window the window of the input
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_window_replay(file_state_t *state, window_t *window) {
+  char piece[16 * 1024];
+
+  if (window->spill_len > 0 && fseeko(window->spill, 0, SEEK_SET) != 0) {
+    return -1;
+  }
+
+  while (window->spill_len > 0) {
+    size_t len = window->spill_len < sizeof(piece) ? window->spill_len
+                                                   : sizeof(piece);
+    if (fread(piece, sizeof(char), len, window->spill) != len ||
+        process_emit(state, piece, len) != 0) {
+      return -1;
+    }
+    window->spill_len -= len;
+  }
+
+  return 0;
+}
+
+/**
+ * Finds the start of the lines in front of the current line that can still be
+ * printed as context.
+ * @details A line that has been spilled is never context, it has been cut.
+ * @param window the window of the input
+ * @return Returns the start of the first line that can still be context.
+ */
+static size_t process_window_lower(const window_t *window) {
+  if (window->spilled == false) {
+    return window->context;
+  }
+
+  const char *end = memchr(window->buffer + window->line, '\n',
+                           window->filled - window->line);
+  return end == NULL ? window->filled : (size_t)(end - window->buffer) + 1;
+}
+
+/**
+ * Emits the lines that have been held in front of the spilled line.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param window the window of the input
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_window_held(const arguments_t *args, file_state_t *state,
+                               window_t *window) {
+  held_line_t held = {window->held, 0, 0, window->held_line,
+                      window->held_offset};
+  const char *end = window->held + window->held_len;
+
+  while (held.line < end) {
+    const char *line_end = memchr(held.line, '\n', end - held.line);
+    held.len = line_end - held.line + 1;
+    if (process_emit_held(args, state, &held) != 0) {
+      return -1;
+    }
+
+    held.line += held.len;
+    held.number += 1;
+    held.offset += held.len;
+  }
+
+  window->held_len = 0;
+
+  return 0;
+}
+
+/**
+ * Emits the current line of the window as a line of trailing context.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param window the window of the input
+ * @param line_end end of the current line, its newline is in the window
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_window_context(const arguments_t *args,
+                                  file_state_t *state, window_t *window,
+                                  size_t line_end) {
+  char *buffer = window->buffer;
+
+  if (window->spilled) {
+    if (process_emit_prefix(args, state, window->spilled_line,
+                            window->spilled_offset, '-') != 0 ||
+        process_window_replay(state, window) != 0) {
+      return -1;
+    }
+  } else if (process_emit_position(args, state, buffer + window->line, '-') !=
+             0) {
+    return -1;
+  }
+
+  if (process_emit(state, buffer + window->line, line_end - window->line) !=
+      0) {
+    return -1;
+  }
+
+  window->line = window->scan = window->context = line_end;
+  window->spilled = false;
+  window->spill_len = 0;
+  state->printed = window->offset + line_end;
+  state->after -= 1;
+
+  return 0;
+}
+
+/**
+ * Searches the window from 'window->scan' on and emits the matching lines.
+ * @details A match is final as soon as it is inside the window, even if its
+ * line goes on behind the window. The rest of such a line is emitted as it is
+ * read. While trailing context is missing the window is searched line per
+ * line, a line is only known to be context once its newline has been read.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param window the window of the input
+ * @return Returns 0 if the window has to be refilled, 1 if the rest of the
+ * input can be skipped, PROCESS_DONE if the whole search is finished and -1
+ * on error.
+ */
+static int process_window_search(arguments_t *args, file_state_t *state,
+                                 window_t *window) {
+  char *buffer = window->buffer;
+  const bool context = process_prints_context(args, state);
+
+  while (true) {
+    if (window->matched) {
+      const char *end =
+          memchr(buffer + window->line, '\n', window->filled - window->line);
+      size_t line_end = end == NULL ? window->filled : end - buffer + 1;
+
+      if (process_prints_lines(args, state) &&
+          process_emit(state, buffer + window->line,
+                       line_end - window->line) != 0) {
+        return -1;
+      }
+
+      window->line = window->scan = window->context = line_end;
+      if (end == NULL) {
+        return 0;
+      }
+      if (context) {
+        process_printed_match(args, state, window->offset + line_end);
+      }
+      if (window->finished && state->after == 0) {
+        return 1;
+      }
+
+      window->matched = false;
+      window->spilled = false;
+      window->spill_len = 0;
+    }
+
+    if (window->scan >= window->filled) {
+      return 0;
+    }
+
+    const char *hit;
+    if (context && state->after > 0) {
+      // the current line is printed in any case, but with which separator
+      const char *end =
+          memchr(buffer + window->line, '\n', window->filled - window->line);
+      size_t line_end = end == NULL ? window->filled : end - buffer + 1;
+
+      // like grep, the trailing context of the last match isn't searched
+      hit = window->finished
+                ? NULL
+                : matcher_find(&args->matcher, buffer + window->scan,
+                               line_end - window->scan);
+      if (hit == NULL) {
+        if (end == NULL) {
+          return 0;
+        }
+        if (process_window_context(args, state, window, line_end) != 0) {
+          return -1;
+        }
+        continue;
+      }
+    } else if (window->finished) {
+      return 1;
+    } else {
+      hit = matcher_find(&args->matcher, buffer + window->scan,
+                         window->filled - window->scan);
+      if (hit == NULL) {
+        return 0;
+      }
+    }
+
+    int stop = process_count_match(args, state);
+    if (stop == PROCESS_DONE) {
+      return PROCESS_DONE;
+    }
+
+    // there is no newline between 'line' and 'scan'
+    const char *line_start = hit;
+    while (line_start > buffer + window->line && line_start[-1] != '\n') {
+      line_start -= 1;
+    }
+
+    if (process_prints_lines(args, state)) {
+      bool spilled = window->spilled && line_start == buffer + window->line;
+
+      if (context) {
+        const char *before =
+            process_context_start(buffer + process_window_lower(window),
+                                  line_start, args->context_before);
+        off_t offset = spilled ? window->spilled_offset
+                               : window->offset + (line_start - buffer);
+
+        if ((spilled && process_window_held(args, state, window) != 0) ||
+            process_emit_context(args, state, before, line_start, false) !=
+                0 ||
+            process_emit_separator(args, state, offset) != 0) {
+          return -1;
+        }
+      }
+
+      if (spilled) {
+        if (process_emit_prefix(args, state, window->spilled_line,
+                                window->spilled_offset, ':') != 0 ||
+            process_window_replay(state, window) != 0) {
+          return -1;
+        }
+      } else if (process_emit_position(args, state, line_start, ':') != 0) {
+        return -1;
+      }
+    } else if (stop != 0) {
+      return 1;
+    }
+
+    window->line = window->context = line_start - buffer;
+    window->matched = true;
+    window->finished = stop != 0;
+  }
+}
+
+/**
+ * Holds the lines in front of the current line before it is spilled, they can
+ * still be printed as context if the line matches.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input, counted up to the current line
+ * @param window the window of the input
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_window_hold(const arguments_t *args,
+                               const file_state_t *state, window_t *window) {
+  window->held_len = 0;
+  if (process_prints_context(args, state) == false ||
+      window->context >= window->line) {
+    return 0;
+  }
+
+  if (window->held == NULL &&
+      (window->held = malloc(window->capacity / 4 * sizeof(char))) == NULL) {
+    return -1;
+  }
+
+  // 'process_window_advance' keeps at most a quarter of the window
+  window->held_len = window->line - window->context;
+  memcpy(window->held, window->buffer + window->context, window->held_len);
+  window->held_offset = window->offset + window->context;
+  window->held_line =
+      state->line - (long)search_count_newlines(window->buffer +
+                                                    window->context,
+                                                window->held_len);
+
+  return 0;
+}
+
+/**
+ * Makes room in the window for the next read.
+ * @details Complete lines without a match are dropped. The current line is
+ * moved to the start of the window, only its last 'overlap' bytes are searched
+ * again, so that a match across the end of the window is still found. If the
+ * line takes up more than half of the window, everything but these bytes
+ * leaves the window, into the spill file if the line could still be printed.
+ * Lines in front of the current line are kept as long as they can still be
+ * printed as context, but only up to a quarter of the window.
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @param window the window of the input
+ * @param overlap how many bytes a match can reach back into the searched part
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_window_advance(const arguments_t *args, file_state_t *state,
+                                  window_t *window, size_t overlap) {
+  char *buffer = window->buffer;
+
+  if (window->matched == false) {
+    window->context = process_window_lower(window);
+
+    // nothing between 'scan' and 'filled' has matched
+    for (size_t i = window->filled; i > window->scan; i -= 1) {
+      if (buffer[i - 1] == '\n') {
+        window->line = i;
+        window->spilled = false;
+        window->spill_len = 0;
+        break;
+      }
+    }
+
+    window->scan = window->line;
+    if (window->filled - window->line > overlap) {
+      window->scan = window->filled - overlap;
+    }
+
+    if (process_prints_context(args, state)) {
+      const char *keep =
+          process_context_start(buffer + window->context,
+                                buffer + window->line, args->context_before);
+      size_t limit = window->capacity / 4;
+      if ((size_t)(buffer + window->line - keep) > limit) {
+        // buffer[line - 1] is a newline, so there is a line start in reach
+        keep = buffer + window->line - limit;
+        keep = (const char *)memchr(keep, '\n', limit) + 1;
+      }
+      window->context = keep - buffer;
+    } else {
+      window->context = window->line;
+    }
+  }
+
+  size_t shift = window->context < window->line ? window->context
+                                                 : window->line;
+  if (window->filled - window->line > window->capacity / 2) {
+    shift = window->filled - overlap;
+
+    if (window->spilled == false) {
+      if (args->line_numbers) {
+        state->line += search_count_newlines(
+            state->counted, buffer + window->line - state->counted);
+        state->counted = buffer + window->line;
+      }
+      window->spilled = true;
+      window->spilled_line = state->line;
+      window->spilled_offset = window->offset + window->line;
+
+      if (process_window_hold(args, state, window) != 0) {
+        return -1;
+      }
+    }
+
+    if (process_prints_lines(args, state)) {
+      if (window->spill == NULL && (window->spill = tmpfile()) == NULL) {
+        return -1;
+      }
+      if (window->spill_len == 0 &&
+          fseeko(window->spill, 0, SEEK_SET) != 0) {
+        return -1;
+      }
+
+      size_t len = shift - window->line;
+      if (fwrite(buffer + window->line, sizeof(char), len, window->spill) !=
+          len) {
+        return -1;
+      }
+      window->spill_len += len;
+    }
+
+    window->line = window->context = shift;
+  }
+
+  if (shift == 0) {
+    return 0;
+  }
+
+  if (args->line_numbers) {
+    state->line +=
+        search_count_newlines(state->counted, buffer + shift - state->counted);
+  }
+
+  if (window->in_place) {
+    // 'reader_take' copies the rest in front of the next buffer
+    buffer += shift;
+    window->buffer = buffer;
+  } else {
+    memmove(buffer, buffer + shift, window->filled - shift);
+  }
+  window->filled -= shift;
+  window->line -= shift;
+  window->scan -= shift;
+  window->context = window->context > shift ? window->context - shift : 0;
+  window->offset += shift;
+  file_state_seek(state, buffer, window->offset, state->line);
 
   return 0;
 }
 
-int process_line(const char *line, arguments_t *args) {
-  char *current_line = strdup(line);
-  if (current_line == NULL) {
+/**
+ * Probes a piece of a stream with 'process_is_binary'.
+ * @details A stream is read in pieces of any size, so a character may be cut
+ * by the end of a piece. Its missing bytes at the start of the next piece
+ * only have to be continuation bytes.
+ * @param piece the bytes that have been read
+ * @param len length of piece in bytes
+ * @param cut how many continuation bytes the previous piece still misses,
+ * updated for the next piece
+ * @return Returns 'true' if the piece looks binary.
+ */
+static bool process_probe_piece(const char *piece, size_t len, size_t *cut) {
+  size_t skip = 0;
+  for (; skip < *cut && skip < len; skip += 1) {
+    if (((unsigned char)piece[skip] & 0xC0) != 0x80) {
+      return true;
+    }
+  }
+  *cut -= skip;
+
+  if (process_is_binary(piece + skip, len - skip)) {
+    return true;
+  }
+
+  for (size_t back = 1; back <= 3 && back <= len - skip; back += 1) {
+    unsigned char byte = piece[len - back];
+    if ((byte & 0xC0) == 0x80) {
+      continue;
+    }
+
+    size_t need = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+    *cut = need > back ? need - back : 0;
+    break;
+  }
+
+  return false;
+}
+
+/**
+ * Moves the window onto the next buffer of the reader.
+ * @param reader the reader thread of the input
+ * @param state the state of the input, its positions are moved along
+ * @param window the window of the input, its bytes are carried over
+ * @return Returns how many bytes have been added to the window, 0 at the end
+ * of the input and -1 on error.
+ */
+static ssize_t process_window_take(reader_t *reader, file_state_t *state,
+                                   window_t *window) {
+  char *data;
+  ssize_t len = reader_take(reader, window->buffer, window->filled, &data);
+  if (len <= 0) {
+    return len;
+  }
+
+  size_t counted =
+      window->buffer != NULL ? (size_t)(state->counted - window->buffer) : 0;
+  window->buffer = data;
+  state->start = data;
+  state->counted = data + counted;
+
+  return len - window->filled;
+}
+
+/**
+ * Reads the given file through a window of fixed size and searches it.
+ * @details Unlike 'process_stream' no line is ever held as a whole, a line
+ * longer than the window is searched piece by piece and, if it matches,
+ * emitted piece by piece. Only keywords of a bounded length can be searched
+ * like this. The buffers of a reader thread are searched in place, only the
+ * bytes the window keeps are copied in front of the next buffer.
+ * @param file file to read from, nothing must have been read with stdio yet
+ * @param reader reader thread to read from instead of file or NULL
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int process_window(FILE *file, reader_t *reader, arguments_t *args,
+                          file_state_t *state) {
+  if (args->max_count == 0) {
+    return 0;
+  }
+
+  int fd = fileno(file);
+  if (fd == -1) {
     return -1;
   }
 
-  char *result;
-  if (args->case_sensitive) {
-    result = strstr(current_line, args->keyword);
+  size_t overlap = args->matcher.longest > 0 ? args->matcher.longest - 1 : 0;
+  window_t window = {0};
+  window.capacity = PROCESS_WINDOW_SIZE;
+  while (window.capacity < 4 * (overlap + 1)) {
+    window.capacity *= 2;
+  }
+
+  window.in_place = reader != NULL && window.capacity <= READER_HEADROOM;
+  if (window.in_place == false) {
+    window.buffer = malloc(window.capacity * sizeof(char));
+    if (window.buffer == NULL) {
+      return -1;
+    }
+  }
+
+  // the offsets of a decompressed input are those of the decompressed bytes
+  window.offset = reader != NULL ? 0 : ftello(file);
+  if (window.offset == -1) {
+    window.offset = 0;
+  }
+  file_state_seek(state, window.buffer, window.offset, 1);
+
+  int result = 0;
+  size_t cut = 0;
+  char last = '\n';
+  while (result == 0) {
+    long long started = args->stats ? stats_now() : 0;
+    ssize_t len;
+    if (window.in_place) {
+      len = process_window_take(reader, state, &window);
+    } else if (reader != NULL) {
+      len = reader_read(reader, window.buffer + window.filled,
+                        window.capacity - window.filled);
+    } else {
+      len = read(fd, window.buffer + window.filled,
+                 window.capacity - window.filled);
+    }
+    if (args->stats) {
+      state->stats.io_ns += stats_now() - started;
+    }
+    if (len == -1 && errno == EINTR) {
+      continue;
+    }
+    if (len == -1) {
+      result = -1;
+      break;
+    }
+    if (len == 0) {
+      break;
+    }
+
+    // a stream can't be looked at in advance, so its first bytes are probed
+    if (args->binary_files != E_BINARY_TEXT &&
+        state->probed < PROCESS_BINARY_PROBE) {
+      state->probed += len;
+      if (process_probe_piece(window.buffer + window.filled, len, &cut)) {
+        if (args->binary_files == E_BINARY_SKIP) {
+          break;
+        }
+        state->binary = true;
+        state->probed = PROCESS_BINARY_PROBE;
+      }
+    }
+    if (args->stats) {
+      // a line that is still cut is only counted once its newline is read
+      state->stats.bytes += len;
+      state->stats.lines +=
+          search_count_newlines(window.buffer + window.filled, len);
+      last = window.buffer[window.filled + len - 1];
+    }
+    window.filled += len;
+
+    result = process_window_search(args, state, &window);
+    if (result == 0) {
+      result = process_window_advance(args, state, &window, overlap);
+    }
+  }
+
+  if (result == 0 && state->after > 0 && window.matched == false &&
+      window.line < window.filled &&
+      process_prints_context(args, state)) {
+    // the last line has no newline, but is context nevertheless
+    result = process_window_context(args, state, &window, window.filled);
+  }
+
+  if (last != '\n') {
+    state->stats.lines += 1;
+  }
+
+  if (window.spill != NULL) {
+    fclose(window.spill);
+  }
+  free(window.held);
+  if (window.in_place == false) {
+    free(window.buffer);
+  }
+
+  // 1 only means that the rest of the file can be skipped
+  return result == 1 ? 0 : result;
+}
+
+/**
+ * @brief The last lines of a stream that haven't been printed.
+ */
+typedef struct held_lines {
+  held_line_t *lines; ///< ring of at most 'context_before' lines
+  long capacity;      ///< how many lines have been allocated
+  long head;          ///< index of the oldest line
+  long num;           ///< how many lines are held
+} held_lines_t;
+
+/**
+ * Holds the current line of a stream, it could be leading context of a later
+ * match.
+ * @details The buffer of the line is swapped with the one of the oldest held
+ * line, so getline reads the next line into a recycled buffer.
+ * @param line the buffer of getline, replaced with a recycled one
+ * @param capacity capacity of line, updated with it
+ * @param len length of the line in bytes
+ * @param args pointer to an arguments_t
+ * @param state the state of the input, the line has been seeked to
+ * @param held the held lines
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_hold_line(char **line, size_t *capacity, size_t len,
+                             const arguments_t *args,
+                             const file_state_t *state, held_lines_t *held) {
+  if (held->num == held->capacity && held->capacity < args->context_before) {
+    // nothing has been dropped yet, so the ring starts at index 0
+    long grown_capacity = held->capacity == 0 ? 4 : held->capacity * 2;
+    if (grown_capacity > args->context_before) {
+      grown_capacity = args->context_before;
+    }
+    held_line_t *grown =
+        realloc(held->lines, grown_capacity * sizeof(held_line_t));
+    if (grown == NULL) {
+      return -1;
+    }
+    memset(grown + held->capacity, 0,
+           (grown_capacity - held->capacity) * sizeof(held_line_t));
+
+    held->lines = grown;
+    held->capacity = grown_capacity;
+  }
+
+  held_line_t *slot;
+  if (held->num == held->capacity) {
+    slot = &held->lines[held->head];
+    held->head = (held->head + 1) % held->capacity;
   } else {
-    to_lowercase(current_line);
-    result = strstr(current_line, args->keyword);
-    // The strcasestr() function is a nonstandard extension.
-    // https://linux.die.net/man/3/strcasestr
-    // result = strcasestr(current_line, args->keyword);
+    slot = &held->lines[(held->head + held->num) % held->capacity];
+    held->num += 1;
+  }
+
+  char *recycled = slot->line;
+  size_t recycled_capacity = slot->capacity;
+  slot->line = *line;
+  slot->capacity = *capacity;
+  slot->len = len;
+  slot->number = state->line;
+  slot->offset = state->offset;
+  *line = recycled;
+  *capacity = recycled_capacity;
+
+  return 0;
+}
+
+/**
+ * Handles the context around the current line of a stream.
+ * @param line the buffer of getline, may be replaced with a recycled one
+ * @param capacity capacity of line, updated with it
+ * @param len length of the line in bytes
+ * @param matches 'true' if the line is printed as a matching line
+ * @param args pointer to an arguments_t
+ * @param state the state of the input, the line has been seeked to
+ * @param held the held lines
+ * @return Returns 0 if non error has been encountered.
+ */
+static int process_stream_context(char **line, size_t *capacity, size_t len,
+                                  bool matches, const arguments_t *args,
+                                  file_state_t *state, held_lines_t *held) {
+  if (matches) {
+    for (long i = 0; i < held->num; i += 1) {
+      const held_line_t *before =
+          &held->lines[(held->head + i) % held->capacity];
+      if (process_emit_held(args, state, before) != 0) {
+        return -1;
+      }
+    }
+    held->head = 0;
+    held->num = 0;
+
+    return process_emit_separator(args, state, state->offset);
   }
 
-  if (result != NULL) {
-    output_printf(line);
+  if (state->after > 0) {
+    held_line_t current = {*line, *capacity, len, state->line, state->offset};
+    state->after -= 1;
+    return process_emit_held(args, state, &current);
   }
 
-  free(current_line);
+  if (args->context_before > 0) {
+    return process_hold_line(line, capacity, len, args, state, held);
+  }
 
   return 0;
 }
+
+/**
+ * Reads the given file line per line and process it.
+ * @details With context, lines that may still be printed as leading context
+ * are held back in the recycled buffers of getline.
+ * @param file file to read from
+ * @param reader reader thread to read from instead of file or NULL
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * whole search is finished.
+ */
+static int process_stream(FILE *file, reader_t *reader, arguments_t *args,
+                          file_state_t *state) {
+  if (args->max_count == 0) {
+    return 0;
+  }
+
+  size_t len = 256;
+  char *line = malloc(len * sizeof(char));
+  if (line == NULL) {
+    return -1;
+  }
+
+  held_lines_t held = {0};
+  int result = 0;
+  bool stopped = false;
+  ssize_t read;
+  // a line of a reader mostly stays in its buffer, see 'reader_getline'
+  const char *current = NULL;
+  off_t offset = reader != NULL ? 0 : ftello(file);
+  long line_number = 1;
+  if (offset == -1) {
+    offset = 0;
+  }
+  long long started = args->stats ? stats_now() : 0;
+  while ((read = reader != NULL ? reader_getline(reader, &current, &line, &len)
+                                : getline(&line, &len, file)) != -1) {
+    if (reader == NULL) {
+      current = line;
+    }
+    if (args->stats) {
+      long long now = stats_now();
+      state->stats.io_ns += now - started;
+      state->stats.bytes += read;
+      state->stats.lines += 1;
+      started = now;
+    }
+
+    // one line at a time, so nothing has to be counted
+    file_state_seek(state, current, offset, line_number);
+    offset += read;
+    line_number += 1;
+
+    // a stream can't be looked at in advance, so its first lines are probed
+    if (args->binary_files != E_BINARY_TEXT &&
+        state->probed < PROCESS_BINARY_PROBE) {
+      state->probed += read;
+      if (process_is_binary(current, read)) {
+        if (args->binary_files == E_BINARY_SKIP) {
+          break;
+        }
+        state->binary = true;
+        state->probed = PROCESS_BINARY_PROBE;
+      }
+    }
+
+    if (current != line && process_prints_context(args, state)) {
+      // held lines keep the buffer of their line, so it has to be its own
+      if ((size_t)read > len) {
+        char *grown = realloc(line, read);
+        if (grown == NULL) {
+          result = -1;
+          break;
+        }
+        line = grown;
+        len = read;
+      }
+      memcpy(line, current, read);
+      current = line;
+      file_state_seek(state, current, state->offset, state->line);
+    }
+
+    if (process_prints_context(args, state) == false) {
+      result = stopped ? 1 : process_line(current, read, args, state);
+    } else if (stopped) {
+      // only the trailing context of the last match is missing
+      result = process_stream_context(&line, &len, read, false, args, state,
+                                      &held);
+    } else {
+      bool matches = matcher_find(&args->matcher, line, read) != NULL;
+      result = process_stream_context(&line, &len, read, matches, args,
+                                      state, &held);
+      if (result == 0 && matches) {
+        result = process_line(line, read, args, state);
+        process_printed_match(args, state, state->offset + read);
+      }
+    }
+    if (result == 1 && state->after > 0) {
+      stopped = true;
+      result = 0;
+    }
+    if (result != 0 || (stopped && state->after == 0)) {
+      break;
+    }
+
+    if (args->stats) {
+      started = stats_now();
+    }
+  }
+
+  if (result == 0 && reader != NULL && reader_failed(reader)) {
+    result = -1;
+  }
+
+  free(line);
+  for (long i = 0; i < held.capacity; i += 1) {
+    free(held.lines[i].line);
+  }
+  free(held.lines);
+
+  // 1 only means that the rest of the file can be skipped
+  return result == 1 ? 0 : result;
+}
+
+/**
+ * Searches a single line and emits it if it matches.
+ * @param line the line, including the newline if there is one
+ * @param len length of line in bytes
+ * @param args pointer to an arguments_t
+ * @param state the state of the input
+ * @return Returns 0 to continue with the next line, 1 if the rest of the input
+ * can be skipped, PROCESS_DONE if the whole search is finished and -1 on
+ * error.
+ */
+int process_line(const char *line, size_t len, arguments_t *args,
+                 file_state_t *state) {
+  if (matcher_find(&args->matcher, line, len) == NULL) {
+    return 0;
+  }
+
+  int stop = process_count_match(args, state);
+  if (stop == PROCESS_DONE) {
+    return PROCESS_DONE;
+  }
+
+  if (process_prints_lines(args, state) &&
+      (process_emit_position(args, state, line, ':') != 0 ||
+       process_emit(state, line, len) != 0)) {
+    return -1;
+  }
+
+  return stop;
+}
@@ -9,28 +9,162 @@
 #ifndef _LOGIC_H
 #define _LOGIC_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <sys/types.h>
 
 #include "arguments.h"
+#include "output.h"
+#include "stats.h"
+
+/**
+ * Returned if the whole search is finished early, e.g. by the first match of
+ * '-q'. Nothing else has to be searched.
+ */
+#define PROCESS_DONE 2
+
+/**
+ * How many bytes at the start of a file are checked by 'process_is_binary'.
+ */
+#define PROCESS_BINARY_PROBE (32 * 1024)
+
+/**
+ * Size of the window a stream is read through. Lines longer than half of it
+ * are never held as a whole.
+ */
+#define PROCESS_WINDOW_SIZE (256 * 1024)
+
+/**
+ * @brief State of the input that is currently searched.
+ */
+typedef struct file_state {
+  const char *name;     ///< name of the input, printed by '-l' and '-c'
+  output_buffer_t *out; ///< buffer to collect the output in or NULL to write
+                        ///< directly to the output
+  long matches;         ///< how many lines have matched so far
+  bool binary; ///< 'true' if the input is binary, its lines are never printed
+  size_t probed; ///< how many bytes have been checked by 'process_is_binary'
+
+  const char *start;   ///< start of the buffer that is searched
+  off_t offset;        ///< offset of 'start' in the input ('-b')
+  const char *counted; ///< newlines before this position are counted ('-n')
+  long line;           ///< line number of the line at 'counted'
+
+  off_t printed; ///< offset behind the last printed line, -1 if none has been
+                 ///< printed yet ('-A', '-B', '-C')
+  long after;    ///< how many lines of trailing context are still printed
+
+  stats_t stats; ///< what searching the input has cost ('--stats')
+} file_state_t;
 
 /**
  * Goes threw all files inside the args, opens the and calls 'process_file' for
  * each file.
  * @brief Goes threw all files inside the args, opens the and calls
- * 'process_file' for each file.
+ * 'process_file' for each file. With more than one thread the files are
+ * searched in parallel by 'parallel_process_files'. With '-r' every file
+ * below the paths is searched instead, see 'walk_paths'.
  * @param args pointer to an arguments_t
- * @return Returns 0 if non error has been encountered.
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
  */
 int process_files(arguments_t *args);
 
 /**
- * Reads the given file line per line and process it.
- * @brief This functions reads the given file line per line, process it via the
- * private function in logic.c 'process_line' and prints the result if any.
+ * Searches the given file and prints every line that contains the keyword.
+ * @brief Regular files are memory mapped and searched as a whole, only the
+ * lines around a match are looked at. Everything else (e.g. stdin from a pipe)
+ * is read through a window of 'PROCESS_WINDOW_SIZE' bytes, a line that is
+ * longer than the window is searched and printed in pieces. Regular
+ * expressions and keywords with a newline are read line per line and
+ * processed via the private function in logic.c 'process_line'. The scan
+ * stops as soon as the output mode of args allows it, e.g. after the first
+ * match for '-l' or after '-m' matches. Binary files are handled as set by
+ * 'args->binary_files'. A regular file that starts with the magic bytes of
+ * gzip is decompressed by a reader thread while it is searched, in place in
+ * the buffers it is inflated into, see 'reader_start_gzip'. Lines of context
+ * ('-A', '-B', '-C') are only looked for around the matches, in the window the
+ * leading context is limited to a quarter of it.
+ * @param file file to read from
+ * @param name name of the file, printed by '-l' and '-c'
+ * @param args pointer to an arguments_t
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int process_file(FILE *file, const char *name, arguments_t *args);
+
+/**
+ * Same as 'process_file' but collects the matching lines in out instead of
+ * writing them to the output.
+ * @brief Used by the worker threads, which must not write to the output
+ * themselves to keep the order of the files.
  * @param file file to read from
+ * @param name name of the file, printed by '-l' and '-c'
+ * @param args pointer to an arguments_t
+ * @param out buffer to collect the matching lines in
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int process_file_buffered(FILE *file, const char *name, arguments_t *args,
+                          output_buffer_t *out);
+
+/**
+ * Searches the whole buffer for the keyword and collects every line that
+ * contains it.
+ * @brief The buffer is searched as one block, the surrounding newlines are
+ * only looked for when the keyword has been found. Afterwards the search
+ * continues after the emitted line. This only works as long as the keyword
+ * doesn't contain a newline itself.
+ * @param buffer the bytes to search, does not have to be NUL terminated. If
+ * 'state->out' is NULL it has to stay valid until 'output_flush' has been
+ * called.
+ * @param len length of buffer in bytes
+ * @param args pointer to an arguments_t
+ * @param state the state of the input, the matches are added to it
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int process_buffer(const char *buffer, size_t len, arguments_t *args,
+                   file_state_t *state);
+
+/**
+ * Emits the summary of an input for '-l', '-c' and binary files.
  * @param args pointer to an arguments_t
+ * @param state the state of the finished input
  * @return Returns 0 if non error has been encountered.
  */
-int process_file(FILE *file, arguments_t *args);
+int process_finish(const arguments_t *args, file_state_t *state);
+
+/**
+ * Initializes the state of an input.
+ * @param state the file_state_t that should be initialized.
+ * @param name name of the input
+ * @param out buffer to collect the output in or NULL
+ */
+void file_state_init(file_state_t *state, const char *name,
+                     output_buffer_t *out);
+
+/**
+ * Moves the state to a new buffer.
+ * @brief The line numbers and byte offsets of the matches in the buffer are
+ * computed relative to its start.
+ * @param state the state of the input
+ * @param start start of the buffer that is searched next
+ * @param offset offset of start in the input
+ * @param line line number of the line at start
+ */
+void file_state_seek(file_state_t *state, const char *start, off_t offset,
+                     long line);
+
+/**
+ * Checks if a buffer looks like the content of a binary file.
+ * @brief Like grep, only the first 'PROCESS_BINARY_PROBE' bytes are looked at,
+ * see 'search_is_binary'.
+ * @param buffer the bytes to check
+ * @param len length of buffer in bytes
+ * @return Returns true if the buffer is binary.
+ */
+bool process_is_binary(const char *buffer, size_t len);
 
 #endif /* _LOGIC_H */
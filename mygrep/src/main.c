@@ -14,13 +14,35 @@
 #include <string.h>
 
 #include "arguments.h"
+#include "batch.h"
+#include "follow.h"
+#include "index.h"
 #include "logic.h"
 #include "output.h"
+#include "stats.h"
 
+/** Usage message for this program */
 const char *USAGE =
-    "SYNOPSIS\n\tmygrep[-i][-o outfile] keyword [file...]\n"; /**< Usage message
-                                                                 for this
-                                                                 program */
+    "SYNOPSIS\n"
+    "\tmygrep[-E][-i][-k edits][-n][-b][-r][-I|-a][-l|-c|-q][-m num]"
+    "[-j threads][-o outfile] keyword [file...]\n"
+    "\tmygrep[-E][-i][-n][-b][-r][-I|-a][-l|-c|-q][-m num][-j threads]"
+    "[-o outfile] -e keyword...|-f keywordfile [file...]\n"
+    "\tmygrep[-n][-b][-r][-I|-a][-l|-c|-q][-m num][-j threads][-o outfile] "
+    "-F patterns.mgp [file...]\n"
+    "\tmygrep[-j threads] --index dir\n"
+    "\tmygrep[-i] --compile-patterns keywordfile -o patterns.mgp\n"
+    "\tmygrep[-i][-n][-b] --batch keyword=outfile... [file...]\n"
+    "\tmygrep[-E][-i][-n][-b][-l|-c|-q][-m num][-j threads][-o outfile] "
+    "--use-index dir keyword\n"
+    "\tmygrep[-E][-i][-n][-b][-I|-a][-l|-q][-m num][-o outfile] --follow "
+    "keyword file...\n"
+    "\t-I is --binary-files=without-match, -a is --binary-files=text\n"
+    "\t-k edits matches a single keyword within that many edits\n"
+    "\t-A num, -B num and -C num print num lines of context after, before "
+    "and around every matching line\n"
+    "\t--stats prints the throughput and timing as JSON to stderr\n"
+    "\tfiles compressed with gzip are searched as if they were decompressed\n";
 
 /**
  * Program entry point.
@@ -28,7 +50,8 @@ const char *USAGE =
  * @details The program starts here.
  * @param argc The argument counter.
  * @param argv The argument vector.
- * @return Returns EXIT_SUCCESS if no error occurred while running.
+ * @return Returns EXIT_SUCCESS if no error occurred while running. With '-q'
+ * EXIT_SUCCESS is only returned if a line has matched.
  */
 int main(int argc, char **argv) {
   arguments_t args;
@@ -39,6 +62,37 @@ int main(int argc, char **argv) {
     return EXIT_FAILURE;
   }
 
+  if (args.index_mode == E_INDEX_BUILD) {
+    int built = index_build(args.index_dir, args.threads);
+    if (built != 0) {
+      fprintf(stderr, "%s\nError while trying to build the index.\n",
+              argv[0]);
+    }
+    arguments_free(&args);
+    return built == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (args.compile_patterns != NULL) {
+    int compiled = matcher_compile(args.keywords, args.keywords_num,
+                                   !args.case_sensitive, args.output_file);
+    if (compiled != 0) {
+      fprintf(stderr, "%s\nError while trying to compile the patterns.\n",
+              argv[0]);
+    }
+    arguments_free(&args);
+    return compiled == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (args.batch_files_num > 0) {
+    int searched = batch_search(&args);
+    if (searched != 0) {
+      fprintf(stderr, "%s\nError while trying to search the batch.\n",
+              argv[0]);
+    }
+    arguments_free(&args);
+    return searched == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   if (args.output_file == NULL) {
     output_init_stdout();
   } else {
@@ -51,21 +105,55 @@ int main(int argc, char **argv) {
 
   // arguments_print(&args);
 
-  if (args.input_files_num == 0) {
-    if (process_file(stdin, &args) != 0) {
+  if (args.stats) {
+    stats_init();
+  }
+
+  int result;
+  if (args.index_mode == E_INDEX_QUERY) {
+    result = index_query(&args);
+    if (result != 0 && result != PROCESS_DONE) {
+      fprintf(stderr, "%s\nError while trying to search the index.\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  } else if (args.follow) {
+    result = follow_files(&args);
+    if (result != 0 && result != PROCESS_DONE) {
+      fprintf(stderr, "%s\nError while trying to follow the given files.\n",
+              argv[0]);
+      return EXIT_FAILURE;
+    }
+  } else if (args.input_files_num == 0) {
+    result = process_file(stdin, "(standard input)", &args);
+    if (result != 0 && result != PROCESS_DONE) {
       fprintf(stderr, "%s\nError while trying to read from stdin.\n", argv[0]);
       return EXIT_FAILURE;
     }
   } else {
-    if (process_files(&args) != 0) {
+    result = process_files(&args);
+    if (result != 0 && result != PROCESS_DONE) {
       fprintf(stderr, "%s\nError while trying to read from the given files.\n",
               argv[0]);
       return EXIT_FAILURE;
     }
   }
 
+  // '-q' finishes the search with the first match
+  bool quiet_failed =
+      args.output_mode == E_OUTPUT_QUIET && result != PROCESS_DONE;
+
+  if (args.stats) {
+    // the statistics include the last flush
+    output_flush();
+    if (stats_print(output_time()) != 0) {
+      fprintf(stderr, "%s\nError while trying to print the statistics.\n",
+              argv[0]);
+    }
+  }
+
   arguments_free(&args);
   output_free();
 
-  return EXIT_SUCCESS;
+  return quiet_failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }
@@ -0,0 +1,401 @@
+/**
+ * @file matcher.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a common interface for the different ways to match a line.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "aho_corasick.h"
+#include "approx.h"
+#include "dfa.h"
+#include "matcher.h"
+#include "search.h"
+
+/**
+ * Identifies a compiled pattern file, the version is part of it.
+ */
+#define MATCHER_FILE_MAGIC "MGPAC\0\0\1"
+
+/**
+ * Written as a number, a file from a machine with another byte order reads it
+ * differently.
+ */
+#define MATCHER_FILE_BYTE_ORDER (0x01020304u)
+
+/**
+ * Alignment of the transition table inside the file, a cache line.
+ */
+#define MATCHER_FILE_ALIGNMENT (64)
+
+/**
+ * Set in 'matcher_file_header_t.flags' if one of the keywords is empty.
+ */
+#define MATCHER_FILE_EMPTY (1u << 0)
+
+/**
+ * Set in 'matcher_file_header_t.flags' if a keyword contains a newline.
+ */
+#define MATCHER_FILE_MULTILINE (1u << 1)
+
+/**
+ * Set in 'matcher_file_header_t.flags' if the haystack has to be folded like
+ * the keywords, see 'aho_corasick_t.fold_utf8'.
+ */
+#define MATCHER_FILE_FOLD_UTF8 (1u << 2)
+
+/**
+ * @brief The start of a compiled pattern file.
+ */
+typedef struct matcher_file_header {
+  char magic[8];        ///< MATCHER_FILE_MAGIC
+  uint32_t byte_order;  ///< MATCHER_FILE_BYTE_ORDER
+  uint32_t flags;       ///< MATCHER_FILE_EMPTY, MATCHER_FILE_MULTILINE and
+                        ///< MATCHER_FILE_FOLD_UTF8
+  uint32_t states_num;  ///< how many states the automaton has
+  uint32_t classes_num; ///< how many columns a row of the table has
+  uint64_t longest;     ///< length of the longest keyword
+  uint64_t table;       ///< offset of the transition table
+  uint64_t accepting;   ///< offset of the accepting flags
+  uint64_t len;         ///< length of the whole file
+
+  uint16_t classes[256]; ///< column of every byte value
+} matcher_file_header_t;
+
+/**
+ * Compiles all expressions into one lazy DFA.
+ * @details More than one expression is joined to '(a)|(b)|...'.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int matcher_init_regex(matcher_t *matcher, char **keywords,
+                              int keywords_num, bool ignore_case) {
+  matcher->type = E_MATCHER_REGEX;
+
+  if (keywords_num == 1) {
+    return dfa_compile(&matcher->regex, keywords[0], ignore_case);
+  }
+
+  size_t len = 1;
+  for (int i = 0; i < keywords_num; i += 1) {
+    len += strlen(keywords[i]) + 3;
+  }
+
+  char *joined = malloc(len);
+  if (joined == NULL) {
+    return -1;
+  }
+
+  joined[0] = '\0';
+  for (int i = 0; i < keywords_num; i += 1) {
+    if (i > 0) {
+      strcat(joined, "|");
+    }
+    strcat(joined, "(");
+    strcat(joined, keywords[i]);
+    strcat(joined, ")");
+  }
+
+  int result = dfa_compile(&matcher->regex, joined, ignore_case);
+  free(joined);
+
+  return result;
+}
+
+/**
+ * Finds the length of the longest keyword and if one contains a newline.
+ */
+static void matcher_measure(matcher_t *matcher, char **keywords,
+                            int keywords_num) {
+  matcher->multiline = false;
+  matcher->longest = 0;
+
+  for (int i = 0; i < keywords_num; i += 1) {
+    if (strchr(keywords[i], '\n') != NULL) {
+      matcher->multiline = true;
+    }
+
+    size_t len = strlen(keywords[i]);
+    if (len > matcher->longest) {
+      matcher->longest = len;
+    }
+  }
+}
+
+int matcher_init(matcher_t *matcher, char **keywords, int keywords_num,
+                 bool ignore_case, bool regex, int edits) {
+  matcher->multiline = false;
+  matcher->longest = 0;
+  matcher->mapping = NULL;
+
+  if (regex) {
+    // the DFA matches every line on its own
+    return matcher_init_regex(matcher, keywords, keywords_num, ignore_case);
+  }
+
+  matcher_measure(matcher, keywords, keywords_num);
+
+  if (keywords_num == 1 && edits > 0) {
+    // a match can have an insertion per edit
+    matcher->type = E_MATCHER_APPROX;
+    matcher->longest += edits;
+    return approx_init(&matcher->approx, keywords[0], edits, ignore_case);
+  }
+
+  if (keywords_num == 1) {
+    matcher->type = E_MATCHER_LITERAL;
+    search_init(&matcher->literal, keywords[0], ignore_case);
+    return 0;
+  }
+
+  // a vector kernel per keyword beats stepping an automaton byte per byte,
+  // an empty keyword or one that spans lines is left to the automaton
+  bool few = keywords_num <= MATCHER_FEW_MAX && matcher->multiline == false;
+  for (int i = 0; few && i < keywords_num; i += 1) {
+    few = keywords[i][0] != '\0';
+  }
+
+  if (few) {
+    matcher->type = E_MATCHER_FEW;
+    matcher->few_num = keywords_num;
+    for (int i = 0; i < keywords_num; i += 1) {
+      search_init(&matcher->few[i], keywords[i], ignore_case);
+    }
+    return 0;
+  }
+
+  matcher->type = E_MATCHER_MULTI;
+  return ac_init(&matcher->multi, keywords, keywords_num, ignore_case);
+}
+
+/**
+ * Finds the first occurrence of any of a few keywords.
+ * @details Every keyword is searched on its own by the search kernels. The
+ * input is searched in windows that grow while nothing is found, so a
+ * keyword that occurs late (or never) doesn't make the others search the
+ * whole input. Within a window a keyword is only searched up to the first
+ * occurrence found so far.
+ * @return Returns a pointer to the first occurrence or NULL.
+ */
+static const char *matcher_find_few(const matcher_t *matcher,
+                                    const char *haystack,
+                                    size_t haystack_len) {
+  const char *end = haystack + haystack_len;
+  const char *current = haystack;
+  size_t window = MATCHER_WINDOW_MIN;
+
+  while (current < end) {
+    size_t left = end - current;
+    size_t len = left < window ? left : window;
+    const char *first = NULL;
+
+    for (int i = 0; i < matcher->few_num; i += 1) {
+      const search_t *search = &matcher->few[i];
+
+      // an occurrence has to start in front of the first one found so far
+      size_t starts = first != NULL ? (size_t)(first - current) : len;
+      size_t reach = starts + search->needle_len - 1;
+      if (reach > left) {
+        reach = left;
+      }
+
+      const char *found = search_find(search, current, reach);
+      if (found != NULL) {
+        first = found;
+      }
+    }
+
+    if (first != NULL) {
+      return first;
+    }
+
+    current += len;
+    if (window < MATCHER_WINDOW_MAX) {
+      window *= 2;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Writes the header and the automaton of a compiled pattern file.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int matcher_write(const matcher_t *matcher, FILE *file) {
+  const aho_corasick_t *ac = &matcher->multi;
+  size_t table_len = (size_t)ac->states_num * ac->classes_num *
+                     sizeof(uint32_t);
+
+  matcher_file_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MATCHER_FILE_MAGIC, sizeof(header.magic));
+  header.byte_order = MATCHER_FILE_BYTE_ORDER;
+  header.flags = (ac->matches_empty ? MATCHER_FILE_EMPTY : 0) |
+                 (matcher->multiline ? MATCHER_FILE_MULTILINE : 0) |
+                 (ac->fold_utf8 ? MATCHER_FILE_FOLD_UTF8 : 0);
+  header.states_num = ac->states_num;
+  header.classes_num = ac->classes_num;
+  header.longest = matcher->longest;
+  header.table = (sizeof(header) + MATCHER_FILE_ALIGNMENT - 1) /
+                 MATCHER_FILE_ALIGNMENT * MATCHER_FILE_ALIGNMENT;
+  header.accepting = header.table + table_len;
+  header.len = header.accepting + ac->states_num;
+  memcpy(header.classes, ac->classes, sizeof(header.classes));
+
+  static const char padding[MATCHER_FILE_ALIGNMENT] = {0};
+  size_t padding_len = header.table - sizeof(header);
+
+  if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+      fwrite(padding, 1, padding_len, file) != padding_len ||
+      fwrite(ac->table, 1, table_len, file) != table_len ||
+      fwrite(ac->accepting, 1, ac->states_num, file) != ac->states_num) {
+    return -1;
+  }
+
+  return 0;
+}
+
+int matcher_compile(char **keywords, int keywords_num, bool ignore_case,
+                    const char *path) {
+  matcher_t matcher;
+  matcher_measure(&matcher, keywords, keywords_num);
+  if (ac_init(&matcher.multi, keywords, keywords_num, ignore_case) != 0) {
+    return -1;
+  }
+
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    ac_free(&matcher.multi);
+    return -1;
+  }
+
+  int result = matcher_write(&matcher, file);
+  if (fclose(file) != 0) {
+    result = -1;
+  }
+  ac_free(&matcher.multi);
+
+  return result;
+}
+
+/**
+ * Checks the header of a compiled pattern file against the length of the
+ * file.
+ * @return Returns 0 if the header describes a file of this length.
+ */
+static int matcher_check_header(const matcher_file_header_t *header,
+                                size_t len) {
+  if (len < sizeof(matcher_file_header_t) ||
+      memcmp(header->magic, MATCHER_FILE_MAGIC, sizeof(header->magic)) != 0 ||
+      header->byte_order != MATCHER_FILE_BYTE_ORDER || header->len != len ||
+      header->states_num == 0 || header->classes_num == 0 ||
+      header->classes_num > 256 ||
+      header->table % MATCHER_FILE_ALIGNMENT != 0 ||
+      header->table < sizeof(matcher_file_header_t)) {
+    return -1;
+  }
+
+  uint64_t table_len =
+      (uint64_t)header->states_num * header->classes_num * sizeof(uint32_t);
+  if (header->accepting != header->table + table_len ||
+      header->len != header->accepting + header->states_num) {
+    return -1;
+  }
+
+  for (int c = 0; c < 256; c += 1) {
+    if (header->classes[c] >= header->classes_num) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+int matcher_load(matcher_t *matcher, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return -1;
+  }
+
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1 || file_stat.st_size <= 0) {
+    close(fd);
+    return -1;
+  }
+
+  size_t len = file_stat.st_size;
+  void *mapping = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return -1;
+  }
+
+  const matcher_file_header_t *header = mapping;
+  if (matcher_check_header(header, len) != 0) {
+    munmap(mapping, len);
+    return -1;
+  }
+
+  aho_corasick_t *ac = &matcher->multi;
+  // the automaton is only read, so it can point into the mapping
+  ac->table = (uint32_t *)((char *)mapping + header->table);
+  ac->accepting = (uint8_t *)mapping + header->accepting;
+  ac->states_num = header->states_num;
+  ac->classes_num = header->classes_num;
+  memcpy(ac->classes, header->classes, sizeof(ac->classes));
+  ac->matches_empty = (header->flags & MATCHER_FILE_EMPTY) != 0;
+  ac->fold_utf8 = (header->flags & MATCHER_FILE_FOLD_UTF8) != 0;
+  ac_init_starts(ac);
+
+  matcher->type = E_MATCHER_MULTI;
+  matcher->multiline = (header->flags & MATCHER_FILE_MULTILINE) != 0;
+  matcher->longest = header->longest;
+  matcher->mapping = mapping;
+  matcher->mapping_len = len;
+
+  return 0;
+}
+
+const char *matcher_find(const matcher_t *matcher, const char *haystack,
+                         size_t haystack_len) {
+  switch (matcher->type) {
+  case E_MATCHER_LITERAL:
+    return search_find(&matcher->literal, haystack, haystack_len);
+  case E_MATCHER_FEW:
+    return matcher_find_few(matcher, haystack, haystack_len);
+  case E_MATCHER_MULTI:
+    return ac_find(&matcher->multi, haystack, haystack_len);
+  case E_MATCHER_REGEX:
+    return dfa_find(&matcher->regex, haystack, haystack_len);
+  case E_MATCHER_APPROX:
+    return approx_find(&matcher->approx, haystack, haystack_len);
+  default:
+    assert(0);
+    return NULL;
+  }
+}
+
+void matcher_free(matcher_t *matcher) {
+  if (matcher->type == E_MATCHER_MULTI && matcher->mapping != NULL) {
+    munmap(matcher->mapping, matcher->mapping_len);
+    matcher->mapping = NULL;
+  } else if (matcher->type == E_MATCHER_MULTI) {
+    ac_free(&matcher->multi);
+  } else if (matcher->type == E_MATCHER_REGEX) {
+    dfa_free(&matcher->regex);
+  } else if (matcher->type == E_MATCHER_APPROX) {
+    approx_free(&matcher->approx);
+  }
+}
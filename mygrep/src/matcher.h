@@ -0,0 +1,136 @@
+/**
+ * @file matcher.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a common interface for the different ways to match a line.
+ */
+
+#ifndef _MATCHER_H
+#define _MATCHER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "aho_corasick.h"
+#include "approx.h"
+#include "dfa.h"
+#include "search.h"
+
+/**
+ * Up to this many keywords are searched one after another with the search
+ * kernels instead of an automaton.
+ */
+#define MATCHER_FEW_MAX (8)
+
+/**
+ * The first and the largest window the keywords of E_MATCHER_FEW are
+ * searched in.
+ */
+#define MATCHER_WINDOW_MIN (256)
+#define MATCHER_WINDOW_MAX (1024 * 1024)
+
+/**
+ * @brief How the matcher searches the input.
+ */
+typedef enum MATCHER_TYPE {
+  E_MATCHER_LITERAL, ///< a single keyword, searched by the search kernels
+  E_MATCHER_FEW,     ///< up to MATCHER_FEW_MAX keywords, each searched by the
+                     ///< search kernels
+  E_MATCHER_MULTI,   ///< many keywords, searched by an Aho-Corasick automaton
+  E_MATCHER_REGEX,   ///< regular expressions, searched by a lazy DFA
+  E_MATCHER_APPROX   ///< a single keyword within a number of edits ('-k')
+} matcher_type_e;
+
+typedef struct matcher {
+  matcher_type_e type; ///< which of the members below is used
+
+  search_t literal;     ///< used for E_MATCHER_LITERAL
+  search_t few[MATCHER_FEW_MAX]; ///< used for E_MATCHER_FEW
+  int few_num;                   ///< how many of 'few' are used
+  aho_corasick_t multi; ///< used for E_MATCHER_MULTI
+  dfa_t regex;          ///< used for E_MATCHER_REGEX
+  approx_t approx;      ///< used for E_MATCHER_APPROX
+
+  bool multiline; ///< 'true' if a keyword contains a newline, the input then
+                  ///< has to be searched line per line
+  size_t longest; ///< length of the longest keyword, a match never spans
+                  ///< more bytes (not used for E_MATCHER_REGEX)
+
+  void *mapping;      ///< the mapped compiled pattern file the automaton of
+                      ///< E_MATCHER_MULTI points into or NULL ('-F')
+  size_t mapping_len; ///< length of mapping in bytes
+} matcher_t;
+
+/**
+ * Prepares a matcher for the given keywords.
+ * @brief A single keyword uses the vectorized search, so do up to
+ * MATCHER_FEW_MAX keywords, one after another over windows of the input. More
+ * keywords are compiled into one automaton. Regular expressions are joined
+ * with '|' and compiled into a single lazy DFA. A single keyword with edits
+ * is searched approximately.
+ * @param matcher the matcher_t that should be initialized.
+ * @param keywords the keywords, must outlive the matcher. If ignore_case is set
+ * and they are no regular expressions they have to be folded with
+ * 'search_fold' already.
+ * @param keywords_num how many keywords there are
+ * @param ignore_case 'true' if the search should be case insensitive
+ * @param regex 'true' if the keywords are extended regular expressions
+ * @param edits how many edits a match of a single keyword may have, 0 for
+ * exact matches
+ * @return Returns 0 if non error has been encountered.
+ */
+int matcher_init(matcher_t *matcher, char **keywords, int keywords_num,
+                 bool ignore_case, bool regex, int edits);
+
+/**
+ * Compiles keywords into a file that 'matcher_load' can map
+ * ('--compile-patterns').
+ * @brief The file holds the Aho-Corasick automaton of the keywords as it is
+ * kept in memory. All parts of it are found by their offset from the start
+ * of the file, so it can be mapped anywhere. Even a single keyword is
+ * compiled into an automaton.
+ * @param keywords the keywords, already folded with 'search_fold' if
+ * ignore_case is set
+ * @param keywords_num how many keywords there are
+ * @param ignore_case 'true' if the search should be case insensitive, this
+ * can't be changed when the file is loaded
+ * @param path where to write the file to
+ * @return Returns 0 if non error has been encountered.
+ */
+int matcher_compile(char **keywords, int keywords_num, bool ignore_case,
+                    const char *path);
+
+/**
+ * Prepares a matcher from a file written by 'matcher_compile' ('-F').
+ * @brief The file is mapped and the automaton points into the mapping, so
+ * loading takes the same time for any number of keywords. Only the header is
+ * checked, a transition of a damaged file that leads outside of the table is
+ * sent back to the root by 'ac_find'. The file has to come from
+ * 'matcher_compile' on a machine with the same byte order.
+ * @param matcher the matcher_t that should be initialized.
+ * @param path the compiled pattern file
+ * @return Returns 0 if non error has been encountered.
+ */
+int matcher_load(matcher_t *matcher, const char *path);
+
+/**
+ * Finds the first line in the haystack that matches.
+ * @brief The haystack may consist of many lines. The returned pointer is
+ * somewhere inside the first matching line, the caller has to look for the
+ * surrounding newlines itself.
+ * @param matcher an initialized matcher_t
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes
+ * @return Returns a pointer into the first matching line or NULL.
+ */
+const char *matcher_find(const matcher_t *matcher, const char *haystack,
+                         size_t haystack_len);
+
+/**
+ * Frees the given matcher_t.
+ * @param matcher the matcher_t that should be freed.
+ */
+void matcher_free(matcher_t *matcher);
+
+#endif /* _MATCHER_H */
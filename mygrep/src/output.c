@@ -7,11 +7,33 @@
  * file)
  */
 
-#include <stdarg.h>
-#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #include "output.h"
+#include "stats.h"
+
+/**
+ * Size of the buffer small slices are copied into.
+ */
+#define OUTPUT_BUFFER_SIZE (256 * 1024)
+
+/**
+ * How many slices are collected before they are written with one writev.
+ */
+#define OUTPUT_IOV_MAX 256
+
+/**
+ * Slices shorter than this are copied even if they stay valid, a syscall per
+ * handful of bytes would be more expensive than the copy.
+ */
+#define OUTPUT_COPY_LIMIT 512
 
 /**
  * @brief Internal enum to store the output type.
@@ -23,53 +45,235 @@ typedef enum OUTPUT_TYPE { E_STDOUT, E_FILE } output_type_e;
  */
 static output_type_e output_type;
 /**
- * The file to write to.
+ * The file descriptor to write to.
+ */
+static int out_fd = -1;
+/**
+ * Small slices are copied in here until the next flush.
+ */
+static char out_buffer[OUTPUT_BUFFER_SIZE];
+/**
+ * How many bytes of 'out_buffer' are in use.
+ */
+static size_t out_buffer_len = 0;
+/**
+ * The pending slices in output order, they point into 'out_buffer' or into
+ * memory given to 'output_write_stable'.
+ */
+static struct iovec out_iov[OUTPUT_IOV_MAX];
+/**
+ * How many entries of 'out_iov' are in use.
+ */
+static int out_iov_num = 0;
+/**
+ * Time spent in writev in nanoseconds.
+ */
+static long long out_ns = 0;
+/**
+ * 'true' once an input has printed a group of lines of context.
  */
-static FILE *out_file = NULL;
+static bool out_grouped = false;
 
 void output_init_stdout(void) {
   output_type = E_STDOUT;
-  out_file = stdout;
+  out_fd = STDOUT_FILENO;
 }
 
 int output_init_file(const char *file_path) {
   output_type = E_FILE;
 
-  FILE *file = fopen(file_path, "w");
-  if (file == NULL) {
+  int fd = open(file_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (fd == -1) {
     return -1;
   }
 
-  out_file = file;
+  out_fd = fd;
 
   return 0;
 }
 
-int output_printf(const char *format, ...) {
-  va_list args;
-  va_start(args, format);
+int output_flush(void) {
+  struct iovec *iov = out_iov;
+  int iov_num = out_iov_num;
+  int result = 0;
 
-  char modified_format[strlen(format) * 2 + 1];
-  int j = 0;
-  for (int i = 0; format[i] != '\0'; i++) {
-    if (format[i] == '%') {
-      modified_format[j] = '%';
-      j += 1;
+  if (iov_num == 0) {
+    return 0;
+  }
+  long long started = stats_now();
+
+  while (iov_num > 0) {
+    ssize_t written = writev(out_fd, iov, iov_num);
+    if (written == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      result = -1;
+      break;
     }
 
-    modified_format[j] = format[i];
-    j += 1;
+    // skip everything that has been written, a short write can end anywhere
+    while (iov_num > 0 && (size_t)written >= iov->iov_len) {
+      written -= iov->iov_len;
+      iov += 1;
+      iov_num -= 1;
+    }
+    if (iov_num > 0) {
+      iov->iov_base = (char *)iov->iov_base + written;
+      iov->iov_len -= written;
+    }
   }
-  modified_format[j] = '\0';
 
-  int return_value = vfprintf(out_file, modified_format, args);
-  va_end(args);
+  out_iov_num = 0;
+  out_buffer_len = 0;
+  out_ns += stats_now() - started;
+
+  return result;
+}
+
+long long output_time(void) { return out_ns; }
+
+int output_group(void) {
+  if (out_grouped == false) {
+    out_grouped = true;
+    return 0;
+  }
+
+  return output_write("--\n", 3);
+}
 
-  return return_value;
+/**
+ * Appends a slice to the pending slices.
+ * @details Extends the last slice if the new one directly follows it, which
+ * turns runs of matching lines into a single entry.
+ * @param buffer start of the slice
+ * @param len length of the slice in bytes
+ * @return Returns 0 if non error has been encountered.
+ */
+static int output_add_slice(const char *buffer, size_t len) {
+  if (out_iov_num > 0) {
+    struct iovec *last = &out_iov[out_iov_num - 1];
+    if ((const char *)last->iov_base + last->iov_len == buffer) {
+      last->iov_len += len;
+      return 0;
+    }
+  }
+
+  if (out_iov_num >= OUTPUT_IOV_MAX && output_flush() != 0) {
+    return -1;
+  }
+
+  out_iov[out_iov_num].iov_base = (void *)buffer;
+  out_iov[out_iov_num].iov_len = len;
+  out_iov_num += 1;
+
+  return 0;
+}
+
+int output_write(const char *buffer, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+
+  // make sure the copy below never has to flush in between
+  if ((len > OUTPUT_BUFFER_SIZE - out_buffer_len ||
+       out_iov_num >= OUTPUT_IOV_MAX) &&
+      output_flush() != 0) {
+    return -1;
+  }
+
+  if (len > OUTPUT_BUFFER_SIZE) {
+    // doesn't fit at all, write it directly
+    if (output_add_slice(buffer, len) != 0) {
+      return -1;
+    }
+    return output_flush();
+  }
+
+  memcpy(out_buffer + out_buffer_len, buffer, len);
+  int result = output_add_slice(out_buffer + out_buffer_len, len);
+  out_buffer_len += len;
+
+  return result;
+}
+
+int output_write_stable(const char *buffer, size_t len) {
+  if (len == 0) {
+    return 0;
+  }
+
+  if (len < OUTPUT_COPY_LIMIT && out_iov_num > 0) {
+    struct iovec *last = &out_iov[out_iov_num - 1];
+    if ((const char *)last->iov_base + last->iov_len != buffer) {
+      return output_write(buffer, len);
+    }
+  }
+
+  return output_add_slice(buffer, len);
+}
+
+void output_buffer_init(output_buffer_t *buffer) {
+  buffer->data = NULL;
+  buffer->len = 0;
+  buffer->capacity = 0;
+  buffer->group = false;
+}
+
+int output_buffer_append(output_buffer_t *buffer, const char *data,
+                         size_t len) {
+  if (buffer->len + len > buffer->capacity) {
+    size_t capacity = buffer->capacity == 0 ? 4096 : buffer->capacity;
+    while (capacity < buffer->len + len) {
+      capacity = capacity * 3 / 2;
+    }
+
+    char *grown = realloc(buffer->data, capacity);
+    if (grown == NULL) {
+      return -1;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(buffer->data + buffer->len, data, len);
+  buffer->len += len;
+
+  return 0;
+}
+
+int output_buffer_flush(output_buffer_t *buffer) {
+  if (buffer->group) {
+    buffer->group = false;
+    if (output_group() != 0) {
+      return -1;
+    }
+  }
+
+  int result;
+  if (buffer->len < OUTPUT_COPY_LIMIT) {
+    result = output_write(buffer->data, buffer->len);
+  } else {
+    // the buffer is reused right after, so the slice has to be written now
+    result = output_write_stable(buffer->data, buffer->len);
+    if (result == 0) {
+      result = output_flush();
+    }
+  }
+  buffer->len = 0;
+
+  return result;
+}
+
+void output_buffer_free(output_buffer_t *buffer) {
+  free(buffer->data);
+  output_buffer_init(buffer);
 }
 
 void output_free(void) {
+  output_flush();
+
   if (output_type == E_FILE) {
-    fclose(out_file);
+    close(out_fd);
   }
 }
@@ -10,6 +10,20 @@
 #ifndef _OUTPUT_H
 #define _OUTPUT_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Collects output in memory until it is flushed to the output.
+ */
+typedef struct output_buffer {
+  char *data;      ///< collected bytes, not NUL terminated
+  size_t len;      ///< how many bytes have been collected
+  size_t capacity; ///< how many bytes 'data' can hold
+  bool group;      ///< 'true' if data starts with the first group of lines of
+                   ///< context of an input, see 'output_group'
+} output_buffer_t;
+
 /**
  * Initializes the output for stdout.
  * @brief This functions does not check if it or 'output_init_file' has been
@@ -30,15 +44,85 @@ void output_init_stdout(void);
 int output_init_file(const char *file_path);
 
 /**
- * Mimics what printf from stdio does.
+ * Writes the given bytes unchanged to the output.
+ * @brief The bytes are copied into an internal buffer which is written with
+ * writev once it is full, so buffer may be reused right after the call.
+ * @param buffer bytes to write, does not have to be NUL terminated
+ * @param len number of bytes to write
  * @return Returns 0 if non error has been encountered.
  */
-int output_printf(const char *format, ...);
+int output_write(const char *buffer, size_t len);
+
+/**
+ * Writes the given bytes unchanged to the output without copying them.
+ * @brief Only a reference to the bytes is stored and they are gathered with
+ * writev on the next flush. Slices that directly follow each other (e.g.
+ * consecutive lines of a memory mapped file) are merged. Very short slices
+ * are copied anyway.
+ * @param buffer bytes to write, have to stay valid until 'output_flush' has
+ * been called
+ * @param len number of bytes to write
+ * @return Returns 0 if non error has been encountered.
+ */
+int output_write_stable(const char *buffer, size_t len);
+
+/**
+ * Starts the first group of lines of context ('-A', '-B', '-C') of an input.
+ * @brief Writes the separator '--' if an earlier input has printed a group
+ * already, so the groups of different inputs are separated like grep does.
+ * @return Returns 0 if non error has been encountered.
+ */
+int output_group(void);
+
+/**
+ * Writes everything that is pending to the output.
+ * @return Returns 0 if non error has been encountered.
+ */
+int output_flush(void);
+
+/**
+ * Returns how much time has been spent writing the output so far.
+ * @brief Only changes while the output is flushed, so it must not be read by
+ * another thread than the one that flushes.
+ * @return Returns the time in nanoseconds.
+ */
+long long output_time(void);
+
+/**
+ * Initializes an empty output buffer.
+ * @param buffer the output_buffer_t that should be initialized.
+ */
+void output_buffer_init(output_buffer_t *buffer);
+
+/**
+ * Appends the given bytes to the buffer and grows it if needed.
+ * @param buffer an initialized output_buffer_t
+ * @param data bytes to append, does not have to be NUL terminated
+ * @param len number of bytes to append
+ * @return Returns 0 if non error has been encountered.
+ */
+int output_buffer_append(output_buffer_t *buffer, const char *data,
+                         size_t len);
+
+/**
+ * Writes the collected bytes to the output and empties the buffer.
+ * @brief If the bytes start with a group of lines of context, 'output_group'
+ * is called first.
+ * @param buffer an initialized output_buffer_t
+ * @return Returns 0 if non error has been encountered.
+ */
+int output_buffer_flush(output_buffer_t *buffer);
+
+/**
+ * Frees the memory of the buffer.
+ * @param buffer the output_buffer_t that should be freed.
+ */
+void output_buffer_free(output_buffer_t *buffer);
 
 /**
  * Frees the internal state.
- * @brief This function only closes the open file when the state was
- * 'output_init_file'.
+ * @brief Flushes the pending output. This function only closes the open file
+ * when the state was 'output_init_file'.
  */
 void output_free(void);
 
@@ -0,0 +1,576 @@
+/**
+ * @file parallel.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a worker pool to search multiple files or parts of a single
+ * large file in parallel.
+ *
+ * @details Both cases are split into numbered jobs. The workers take the next
+ * job index from a shared counter, so a slow job never blocks the other
+ * workers. Every job collects its output in its own buffer and the calling
+ * thread prints the buffers in job order. To keep the memory bounded the
+ * workers are never more than 'PARALLEL_WINDOW' jobs per thread ahead of the
+ * job that is printed next. For a recursive search the jobs are added by the
+ * directory walk while the pool is already running, the pool is closed once
+ * the walk is over.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "arguments.h"
+#include "logic.h"
+#include "output.h"
+#include "parallel.h"
+#include "stats.h"
+#include "walk.h"
+
+/**
+ * How many finished but not yet printed jobs each worker may have.
+ */
+#define PARALLEL_WINDOW 4
+
+/**
+ * Size of the chunks a single buffer is split into.
+ */
+#define PARALLEL_CHUNK_SIZE (4 * 1024 * 1024)
+
+/**
+ * Executes a single job.
+ * @param context the context given to 'parallel_run'
+ * @param index index of the job
+ * @param name the input of the job, NULL if the context knows it already
+ * @param out buffer to collect the output of the job in
+ * @param error set to an errno if the input of the job couldn't be opened
+ * @return Returns 0 if non error has been encountered.
+ */
+typedef int (*parallel_job_fn)(void *context, int index, const char *name,
+                               output_buffer_t *out, int *error);
+
+/**
+ * @brief The result of a single job.
+ */
+typedef struct job {
+  char *name;             ///< the input of the job, owned by the pool
+  output_buffer_t output; ///< the output of the job
+  int result;             ///< return value of the parallel_job_fn
+  int error;              ///< errno if the input couldn't be opened, else 0
+  bool done;              ///< 'true' once a worker has finished the job
+} job_t;
+
+/**
+ * @brief State shared between the workers and the printing thread.
+ */
+typedef struct pool {
+  parallel_job_fn run; ///< executes a single job
+  void *context;       ///< passed to every call of 'run'
+
+  job_t *jobs;       ///< state of every job
+  int jobs_num;      ///< how many jobs there are so far
+  int jobs_capacity; ///< the capacity of 'jobs'
+  bool closed;       ///< 'true' once no more jobs are added
+  bool keep_going;   ///< 'true' if inputs that can't be opened are skipped
+  int next;          ///< index of the next job a worker should take
+  int printed;       ///< how many jobs have been printed
+  int window;        ///< how far 'next' may be ahead of 'printed'
+  bool stop;         ///< set if the workers should stop early
+  bool finished;     ///< set if a job has finished the whole search ('-q')
+
+  pthread_mutex_t mutex;  ///< guards everything above
+  pthread_cond_t changed; ///< signaled on every change of the state
+} pool_t;
+
+/**
+ * @brief Context of the jobs of 'parallel_process_files'.
+ */
+typedef struct file_context {
+  arguments_t *args; ///< the parsed arguments, read only
+} file_context_t;
+
+/**
+ * @brief Context of the jobs of 'parallel_process_buffer'.
+ */
+typedef struct chunk_context {
+  arguments_t *args;  ///< the parsed arguments, read only
+  const char *buffer; ///< the whole buffer that is split into chunks
+  size_t len;         ///< length of buffer in bytes
+  off_t offset;       ///< offset of buffer in its file
+  size_t chunk_size;  ///< nominal size of a chunk
+  stats_t *stats;     ///< the matches and statistics of every chunk
+} chunk_context_t;
+
+/**
+ * @brief Context of the walk thread of 'parallel_process_tree'.
+ */
+typedef struct tree_context {
+  arguments_t *args; ///< the parsed arguments, read only
+  pool_t *pool;      ///< the pool the found files are added to
+  int result;        ///< return value of 'walk_paths'
+} tree_context_t;
+
+/**
+ * Initializes the pool.
+ * @param pool the pool_t that should be initialized
+ * @param jobs_num how many jobs there are, more can be added later with
+ * 'parallel_add' if closed is 'false'
+ * @param threads how many worker threads are used
+ * @param run executes a single job
+ * @param context passed to every call of run
+ * @param closed 'true' if no more jobs will be added
+ * @return Returns 0 if non error has been encountered.
+ */
+static int parallel_init(pool_t *pool, int jobs_num, int threads,
+                         parallel_job_fn run, void *context, bool closed) {
+  pool->run = run;
+  pool->context = context;
+  pool->jobs_num = jobs_num;
+  pool->jobs_capacity = jobs_num > 0 ? jobs_num : 64;
+  pool->closed = closed;
+  pool->keep_going = false;
+  pool->next = 0;
+  pool->printed = 0;
+  pool->window = threads * PARALLEL_WINDOW;
+  pool->stop = false;
+  pool->finished = false;
+
+  pool->jobs = malloc(pool->jobs_capacity * sizeof(job_t));
+  if (pool->jobs == NULL) {
+    return -1;
+  }
+  for (int i = 0; i < jobs_num; i += 1) {
+    pool->jobs[i].name = NULL;
+    output_buffer_init(&pool->jobs[i].output);
+    pool->jobs[i].result = 0;
+    pool->jobs[i].error = 0;
+    pool->jobs[i].done = false;
+  }
+
+  pthread_mutex_init(&pool->mutex, NULL);
+  pthread_cond_init(&pool->changed, NULL);
+
+  return 0;
+}
+
+/**
+ * Adds a job to a pool that isn't closed yet.
+ * @param pool the shared pool_t
+ * @param name the input of the job, the pool takes ownership
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished already.
+ */
+static int parallel_add(pool_t *pool, char *name) {
+  pthread_mutex_lock(&pool->mutex);
+  if (pool->finished) {
+    pthread_mutex_unlock(&pool->mutex);
+    free(name);
+    return PROCESS_DONE;
+  }
+
+  if (pool->jobs_num >= pool->jobs_capacity) {
+    int grown_capacity = pool->jobs_capacity * 2;
+    job_t *grown = realloc(pool->jobs, grown_capacity * sizeof(job_t));
+    if (grown == NULL) {
+      pthread_mutex_unlock(&pool->mutex);
+      free(name);
+      return -1;
+    }
+
+    pool->jobs = grown;
+    pool->jobs_capacity = grown_capacity;
+  }
+
+  job_t *job = &pool->jobs[pool->jobs_num];
+  job->name = name;
+  output_buffer_init(&job->output);
+  job->result = 0;
+  job->error = 0;
+  job->done = false;
+  pool->jobs_num += 1;
+
+  pthread_cond_broadcast(&pool->changed);
+  pthread_mutex_unlock(&pool->mutex);
+
+  return 0;
+}
+
+/**
+ * Marks that no more jobs are added to the pool.
+ */
+static void parallel_close(pool_t *pool) {
+  pthread_mutex_lock(&pool->mutex);
+  pool->closed = true;
+  pthread_cond_broadcast(&pool->changed);
+  pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * Executes jobs until there are none left.
+ * @details The jobs may be moved by 'parallel_add', so they are only accessed
+ * while the mutex is held.
+ * @param arg pointer to the shared pool_t
+ * @return Always returns NULL.
+ */
+static void *parallel_worker(void *arg) {
+  pool_t *pool = arg;
+
+  while (true) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->stop == false &&
+           (pool->next >= pool->jobs_num
+                ? pool->closed == false
+                : pool->next >= pool->printed + pool->window)) {
+      pthread_cond_wait(&pool->changed, &pool->mutex);
+    }
+
+    if (pool->stop || pool->next >= pool->jobs_num) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+
+    int index = pool->next;
+    const char *name = pool->jobs[index].name;
+    pool->next += 1;
+    pthread_mutex_unlock(&pool->mutex);
+
+    output_buffer_t output;
+    output_buffer_init(&output);
+    int error = 0;
+    int result = pool->run(pool->context, index, name, &output, &error);
+
+    pthread_mutex_lock(&pool->mutex);
+    job_t *job = &pool->jobs[index];
+    job->output = output;
+    job->result = result;
+    job->error = error;
+    job->done = true;
+    if (result == PROCESS_DONE) {
+      pool->finished = true;
+      pool->stop = true;
+    }
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  return NULL;
+}
+
+/**
+ * Prints the jobs in order as soon as they are done.
+ * @details Once a job has finished the whole search nothing is printed
+ * anymore, the remaining jobs may never be started.
+ * @param pool the shared pool_t
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+static int parallel_print(pool_t *pool) {
+  int status = 0;
+
+  for (int i = 0;; i += 1) {
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->finished == false &&
+           (i >= pool->jobs_num ? pool->closed == false
+                                : pool->jobs[i].done == false)) {
+      pthread_cond_wait(&pool->changed, &pool->mutex);
+    }
+
+    if (pool->finished) {
+      pthread_mutex_unlock(&pool->mutex);
+      return PROCESS_DONE;
+    }
+    if (i >= pool->jobs_num) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+
+    job_t job = pool->jobs[i];
+    pool->jobs[i].name = NULL;
+    output_buffer_init(&pool->jobs[i].output);
+    pthread_mutex_unlock(&pool->mutex);
+
+    if (job.error != 0) {
+      // same message 'perror' prints in the serial path
+      fprintf(stderr, "Failed to open the file: %s\n", strerror(job.error));
+      status = 1;
+    }
+
+    int result = job.result;
+    if (result == 0) {
+      result = output_buffer_flush(&job.output);
+    }
+    output_buffer_free(&job.output);
+    free(job.name);
+
+    if (job.error != 0 && pool->keep_going == false) {
+      return 1;
+    }
+    if (job.error == 0 && result != 0) {
+      return -1;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->printed = i + 1;
+    pthread_cond_broadcast(&pool->changed);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  return status;
+}
+
+/**
+ * Executes the jobs of the pool on threads worker threads and prints their
+ * output in order. Frees the pool afterwards.
+ * @param pool an initialized pool_t
+ * @param threads how many worker threads should be started
+ * @param producer started in its own thread before the workers if it isn't
+ * NULL, it has to close the pool once it has added all jobs
+ * @param producer_arg passed to producer
+ * @return Returns 0 if non error has been encountered.
+ */
+static int parallel_run(pool_t *pool, int threads, void *(*producer)(void *),
+                        void *producer_arg) {
+  pthread_t *workers = malloc(threads * sizeof(pthread_t));
+  pthread_t producer_thread;
+  bool producer_started = false;
+  int started = 0;
+
+  if (workers != NULL && producer != NULL) {
+    producer_started =
+        pthread_create(&producer_thread, NULL, producer, producer_arg) == 0;
+  }
+
+  if (workers != NULL && (producer == NULL || producer_started)) {
+    while (started < threads) {
+      if (pthread_create(&workers[started], NULL, parallel_worker, pool) !=
+          0) {
+        break;
+      }
+      started += 1;
+    }
+  }
+
+  int result = -1;
+  if (started > 0) {
+    result = parallel_print(pool);
+  }
+
+  pthread_mutex_lock(&pool->mutex);
+  pool->stop = true;
+  // a producer that is still running gives up at its next 'parallel_add'
+  pool->finished = true;
+  pthread_cond_broadcast(&pool->changed);
+  pthread_mutex_unlock(&pool->mutex);
+
+  if (producer_started) {
+    pthread_join(producer_thread, NULL);
+  }
+  for (int i = 0; i < started; i += 1) {
+    pthread_join(workers[i], NULL);
+  }
+
+  for (int i = 0; i < pool->jobs_num; i += 1) {
+    output_buffer_free(&pool->jobs[i].output);
+    free(pool->jobs[i].name);
+  }
+
+  pthread_cond_destroy(&pool->changed);
+  pthread_mutex_destroy(&pool->mutex);
+  free(workers);
+  free(pool->jobs);
+
+  return result;
+}
+
+/**
+ * Searches the input file with the given index or name, see
+ * 'parallel_job_fn'.
+ */
+static int parallel_file_job(void *context, int index, const char *name,
+                             output_buffer_t *out, int *error) {
+  file_context_t *files = context;
+  if (name == NULL) {
+    name = files->args->input_files[index];
+  }
+
+  FILE *file = fopen(name, "r");
+  if (file == NULL) {
+    *error = errno;
+    return -1;
+  }
+
+  int result = process_file_buffered(file, name, files->args, out);
+  fclose(file);
+
+  return result;
+}
+
+/**
+ * Finds the start of the chunk with the given index.
+ * @details A chunk starts at the first line that begins at or after its
+ * nominal start, so every line belongs to exactly one chunk. Chunks of very
+ * long lines can therefore be empty.
+ * @param chunks the chunk_context_t
+ * @param index index of the chunk, may be the number of chunks
+ * @return Returns the offset of the first byte of the chunk.
+ */
+static size_t parallel_chunk_start(const chunk_context_t *chunks, int index) {
+  size_t nominal = (size_t)index * chunks->chunk_size;
+  if (index == 0) {
+    return 0;
+  }
+  if (nominal >= chunks->len) {
+    return chunks->len;
+  }
+
+  const char *newline = memchr(chunks->buffer + nominal - 1, '\n',
+                               chunks->len - (nominal - 1));
+  if (newline == NULL) {
+    return chunks->len;
+  }
+
+  return newline - chunks->buffer + 1;
+}
+
+/**
+ * Searches the chunk with the given index, see 'parallel_job_fn'.
+ */
+static int parallel_chunk_job(void *context, int index, const char *name,
+                              output_buffer_t *out, int *error) {
+  chunk_context_t *chunks = context;
+  (void)name;
+  (void)error;
+
+  size_t start = parallel_chunk_start(chunks, index);
+  size_t end = parallel_chunk_start(chunks, index + 1);
+  if (start >= end) {
+    return 0;
+  }
+
+  file_state_t state;
+  file_state_init(&state, NULL, out);
+  file_state_seek(&state, chunks->buffer + start, chunks->offset + start, 1);
+
+  int result = process_buffer(chunks->buffer + start, end - start,
+                              chunks->args, &state);
+
+  // every chunk has its own entry, nothing has to be locked
+  chunks->stats[index] = state.stats;
+  chunks->stats[index].matches = state.matches;
+
+  return result;
+}
+
+/**
+ * Adds a file found by the walk to the pool, see 'walk_file_fn'.
+ */
+static int parallel_tree_file(void *context, char *path) {
+  tree_context_t *tree = context;
+  return parallel_add(tree->pool, path);
+}
+
+/**
+ * Walks the input directories and closes the pool afterwards.
+ * @param arg pointer to the tree_context_t
+ * @return Always returns NULL.
+ */
+static void *parallel_tree_walk(void *arg) {
+  tree_context_t *tree = arg;
+
+  tree->result =
+      walk_paths(tree->args->input_files, tree->args->input_files_num,
+                 tree->args->threads, parallel_tree_file, NULL, tree);
+  parallel_close(tree->pool);
+
+  return NULL;
+}
+
+int parallel_process_files(arguments_t *args) {
+  file_context_t files;
+  files.args = args;
+
+  pool_t pool;
+  if (parallel_init(&pool, args->input_files_num, args->threads,
+                    parallel_file_job, &files, true) != 0) {
+    return -1;
+  }
+
+  return parallel_run(&pool, args->threads, NULL, NULL);
+}
+
+int parallel_process_tree(arguments_t *args) {
+  file_context_t files;
+  files.args = args;
+
+  pool_t pool;
+  if (parallel_init(&pool, 0, args->threads, parallel_file_job, &files,
+                    false) != 0) {
+    return -1;
+  }
+  pool.keep_going = true;
+
+  tree_context_t tree;
+  tree.args = args;
+  tree.pool = &pool;
+  tree.result = 0;
+
+  int result = parallel_run(&pool, args->threads, parallel_tree_walk, &tree);
+  if (result == 0 && tree.result != 0 && tree.result != PROCESS_DONE) {
+    // the walk has already reported what went wrong
+    result = 1;
+  }
+
+  return result;
+}
+
+bool parallel_should_split(const arguments_t *args, size_t len) {
+  // the chunks don't know about the matches and lines of each other
+  if (args->output_mode != E_OUTPUT_LINES || args->max_count >= 0 ||
+      args->line_numbers || args->context) {
+    return false;
+  }
+
+  return args->threads > 1 && len >= 2 * (size_t)PARALLEL_CHUNK_SIZE;
+}
+
+int parallel_process_buffer(const char *buffer, size_t len, off_t offset,
+                            arguments_t *args, file_state_t *state) {
+  chunk_context_t chunks;
+  chunks.args = args;
+  chunks.buffer = buffer;
+  chunks.len = len;
+  chunks.offset = offset;
+  chunks.chunk_size = PARALLEL_CHUNK_SIZE;
+
+  int chunks_num = (int)((len + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+
+  chunks.stats = calloc(chunks_num, sizeof(stats_t));
+  if (chunks.stats == NULL) {
+    return -1;
+  }
+
+  pool_t pool;
+  if (parallel_init(&pool, chunks_num, args->threads, parallel_chunk_job,
+                    &chunks, true) != 0) {
+    free(chunks.stats);
+    return -1;
+  }
+
+  int result = parallel_run(&pool, args->threads, NULL, NULL);
+
+  for (int i = 0; i < chunks_num; i += 1) {
+    state->matches += chunks.stats[i].matches;
+    state->stats.bytes += chunks.stats[i].bytes;
+    state->stats.lines += chunks.stats[i].lines;
+    if (chunks.stats[i].lines_unknown) {
+      state->stats.lines_unknown = true;
+    }
+  }
+  free(chunks.stats);
+
+  return result;
+}
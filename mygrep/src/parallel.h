@@ -0,0 +1,73 @@
+/**
+ * @file parallel.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a worker pool to search multiple files or parts of a single
+ * large file in parallel.
+ */
+
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#include "arguments.h"
+#include "logic.h"
+
+/**
+ * Searches all input files with 'args->threads' worker threads.
+ * @brief Every worker collects the matching lines of one file in its own
+ * buffer, the calling thread prints the buffers in the order of the
+ * arguments. The output is the same as when the files are searched one after
+ * another.
+ * @param args pointer to an arguments_t
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int parallel_process_files(arguments_t *args);
+
+/**
+ * Searches every file below the input paths with 'args->threads' worker
+ * threads.
+ * @brief The directories are walked by 'walk_paths' in its own thread, every
+ * file it finds is handed to the workers right away. The output of a file is
+ * never mixed with the output of another file, but the files are printed in
+ * the order the walk has found them. Files that can't be opened are reported
+ * and skipped.
+ * @param args pointer to an arguments_t
+ * @return Returns 0 if non error has been encountered and PROCESS_DONE if the
+ * search has been finished early.
+ */
+int parallel_process_tree(arguments_t *args);
+
+/**
+ * Checks if a buffer is large enough to be split by
+ * 'parallel_process_buffer'.
+ * @param args pointer to an arguments_t
+ * @param len length of the buffer in bytes
+ * @return Returns true if more than one thread is allowed, the buffer spans at
+ * least two chunks and every matching line is printed (no '-l', '-c', '-q' or
+ * '-m') without its line number.
+ */
+bool parallel_should_split(const arguments_t *args, size_t len);
+
+/**
+ * Searches a single buffer with 'args->threads' worker threads.
+ * @brief Splits the buffer into newline aligned chunks and searches them with
+ * 'process_buffer'. The output of the chunks is printed in the order of the
+ * buffer, so it is the same as when the buffer is searched as a whole.
+ * @param buffer the bytes to search, does not have to be NUL terminated
+ * @param len length of buffer in bytes
+ * @param offset offset of buffer in its file, for '-b'
+ * @param args pointer to an arguments_t
+ * @param state the state of the input the buffer belongs to, the matches and
+ * statistics of all chunks are added to it
+ * @return Returns 0 if non error has been encountered.
+ */
+int parallel_process_buffer(const char *buffer, size_t len, off_t offset,
+                            arguments_t *args, file_state_t *state);
+
+#endif /* _PARALLEL_H */
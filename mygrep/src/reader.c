@@ -0,0 +1,413 @@
+/**
+ * @file reader.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a reader thread that fills buffers with an input while the
+ * previous ones are searched.
+ *
+ * @details The thread fills the READER_BUFFERS buffers in turns and hands
+ * each one over once it is full or the input has nothing more for now. The
+ * consumer searches the oldest filled buffer in place or copies out of it and
+ * hands it back once it has been consumed, so the thread is never more than
+ * READER_BUFFERS buffers ahead. A buffer is only ever used by one of the
+ * threads at a time, the lock is only taken to hand it over.
+ *
+ * The thread can only be canceled while it waits in 'read', a producer that
+ * never writes again can't keep a finished search from returning.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "reader.h"
+
+bool reader_is_gzip(int fd, off_t offset) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == -1 || S_ISREG(file_stat.st_mode) == false) {
+    return false;
+  }
+
+  unsigned char magic[2];
+  return pread(fd, magic, sizeof(magic), offset) == sizeof(magic) &&
+         magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+/**
+ * Returns where the bytes of a buffer start, behind its headroom.
+ */
+static char *reader_data(const reader_t *reader, int index) {
+  return reader->buffers[index] + READER_HEADROOM;
+}
+
+/**
+ * Reads the next bytes of the file.
+ * @return Returns how many bytes have been read, 0 at the end of the file and
+ * -1 on error.
+ */
+static ssize_t reader_read_input(reader_t *reader, void *buffer,
+                                 size_t len) {
+  while (true) {
+    pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+    ssize_t read_len = read(reader->fd, buffer, len);
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+    if (read_len != -1 || errno != EINTR) {
+      return read_len;
+    }
+  }
+}
+
+/**
+ * Decompresses the next bytes of the input into a buffer.
+ * @details A member that ends is followed by the next one, if there are more
+ * bytes. A file that ends in the middle of a member has been cut.
+ * @return Returns how many bytes have been written, 0 at the end of the input
+ * and -1 on error.
+ */
+static ssize_t reader_inflate(reader_t *reader, char *buffer, size_t len) {
+  z_stream *stream = &reader->stream;
+  stream->next_out = (unsigned char *)buffer;
+  stream->avail_out = (uInt)len;
+
+  while (stream->avail_out > 0) {
+    if (stream->avail_in == 0) {
+      ssize_t read = reader_read_input(reader, reader->input,
+                                       READER_INPUT_SIZE);
+      if (read == -1 || (read == 0 && reader->member)) {
+        return -1;
+      }
+      if (read == 0) {
+        break;
+      }
+
+      stream->next_in = reader->input;
+      stream->avail_in = (uInt)read;
+    }
+
+    if (reader->member == false) {
+      if (inflateReset(stream) != Z_OK) {
+        return -1;
+      }
+      reader->member = true;
+    }
+
+    int status = inflate(stream, Z_NO_FLUSH);
+    if (status == Z_STREAM_END) {
+      reader->member = false;
+    } else if (status != Z_OK) {
+      return -1;
+    }
+  }
+
+  return len - stream->avail_out;
+}
+
+/**
+ * Fills the next buffer.
+ * @details An input that isn't decompressed is read for as long as the next
+ * bytes are already there, a slow producer shouldn't have to fill the whole
+ * buffer before its lines are searched. A fast one fills it with few hand
+ * overs.
+ * @return Returns how many bytes have been written, 0 at the end of the input
+ * and -1 on error.
+ */
+static ssize_t reader_fill(reader_t *reader, char *buffer, size_t len) {
+  if (reader->gzip) {
+    return reader_inflate(reader, buffer, len);
+  }
+
+  ssize_t filled = reader_read_input(reader, buffer, len);
+  if (filled <= 0) {
+    return filled;
+  }
+
+  struct pollfd poll_fd = {.fd = reader->fd, .events = POLLIN};
+  while ((size_t)filled < len && poll(&poll_fd, 1, 0) == 1 &&
+         (poll_fd.revents & POLLIN) != 0) {
+    ssize_t read_len =
+        reader_read_input(reader, buffer + filled, len - filled);
+    if (read_len <= 0) {
+      // the end or the error is reported by the next fill
+      break;
+    }
+    filled += read_len;
+  }
+
+  return filled;
+}
+
+/**
+ * The reader thread, fills the buffers in turns until the input ends or the
+ * consumer stops it.
+ */
+static void *reader_run(void *context) {
+  reader_t *reader = context;
+  int index = 0;
+
+  pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+  while (true) {
+    pthread_mutex_lock(&reader->mutex);
+    while (reader->ready == READER_BUFFERS && reader->stopped == false) {
+      pthread_cond_wait(&reader->cond, &reader->mutex);
+    }
+    bool stopped = reader->stopped;
+    pthread_mutex_unlock(&reader->mutex);
+
+    if (stopped) {
+      break;
+    }
+
+    // the buffer isn't ready, so the consumer doesn't look at it
+    ssize_t len = reader_fill(reader, reader_data(reader, index),
+                              READER_BUFFER_SIZE);
+
+    pthread_mutex_lock(&reader->mutex);
+    if (len > 0) {
+      reader->lens[index] = len;
+      reader->ready += 1;
+    } else if (len == 0) {
+      reader->finished = true;
+    } else {
+      reader->failed = true;
+    }
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->mutex);
+
+    if (len <= 0) {
+      break;
+    }
+    index = (index + 1) % READER_BUFFERS;
+  }
+
+  return NULL;
+}
+
+/**
+ * Frees the buffers of a reader.
+ */
+static void reader_free(reader_t *reader) {
+  for (int i = 0; i < READER_BUFFERS; i += 1) {
+    free(reader->buffers[i]);
+  }
+  free(reader->input);
+  if (reader->gzip) {
+    inflateEnd(&reader->stream);
+  }
+}
+
+/**
+ * Allocates the buffers of a reader and starts its thread.
+ * @param gzip 'true' if the input has to be decompressed
+ * @return Returns 0 if non error has been encountered.
+ */
+static int reader_start(reader_t *reader, int fd, bool gzip) {
+  memset(reader, 0, sizeof(reader_t));
+  reader->fd = fd;
+
+  for (int i = 0; i < READER_BUFFERS; i += 1) {
+    void *buffer;
+    if (posix_memalign(&buffer, READER_ALIGNMENT,
+                       READER_HEADROOM + READER_BUFFER_SIZE) != 0) {
+      reader_free(reader);
+      return -1;
+    }
+    reader->buffers[i] = buffer;
+  }
+
+  if (gzip) {
+    if ((reader->input = malloc(READER_INPUT_SIZE)) == NULL) {
+      reader_free(reader);
+      return -1;
+    }
+
+    // 16 + MAX_WBITS only accepts the gzip format
+    if (inflateInit2(&reader->stream, 16 + MAX_WBITS) != Z_OK) {
+      reader_free(reader);
+      return -1;
+    }
+    reader->gzip = true;
+    reader->member = true;
+  }
+
+  pthread_mutex_init(&reader->mutex, NULL);
+  pthread_cond_init(&reader->cond, NULL);
+
+  if (pthread_create(&reader->thread, NULL, reader_run, reader) != 0) {
+    pthread_mutex_destroy(&reader->mutex);
+    pthread_cond_destroy(&reader->cond);
+    reader_free(reader);
+    return -1;
+  }
+
+  return 0;
+}
+
+int reader_start_gzip(reader_t *reader, int fd) {
+  return reader_start(reader, fd, true);
+}
+
+int reader_start_fd(reader_t *reader, int fd) {
+  return reader_start(reader, fd, false);
+}
+
+/**
+ * Waits until a buffer behind the ones the consumer still holds is filled.
+ * @param held how many filled buffers the consumer still holds
+ * @return Returns 'true' if there is a buffer to consume, 'false' at the end
+ * of the input or on error.
+ */
+static bool reader_wait(reader_t *reader, int held) {
+  pthread_mutex_lock(&reader->mutex);
+  while (reader->ready == held && reader->finished == false &&
+         reader->failed == false) {
+    pthread_cond_wait(&reader->cond, &reader->mutex);
+  }
+  bool ready = reader->ready > held;
+  pthread_mutex_unlock(&reader->mutex);
+
+  return ready;
+}
+
+/**
+ * Hands the next buffer back to the reader thread.
+ */
+static void reader_release(reader_t *reader) {
+  pthread_mutex_lock(&reader->mutex);
+  reader->ready -= 1;
+  reader->next = (reader->next + 1) % READER_BUFFERS;
+  reader->pos = 0;
+  pthread_cond_broadcast(&reader->cond);
+  pthread_mutex_unlock(&reader->mutex);
+}
+
+/**
+ * Marks bytes of the next buffer as consumed, hands it back to the reader
+ * thread once all of them are.
+ */
+static void reader_consume(reader_t *reader, size_t len) {
+  reader->pos += len;
+  if (reader->pos >= reader->lens[reader->next]) {
+    reader_release(reader);
+  }
+}
+
+ssize_t reader_read(reader_t *reader, char *dest, size_t len) {
+  if (reader_wait(reader, 0) == false) {
+    return reader_failed(reader) ? -1 : 0;
+  }
+
+  size_t left = reader->lens[reader->next] - reader->pos;
+  if (len > left) {
+    len = left;
+  }
+
+  memcpy(dest, reader_data(reader, reader->next) + reader->pos, len);
+  reader_consume(reader, len);
+
+  return len;
+}
+
+ssize_t reader_take(reader_t *reader, const char *keep, size_t keep_len,
+                    char **data) {
+  int held = reader->taken ? 1 : 0;
+  if (reader_wait(reader, held) == false) {
+    return reader_failed(reader) ? -1 : 0;
+  }
+
+  // the buffer taken before is only handed back once keep has been copied
+  int index = (reader->next + held) % READER_BUFFERS;
+  *data = reader_data(reader, index) - keep_len;
+  if (keep_len > 0) {
+    memcpy(*data, keep, keep_len);
+  }
+
+  if (reader->taken) {
+    reader_release(reader);
+  }
+  reader->taken = true;
+
+  return keep_len + reader->lens[index];
+}
+
+ssize_t reader_getline(reader_t *reader, const char **line, char **spare,
+                       size_t *capacity) {
+  // the last line isn't used anymore
+  if (reader->borrowed > 0) {
+    size_t borrowed = reader->borrowed;
+    reader->borrowed = 0;
+    reader_consume(reader, borrowed);
+  }
+
+  size_t len = 0;
+
+  while (reader_wait(reader, 0)) {
+    const char *start = reader_data(reader, reader->next) + reader->pos;
+    size_t left = reader->lens[reader->next] - reader->pos;
+    const char *end = memchr(start, '\n', left);
+    size_t piece = end == NULL ? left : (size_t)(end - start) + 1;
+
+    if (len == 0 && end != NULL) {
+      // the whole line is inside the buffer
+      *line = start;
+      reader->borrowed = piece;
+      return piece;
+    }
+
+    if (*spare == NULL || len + piece > *capacity) {
+      size_t grown_capacity = *capacity < 128 ? 128 : *capacity;
+      while (len + piece > grown_capacity) {
+        grown_capacity *= 2;
+      }
+
+      char *grown = realloc(*spare, grown_capacity);
+      if (grown == NULL) {
+        return -1;
+      }
+      *spare = grown;
+      *capacity = grown_capacity;
+    }
+
+    memcpy(*spare + len, start, piece);
+    len += piece;
+    reader_consume(reader, piece);
+
+    if (end != NULL) {
+      break;
+    }
+  }
+
+  if (len == 0) {
+    return -1;
+  }
+
+  *line = *spare;
+  return len;
+}
+
+bool reader_failed(reader_t *reader) {
+  pthread_mutex_lock(&reader->mutex);
+  bool failed = reader->failed;
+  pthread_mutex_unlock(&reader->mutex);
+
+  return failed;
+}
+
+void reader_finish(reader_t *reader) {
+  pthread_mutex_lock(&reader->mutex);
+  reader->stopped = true;
+  pthread_cond_broadcast(&reader->cond);
+  pthread_mutex_unlock(&reader->mutex);
+
+  // only takes effect while the thread waits in 'read'
+  pthread_cancel(reader->thread);
+  pthread_join(reader->thread, NULL);
+  pthread_mutex_destroy(&reader->mutex);
+  pthread_cond_destroy(&reader->cond);
+  reader_free(reader);
+}
@@ -0,0 +1,164 @@
+/**
+ * @file reader.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a reader thread that fills buffers with an input while the
+ * previous ones are searched.
+ */
+
+#ifndef _READER_H
+#define _READER_H
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+#include <zlib.h>
+
+/**
+ * How many buffers the reader thread fills in turns.
+ */
+#define READER_BUFFERS (2)
+
+/**
+ * Size of each of the buffers.
+ */
+#define READER_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * Room in front of every buffer for the bytes a consumer carries over from
+ * the previous buffer, see 'reader_take'. A multiple of READER_ALIGNMENT.
+ */
+#define READER_HEADROOM (256 * 1024)
+
+/**
+ * Alignment of the buffers, a whole page.
+ */
+#define READER_ALIGNMENT (4096)
+
+/**
+ * Size of the compressed bytes read at once from a gzip file.
+ */
+#define READER_INPUT_SIZE (128 * 1024)
+
+/**
+ * @brief An input read by its own thread.
+ */
+typedef struct reader {
+  pthread_t thread;      ///< the reader thread
+  pthread_mutex_t mutex; ///< guards everything below that both threads use
+  pthread_cond_t cond;   ///< signaled when a buffer is filled or consumed
+
+  char *buffers[READER_BUFFERS]; ///< the buffers, filled in turns behind
+                                 ///< READER_HEADROOM bytes
+  size_t lens[READER_BUFFERS];   ///< how many bytes of each buffer are used
+  int ready;       ///< how many buffers are filled and not consumed yet
+  int next;        ///< index of the buffer that is consumed next
+  size_t pos;      ///< how many bytes of the next buffer have been consumed
+  size_t borrowed; ///< bytes of the next buffer the last line of
+                   ///< 'reader_getline' still points to
+  bool taken;      ///< 'true' while the next buffer is searched in place, see
+                   ///< 'reader_take'
+  bool finished; ///< 'true' once the thread has reached the end of the input
+  bool failed;   ///< 'true' if the thread couldn't read the input
+  bool stopped;  ///< 'true' once the consumer doesn't need more bytes
+
+  int fd;               ///< the input, not owned by the reader
+  bool gzip;            ///< 'true' if the input is decompressed
+  z_stream stream;      ///< state of the decompression
+  unsigned char *input; ///< compressed bytes that have been read
+  bool member;          ///< 'true' while a gzip member isn't finished
+} reader_t;
+
+/**
+ * Checks if a file starts with the magic bytes of gzip at its current
+ * offset.
+ * @brief Only looks at regular files, a pipe can't be looked at in advance.
+ * @param fd the file to check
+ * @param offset current offset of the file
+ * @return Returns 'true' if the file is compressed with gzip.
+ */
+bool reader_is_gzip(int fd, off_t offset);
+
+/**
+ * Starts a thread that decompresses a gzip file from its current offset on.
+ * @brief Files with multiple members (e.g. concatenated with 'cat') are
+ * decompressed as a whole. Every buffer is inflated into directly, so the
+ * consumer searches the decompressed bytes without another copy, see
+ * 'reader_take'.
+ * @param reader the reader_t that should be started
+ * @param fd the file to decompress, must stay open until 'reader_finish'
+ * @return Returns 0 if non error has been encountered.
+ */
+int reader_start_gzip(reader_t *reader, int fd);
+
+/**
+ * Starts a thread that reads a file from its current offset on.
+ * @brief Meant for pipes and other streams, the producer can go on writing
+ * while the previous buffer is searched. A buffer is handed over as soon as
+ * the stream has nothing more for now, so the lines of a slow producer aren't
+ * held back until a buffer is full.
+ * @param reader the reader_t that should be started
+ * @param fd the file to read, must stay open until 'reader_finish'
+ * @return Returns 0 if non error has been encountered.
+ */
+int reader_start_fd(reader_t *reader, int fd);
+
+/**
+ * Copies the next bytes of the input.
+ * @brief Waits for the reader thread if no buffer is filled yet.
+ * @param reader a started reader_t
+ * @param dest where to copy the bytes to
+ * @param len how many bytes fit into dest
+ * @return Returns how many bytes have been copied, 0 at the end of the input
+ * and -1 if it couldn't be read.
+ */
+ssize_t reader_read(reader_t *reader, char *dest, size_t len);
+
+/**
+ * Takes the next filled buffer to search it in place.
+ * @brief The bytes the consumer still needs are copied into the headroom in
+ * front of the buffer, so they are followed by the new bytes without another
+ * copy. The buffer taken before is handed back to the reader thread
+ * afterwards, keep may point into it. Can't be mixed with 'reader_read'.
+ * @param reader a started reader_t
+ * @param keep bytes to put in front of the new bytes
+ * @param keep_len length of keep, at most READER_HEADROOM
+ * @param data set to the start of the kept bytes
+ * @return Returns how many bytes start at data, 0 at the end of the input
+ * and -1 if it couldn't be read. The buffer taken before stays valid then.
+ */
+ssize_t reader_take(reader_t *reader, const char *keep, size_t keep_len,
+                    char **data);
+
+/**
+ * Reads the next line of the input, like 'getline'.
+ * @brief A line inside a single buffer isn't copied, it is returned where it
+ * is and stays valid until the next call. Only a line that is cut by the end
+ * of a buffer is copied into spare.
+ * @param reader a started reader_t
+ * @param line set to the line, which isn't NUL terminated
+ * @param spare buffer for cut lines, grown with 'realloc' if needed
+ * @param capacity capacity of spare, updated with it
+ * @return Returns the length of the line including its newline and -1 at the
+ * end of the input or on error, see 'reader_failed'.
+ */
+ssize_t reader_getline(reader_t *reader, const char **line, char **spare,
+                       size_t *capacity);
+
+/**
+ * Checks if the input couldn't be read.
+ * @param reader a started reader_t
+ * @return Returns 'true' if the reader thread has failed.
+ */
+bool reader_failed(reader_t *reader);
+
+/**
+ * Stops the reader thread, even if it hasn't reached the end of the input,
+ * and frees the reader.
+ * @param reader a started reader_t
+ */
+void reader_finish(reader_t *reader);
+
+#endif /* _READER_H */
@@ -0,0 +1,1064 @@
+/**
+ * @file search.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a vectorized substring search for the keyword.
+ *
+ * @details The vector kernels compare a whole block of haystack positions
+ * against the first and the last byte of the needle at once. Only positions
+ * where both bytes match are verified, which filters out nearly every
+ * candidate on real text. The kernel is picked once at runtime, so the binary
+ * still runs on cpus without AVX2.
+ *
+ * Needles at both ends of the length range have their own kernels. A single
+ * byte is left to memchr, short needles jump with memchr to their rarest byte
+ * and compare all of their bytes with a single word compare, and long needles
+ * skip most of the haystack with Horspool's bad character shift.
+ *
+ * Case insensitive searches expect the needle to be folded with 'search_fold'
+ * and never copy the haystack. For an ASCII needle the kernels set bit 0x20 of
+ * the haystack bytes before comparing against a letter, which maps 'A'-'Z' onto
+ * 'a'-'z' and can't produce a false match. Needles with multibyte UTF-8
+ * characters take a slower path that decodes and folds every character.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "search.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * The first and the largest window 'search_find_byte_icase' searches in.
+ */
+#define SEARCH_WINDOW_MIN (64)
+#define SEARCH_WINDOW_MAX (64 * 1024)
+
+/**
+ * Folds a single ASCII byte to lowercase, independent of the locale.
+ * @param c byte to fold
+ * @return Returns the folded byte.
+ */
+static inline unsigned char search_fold_ascii(unsigned char c) {
+  if (c >= 'A' && c <= 'Z') {
+    return c + ('a' - 'A');
+  }
+
+  return c;
+}
+
+/**
+ * Returns the bit that has to be set on a haystack byte before it is compared
+ * against the (folded) needle byte c.
+ * @param c folded needle byte
+ * @return Returns 0x20 for lowercase letters and 0 for everything else.
+ */
+static inline unsigned char search_case_bit(unsigned char c) {
+  if (c >= 'a' && c <= 'z') {
+    return 0x20;
+  }
+
+  return 0;
+}
+
+/**
+ * Compares two byte ranges, folding the bytes of a to lowercase.
+ * @param a haystack bytes
+ * @param b folded needle bytes
+ * @param len number of bytes to compare
+ * @return Returns true if both ranges are equal after folding.
+ */
+static inline bool search_equal_icase(const char *a, const char *b,
+                                      size_t len) {
+  for (size_t i = 0; i < len; i += 1) {
+    if (search_fold_ascii((unsigned char)a[i]) != (unsigned char)b[i]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * Folds the unicode code points of the two byte UTF-8 range that have a
+ * simple lowercase mapping of the same encoded length (Latin-1, Latin
+ * Extended-A, Greek and Cyrillic).
+ * @param cp code point to fold
+ * @return Returns the folded code point.
+ */
+static unsigned int search_fold_codepoint(unsigned int cp) {
+  if (cp >= 0xC0 && cp <= 0xDE && cp != 0xD7) {
+    return cp + 0x20;
+  }
+
+  if (cp >= 0x100 && cp <= 0x17F) {
+    if (cp == 0x178) {
+      return 0xFF;
+    }
+    if ((cp >= 0x139 && cp <= 0x148) || (cp >= 0x179 && cp <= 0x17E)) {
+      return (cp % 2 == 1) ? cp + 1 : cp;
+    }
+    // the dotted capital and the dotless small i aren't a case pair of each
+    // other, their partners are the ASCII i and I
+    if (cp == 0x130 || cp == 0x131 || cp == 0x138 || cp == 0x149 ||
+        cp == 0x17F) {
+      return cp;
+    }
+    return (cp % 2 == 0) ? cp + 1 : cp;
+  }
+
+  if (cp >= 0x391 && cp <= 0x3A9 && cp != 0x3A2) {
+    return cp + 0x20;
+  }
+
+  if (cp >= 0x400 && cp <= 0x40F) {
+    return cp + 0x50;
+  }
+
+  if (cp >= 0x410 && cp <= 0x42F) {
+    return cp + 0x20;
+  }
+
+  return cp;
+}
+
+/**
+ * @details Two byte UTF-8 sequences are decoded and folded with
+ * 'search_fold_codepoint', everything else is treated byte per byte.
+ */
+size_t search_fold_char(const unsigned char *str, size_t len,
+                        unsigned char *folded) {
+  if (len >= 2 && (str[0] & 0xE0) == 0xC0 && (str[1] & 0xC0) == 0x80) {
+    unsigned int cp = ((str[0] & 0x1Fu) << 6) | (str[1] & 0x3Fu);
+    cp = search_fold_codepoint(cp);
+
+    folded[0] = (unsigned char)(0xC0 | (cp >> 6));
+    folded[1] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 2;
+  }
+
+  folded[0] = search_fold_ascii(str[0]);
+  return 1;
+}
+
+/**
+ * Slow path for case insensitive searches with a non ASCII needle.
+ * @details Decodes and folds the haystack character per character at every
+ * candidate position. Because folding keeps the encoded length a match is
+ * always exactly needle_len bytes long.
+ */
+static const char *search_find_utf8_icase(const search_t *search,
+                                          const char *haystack,
+                                          size_t haystack_len) {
+  const unsigned char *hay = (const unsigned char *)haystack;
+  const unsigned char *ndl = (const unsigned char *)search->needle;
+  const size_t needle_len = search->needle_len;
+
+  for (size_t start = 0; start + needle_len <= haystack_len; start += 1) {
+    // a match can't start in the middle of a character
+    if ((hay[start] & 0xC0) == 0x80) {
+      continue;
+    }
+
+    size_t i = 0;
+    while (i < needle_len) {
+      unsigned char folded[2];
+      size_t step = search_fold_char(hay + start + i, needle_len - i, folded);
+
+      if (folded[0] != ndl[i] || (step == 2 && folded[1] != ndl[i + 1])) {
+        break;
+      }
+
+      i += step;
+    }
+
+    if (i >= needle_len) {
+      return haystack + start;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Loads 8 unaligned bytes as a word, in the same byte order 'search_init'
+ * packs the needle in.
+ * @param bytes at least 8 readable bytes
+ * @return Returns the loaded word.
+ */
+static inline uint64_t search_load_word(const char *bytes) {
+  uint64_t word;
+  memcpy(&word, bytes, sizeof(word));
+
+  return word;
+}
+
+/**
+ * Compares a needle of up to 8 bytes with a single word compare.
+ * @param search an initialized search_t with a packed needle
+ * @param candidate haystack position with at least 8 readable bytes
+ * @return Returns true if the needle starts at candidate.
+ */
+static inline bool search_equal_packed(const search_t *search,
+                                       const char *candidate) {
+  uint64_t word = search_load_word(candidate) | search->packed_case;
+
+  return (word & search->packed_mask) == search->packed;
+}
+
+/**
+ * Verifies every candidate in the bit mask of one block.
+ * @param search an initialized search_t
+ * @param block pointer to the haystack position of bit 0
+ * @param mask bit i is set if position i is a candidate
+ * @param ignore_case if the candidates should be compared case insensitive
+ * @param packed if every candidate has 8 readable bytes and is compared with
+ * 'search_equal_packed'
+ * @return Returns the first verified candidate or NULL.
+ */
+static inline const char *search_verify(const search_t *search,
+                                        const char *block, unsigned int mask,
+                                        bool ignore_case, bool packed) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+
+  if (needle_len <= 2) {
+    // first and last byte are the whole needle
+    return mask != 0 ? block + __builtin_ctz(mask) : NULL;
+  }
+
+  while (mask != 0) {
+    int bit = __builtin_ctz(mask);
+    const char *candidate = block + bit;
+
+    // first and last byte are already known to match
+    bool equal;
+    if (packed) {
+      equal = search_equal_packed(search, candidate);
+    } else if (ignore_case) {
+      equal = search_equal_icase(candidate + 1, needle + 1, needle_len - 2);
+    } else {
+      equal = memcmp(candidate + 1, needle + 1, needle_len - 2) == 0;
+    }
+
+    if (equal) {
+      return candidate;
+    }
+
+    mask &= mask - 1;
+  }
+
+  return NULL;
+}
+
+/**
+ * Kernel for a single byte, which the C library searches fastest.
+ * @details Also used for case insensitive searches of a byte without case.
+ */
+static const char *search_find_byte(const search_t *search,
+                                    const char *haystack,
+                                    size_t haystack_len) {
+  return memchr(haystack, search->needle[0], haystack_len);
+}
+
+/**
+ * Case insensitive kernel for a single ASCII letter.
+ * @details Searches both cases with memchr, the uppercase letter only up to
+ * the lowercase one. The haystack is searched in windows that double in size,
+ * so a case that doesn't occur never costs more than the distance to the
+ * match.
+ */
+static const char *search_find_byte_icase(const search_t *search,
+                                          const char *haystack,
+                                          size_t haystack_len) {
+  const char lower = search->needle[0];
+  const char upper = (char)(lower & ~0x20);
+
+  size_t window = SEARCH_WINDOW_MIN;
+  size_t offset = 0;
+
+  while (offset < haystack_len) {
+    const char *start = haystack + offset;
+    size_t left = haystack_len - offset;
+    size_t len = left < window ? left : window;
+
+    const char *found = memchr(start, lower, len);
+    const char *found_upper =
+        memchr(start, upper, found != NULL ? (size_t)(found - start) : len);
+    if (found_upper != NULL) {
+      return found_upper;
+    }
+    if (found != NULL) {
+      return found;
+    }
+
+    offset += len;
+    if (window < SEARCH_WINDOW_MAX) {
+      window *= 2;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Scalar kernel, used for the tail of the vector kernels and on cpus without
+ * a supported vector unit.
+ * @details Jumps with memchr to the next occurrence of the rarest byte of the
+ * needle and compares the whole needle from there. Needles of up to 8 bytes
+ * are compared with a single word compare while 8 bytes are left.
+ */
+static const char *search_find_scalar(const search_t *search,
+                                      const char *haystack,
+                                      size_t haystack_len) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+  const size_t rare = search->rare;
+
+  if (haystack_len < needle_len) {
+    return NULL;
+  }
+
+  // candidates are searched by the position of their rare byte
+  const char *current = haystack + rare;
+  const char *end = haystack + (haystack_len - needle_len) + 1 + rare;
+  // the first candidate that has less than 8 readable bytes
+  const char *packed_end =
+      haystack_len >= 8 ? haystack + (haystack_len - 8) + 1 : haystack;
+
+  while (current < end) {
+    current = memchr(current, needle[rare], end - current);
+    if (current == NULL) {
+      return NULL;
+    }
+
+    const char *candidate = current - rare;
+    bool equal = needle_len <= SEARCH_PACKED_MAX && candidate < packed_end
+                     ? search_equal_packed(search, candidate)
+                     : memcmp(candidate, needle, needle_len) == 0;
+    if (equal) {
+      return candidate;
+    }
+
+    current += 1;
+  }
+
+  return NULL;
+}
+
+/**
+ * Case insensitive scalar kernel for ASCII needles.
+ */
+static const char *search_find_scalar_icase(const search_t *search,
+                                            const char *haystack,
+                                            size_t haystack_len) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+
+  if (haystack_len < needle_len) {
+    return NULL;
+  }
+
+  const unsigned char first = (unsigned char)needle[0];
+  const unsigned char bit = search_case_bit(first);
+
+  for (size_t i = 0; i + needle_len <= haystack_len; i += 1) {
+    if (((unsigned char)haystack[i] | bit) == first &&
+        search_equal_icase(haystack + i + 1, needle + 1, needle_len - 1)) {
+      return haystack + i;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Horspool kernel for long needles.
+ * @details Compares the last byte of the window first and shifts the window
+ * by the distance of that byte to the end of the needle, so most of the
+ * haystack is never looked at. The shift table is built by 'search_init', for
+ * case insensitive searches it holds both cases of every letter.
+ */
+static const char *search_find_horspool(const search_t *search,
+                                        const char *haystack,
+                                        size_t haystack_len) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+  const bool ignore_case = search->ignore_case;
+  const unsigned char last = (unsigned char)needle[needle_len - 1];
+  const unsigned char last_bit = ignore_case ? search_case_bit(last) : 0;
+
+  for (size_t i = 0; i + needle_len <= haystack_len;) {
+    unsigned char c = (unsigned char)haystack[i + needle_len - 1];
+
+    if ((c | last_bit) == last) {
+      bool equal =
+          ignore_case
+              ? search_equal_icase(haystack + i, needle, needle_len - 1)
+              : memcmp(haystack + i, needle, needle_len - 1) == 0;
+      if (equal) {
+        return haystack + i;
+      }
+    }
+
+    i += search->shift[c];
+  }
+
+  return NULL;
+}
+
+/**
+ * Scalar tail of the vector kernels.
+ */
+static inline const char *search_tail(const search_t *search,
+                                      const char *haystack,
+                                      size_t haystack_len, bool ignore_case) {
+  if (ignore_case) {
+    return search_find_scalar_icase(search, haystack, haystack_len);
+  }
+  return search_find_scalar(search, haystack, haystack_len);
+}
+
+#if defined(SEARCH_X86) && defined(__SSE2__)
+/**
+ * SSE2 kernel body, checks 16 haystack positions per iteration.
+ * @details For a case sensitive search both case bits are 0, so the or is a
+ * no-op and the compiler drops the folding compare after inlining. A packed
+ * search stops the vector loop 8 bytes before the end of the haystack, so
+ * every candidate can be loaded as a whole word.
+ */
+static inline const char *search_sse2(const search_t *search,
+                                      const char *haystack,
+                                      size_t haystack_len, bool ignore_case,
+                                      bool packed) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+  const unsigned char first_byte = (unsigned char)needle[0];
+  const unsigned char last_byte = (unsigned char)needle[needle_len - 1];
+
+  const __m128i first = _mm_set1_epi8((char)first_byte);
+  const __m128i last = _mm_set1_epi8((char)last_byte);
+  const __m128i first_bit =
+      _mm_set1_epi8(ignore_case ? (char)search_case_bit(first_byte) : 0);
+  const __m128i last_bit =
+      _mm_set1_epi8(ignore_case ? (char)search_case_bit(last_byte) : 0);
+
+  // how many bytes have to be readable from the last candidate of a block on
+  const size_t reach = packed ? 8 : needle_len;
+
+  size_t i = 0;
+  for (; i + 16 + reach - 1 <= haystack_len; i += 16) {
+    const __m128i block_first = _mm_or_si128(
+        _mm_loadu_si128((const __m128i *)(haystack + i)), first_bit);
+    const __m128i block_last = _mm_or_si128(
+        _mm_loadu_si128((const __m128i *)(haystack + i + needle_len - 1)),
+        last_bit);
+
+    const __m128i eq = _mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                     _mm_cmpeq_epi8(last, block_last));
+    unsigned int mask = (unsigned int)_mm_movemask_epi8(eq);
+
+    const char *found =
+        search_verify(search, haystack + i, mask, ignore_case, packed);
+    if (found != NULL) {
+      return found;
+    }
+  }
+
+  return search_tail(search, haystack + i, haystack_len - i, ignore_case);
+}
+
+/**
+ * Case sensitive SSE2 kernel.
+ */
+static const char *search_find_sse2(const search_t *search,
+                                    const char *haystack,
+                                    size_t haystack_len) {
+  return search_sse2(search, haystack, haystack_len, false, false);
+}
+
+/**
+ * Case insensitive SSE2 kernel for ASCII needles.
+ */
+static const char *search_find_sse2_icase(const search_t *search,
+                                          const char *haystack,
+                                          size_t haystack_len) {
+  return search_sse2(search, haystack, haystack_len, true, false);
+}
+
+/**
+ * Case insensitive SSE2 kernel for ASCII needles of up to 8 bytes.
+ */
+static const char *search_find_sse2_packed_icase(const search_t *search,
+                                                 const char *haystack,
+                                                 size_t haystack_len) {
+  return search_sse2(search, haystack, haystack_len, true, true);
+}
+#endif
+
+#ifdef SEARCH_X86
+/**
+ * AVX2 kernel body, checks 32 haystack positions per iteration.
+ * @details Only called if the cpu reports AVX2 support.
+ */
+__attribute__((target("avx2"))) static inline const char *
+search_avx2(const search_t *search, const char *haystack, size_t haystack_len,
+            bool ignore_case, bool packed) {
+  const char *needle = search->needle;
+  const size_t needle_len = search->needle_len;
+  const unsigned char first_byte = (unsigned char)needle[0];
+  const unsigned char last_byte = (unsigned char)needle[needle_len - 1];
+
+  const __m256i first = _mm256_set1_epi8((char)first_byte);
+  const __m256i last = _mm256_set1_epi8((char)last_byte);
+  const __m256i first_bit =
+      _mm256_set1_epi8(ignore_case ? (char)search_case_bit(first_byte) : 0);
+  const __m256i last_bit =
+      _mm256_set1_epi8(ignore_case ? (char)search_case_bit(last_byte) : 0);
+
+  const size_t reach = packed ? 8 : needle_len;
+
+  size_t i = 0;
+  for (; i + 32 + reach - 1 <= haystack_len; i += 32) {
+    const __m256i block_first = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(haystack + i)), first_bit);
+    const __m256i block_last = _mm256_or_si256(
+        _mm256_loadu_si256((const __m256i *)(haystack + i + needle_len - 1)),
+        last_bit);
+
+    const __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                        _mm256_cmpeq_epi8(last, block_last));
+    unsigned int mask = (unsigned int)_mm256_movemask_epi8(eq);
+
+    const char *found =
+        search_verify(search, haystack + i, mask, ignore_case, packed);
+    if (found != NULL) {
+      return found;
+    }
+  }
+
+  return search_tail(search, haystack + i, haystack_len - i, ignore_case);
+}
+
+/**
+ * Case sensitive AVX2 kernel.
+ */
+__attribute__((target("avx2"))) static const char *
+search_find_avx2(const search_t *search, const char *haystack,
+                 size_t haystack_len) {
+  return search_avx2(search, haystack, haystack_len, false, false);
+}
+
+/**
+ * Case insensitive AVX2 kernel for ASCII needles.
+ */
+__attribute__((target("avx2"))) static const char *
+search_find_avx2_icase(const search_t *search, const char *haystack,
+                       size_t haystack_len) {
+  return search_avx2(search, haystack, haystack_len, true, false);
+}
+
+/**
+ * Case insensitive AVX2 kernel for ASCII needles of up to 8 bytes.
+ */
+__attribute__((target("avx2"))) static const char *
+search_find_avx2_packed_icase(const search_t *search, const char *haystack,
+                              size_t haystack_len) {
+  return search_avx2(search, haystack, haystack_len, true, true);
+}
+#endif
+
+/**
+ * Checks the UTF-8 sequence that starts with a non ASCII byte.
+ * @details A sequence that is cut off by end is accepted, the probe may end in
+ * the middle of a character.
+ * @param str start of the sequence
+ * @param end end of the buffer
+ * @return Returns the length of the sequence or 0 if it is invalid.
+ */
+static size_t search_utf8_sequence(const unsigned char *str,
+                                   const unsigned char *end) {
+  unsigned char lead = str[0];
+  unsigned char low = 0x80;
+  unsigned char high = 0xBF;
+  size_t len;
+
+  if (lead >= 0xC2 && lead <= 0xDF) {
+    len = 2;
+  } else if (lead >= 0xE0 && lead <= 0xEF) {
+    len = 3;
+    // no overlong forms and no surrogates
+    low = lead == 0xE0 ? 0xA0 : 0x80;
+    high = lead == 0xED ? 0x9F : 0xBF;
+  } else if (lead >= 0xF0 && lead <= 0xF4) {
+    len = 4;
+    // no overlong forms and nothing above U+10FFFF
+    low = lead == 0xF0 ? 0x90 : 0x80;
+    high = lead == 0xF4 ? 0x8F : 0xBF;
+  } else {
+    return 0;
+  }
+
+  for (size_t i = 1; i < len; i += 1) {
+    if (str + i >= end) {
+      return end - str;
+    }
+
+    unsigned char c = str[i];
+    if (c < (i == 1 ? low : 0x80) || c > (i == 1 ? high : 0xBF)) {
+      return 0;
+    }
+  }
+
+  return len;
+}
+
+/**
+ * Scalar check for 'search_is_binary', also used for the bytes the vector
+ * kernels can't decide on their own.
+ * @param str the bytes to check
+ * @param end end of the part that should be checked
+ * @param limit end of the whole buffer, sequences may reach up to it
+ * @param binary set to 'true' if the bytes are binary
+ * @return Returns a pointer after the last checked sequence.
+ */
+static const unsigned char *search_binary_scalar(const unsigned char *str,
+                                                 const unsigned char *end,
+                                                 const unsigned char *limit,
+                                                 bool *binary) {
+  while (str < end) {
+    if (*str == '\0') {
+      *binary = true;
+      return str;
+    }
+
+    if (*str < 0x80) {
+      str += 1;
+      continue;
+    }
+
+    size_t len = search_utf8_sequence(str, limit);
+    if (len == 0) {
+      *binary = true;
+      return str;
+    }
+    str += len;
+  }
+
+  return str;
+}
+
+#ifdef SEARCH_X86
+#ifdef __SSE2__
+/**
+ * SSE2 kernel of 'search_is_binary'.
+ * @details Blocks of plain ASCII without a NUL byte are skipped with two
+ * compares, only blocks with non ASCII bytes are decoded.
+ */
+static bool search_binary_sse2(const unsigned char *str,
+                               const unsigned char *end) {
+  const __m128i zero = _mm_setzero_si128();
+  bool binary = false;
+
+  while (end - str >= 16) {
+    __m128i block = _mm_loadu_si128((const __m128i *)str);
+    unsigned int nul = _mm_movemask_epi8(_mm_cmpeq_epi8(block, zero));
+    unsigned int high = _mm_movemask_epi8(block);
+
+    if (nul != 0) {
+      return true;
+    }
+    if (high == 0) {
+      str += 16;
+      continue;
+    }
+
+    str = search_binary_scalar(str + __builtin_ctz(high), str + 16, end,
+                               &binary);
+    if (binary) {
+      return true;
+    }
+  }
+
+  search_binary_scalar(str, end, end, &binary);
+  return binary;
+}
+#endif
+
+/**
+ * AVX2 kernel of 'search_is_binary', see 'search_binary_sse2'.
+ */
+__attribute__((target("avx2"))) static bool
+search_binary_avx2(const unsigned char *str, const unsigned char *end) {
+  const __m256i zero = _mm256_setzero_si256();
+  bool binary = false;
+
+  while (end - str >= 32) {
+    __m256i block = _mm256_loadu_si256((const __m256i *)str);
+    unsigned int nul = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, zero));
+    unsigned int high = _mm256_movemask_epi8(block);
+
+    if (nul != 0) {
+      return true;
+    }
+    if (high == 0) {
+      str += 32;
+      continue;
+    }
+
+    str = search_binary_scalar(str + __builtin_ctz(high), str + 32, end,
+                               &binary);
+    if (binary) {
+      return true;
+    }
+  }
+
+  search_binary_scalar(str, end, end, &binary);
+  return binary;
+}
+#endif
+
+/**
+ * Scalar kernel of 'search_is_binary', used on cpus without SSE2.
+ */
+static bool search_binary_plain(const unsigned char *str,
+                                const unsigned char *end) {
+  bool binary = false;
+  search_binary_scalar(str, end, end, &binary);
+  return binary;
+}
+
+#ifdef SEARCH_X86
+#ifdef __SSE2__
+/**
+ * SSE2 kernel of 'search_count_newlines'.
+ * @details The compare results (-1 per newline) are summed up bytewise for at
+ * most 255 blocks and then added horizontally with 'psadbw', so there is no
+ * popcount per block.
+ */
+static size_t search_newlines_sse2(const char *str, size_t len) {
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i zero = _mm_setzero_si128();
+  size_t count = 0;
+
+  while (len >= 16) {
+    size_t blocks = len / 16 > 255 ? 255 : len / 16;
+    __m128i sum = _mm_setzero_si128();
+
+    for (size_t i = 0; i < blocks; i += 1) {
+      __m128i block = _mm_loadu_si128((const __m128i *)str);
+      sum = _mm_sub_epi8(sum, _mm_cmpeq_epi8(block, newline));
+      str += 16;
+    }
+    len -= blocks * 16;
+
+    __m128i total = _mm_sad_epu8(sum, zero);
+    count += _mm_cvtsi128_si32(total) +
+             _mm_cvtsi128_si32(_mm_unpackhi_epi64(total, total));
+  }
+
+  for (size_t i = 0; i < len; i += 1) {
+    count += str[i] == '\n';
+  }
+
+  return count;
+}
+#endif
+
+/**
+ * AVX2 kernel of 'search_count_newlines', see 'search_newlines_sse2'.
+ */
+__attribute__((target("avx2"))) static size_t
+search_newlines_avx2(const char *str, size_t len) {
+  const __m256i newline = _mm256_set1_epi8('\n');
+  const __m256i zero = _mm256_setzero_si256();
+  size_t count = 0;
+
+  while (len >= 32) {
+    size_t blocks = len / 32 > 255 ? 255 : len / 32;
+    __m256i sum = _mm256_setzero_si256();
+
+    for (size_t i = 0; i < blocks; i += 1) {
+      __m256i block = _mm256_loadu_si256((const __m256i *)str);
+      sum = _mm256_sub_epi8(sum, _mm256_cmpeq_epi8(block, newline));
+      str += 32;
+    }
+    len -= blocks * 32;
+
+    __m256i total = _mm256_sad_epu8(sum, zero);
+    count += _mm256_extract_epi64(total, 0) + _mm256_extract_epi64(total, 1) +
+             _mm256_extract_epi64(total, 2) + _mm256_extract_epi64(total, 3);
+  }
+
+  for (size_t i = 0; i < len; i += 1) {
+    count += str[i] == '\n';
+  }
+
+  return count;
+}
+#endif
+
+/**
+ * Scalar kernel of 'search_count_newlines', used on cpus without SSE2.
+ */
+static size_t search_newlines_plain(const char *str, size_t len) {
+  size_t count = 0;
+  for (size_t i = 0; i < len; i += 1) {
+    count += str[i] == '\n';
+  }
+
+  return count;
+}
+
+/**
+ * The kernels of 'search_is_binary' and 'search_count_newlines'.
+ */
+static bool (*search_binary_kernel)(const unsigned char *,
+                                    const unsigned char *) =
+    search_binary_plain;
+static size_t (*search_newlines_kernel)(const char *, size_t) =
+    search_newlines_plain;
+
+#ifdef SEARCH_X86
+/**
+ * The fastest kernels the cpu supports, set by 'search_pick_kernels'.
+ */
+static search_level_e search_supported = E_SEARCH_SCALAR;
+/**
+ * The fastest kernels that are used, only lowered by the kernel tests.
+ */
+static search_level_e search_level = E_SEARCH_SCALAR;
+
+/**
+ * Picks the kernels of 'search_is_binary' and 'search_count_newlines' for
+ * 'search_level'.
+ */
+static void search_pick_level(void) {
+  search_binary_kernel = search_binary_plain;
+  search_newlines_kernel = search_newlines_plain;
+
+#ifdef __SSE2__
+  if (search_level >= E_SEARCH_SSE2) {
+    search_binary_kernel = search_binary_sse2;
+    search_newlines_kernel = search_newlines_sse2;
+  }
+#endif
+
+  if (search_level >= E_SEARCH_AVX2) {
+    search_binary_kernel = search_binary_avx2;
+    search_newlines_kernel = search_newlines_avx2;
+  }
+}
+
+/**
+ * Asks the cpu for its vector extensions once before main, so the threads
+ * never race on the kernels and neither a call nor 'search_init' has to ask
+ * the cpu again.
+ */
+__attribute__((constructor)) static void search_pick_kernels(void) {
+#ifdef __SSE2__
+  search_supported = E_SEARCH_SSE2;
+#endif
+
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    search_supported = E_SEARCH_AVX2;
+  }
+
+  search_level = search_supported;
+  search_pick_level();
+}
+#endif
+
+#ifdef SEARCH_TEST
+search_level_e search_limit_level(search_level_e level) {
+#ifdef SEARCH_X86
+  search_level = level < search_supported ? level : search_supported;
+  search_pick_level();
+
+  return search_level;
+#else
+  (void)level;
+  return E_SEARCH_SCALAR;
+#endif
+}
+#endif
+
+bool search_is_binary(const char *buffer, size_t len) {
+  const unsigned char *str = (const unsigned char *)buffer;
+
+  return search_binary_kernel(str, str + len);
+}
+
+size_t search_count_newlines(const char *buffer, size_t len) {
+  return search_newlines_kernel(buffer, len);
+}
+
+void search_fold(char *str) {
+  unsigned char *current = (unsigned char *)str;
+  size_t len = strlen(str);
+
+  while (len > 0) {
+    size_t step = search_fold_char(current, len, current);
+    current += step;
+    len -= step;
+  }
+}
+
+/**
+ * Packs a needle of up to 8 bytes into the words 'search_equal_packed'
+ * compares against.
+ */
+static void search_init_packed(search_t *search) {
+  unsigned char packed[8] = {0};
+  unsigned char mask[8] = {0};
+  unsigned char bits[8] = {0};
+
+  for (size_t i = 0; i < search->needle_len && i < sizeof(packed); i += 1) {
+    packed[i] = (unsigned char)search->needle[i];
+    mask[i] = 0xFF;
+    bits[i] = search->ignore_case ? search_case_bit(packed[i]) : 0;
+  }
+
+  memcpy(&search->packed, packed, sizeof(search->packed));
+  memcpy(&search->packed_mask, mask, sizeof(search->packed_mask));
+  memcpy(&search->packed_case, bits, sizeof(search->packed_case));
+}
+
+/**
+ * Builds the Horspool shift table of a long needle.
+ * @details A byte is shifted by its distance from the end of the needle,
+ * bytes that aren't part of the needle by the whole needle. Shifts are capped
+ * at 255, a smaller shift is always safe.
+ */
+static void search_init_shift(search_t *search) {
+  const size_t needle_len = search->needle_len;
+  const unsigned char cap = needle_len < 255 ? (unsigned char)needle_len : 255;
+
+  memset(search->shift, cap, sizeof(search->shift));
+  for (size_t i = 0; i + 1 < needle_len; i += 1) {
+    unsigned char c = (unsigned char)search->needle[i];
+    size_t distance = needle_len - 1 - i;
+    unsigned char shift = distance < 255 ? (unsigned char)distance : 255;
+
+    search->shift[c] = shift;
+    if (search->ignore_case && search_case_bit(c) != 0) {
+      search->shift[c & ~0x20] = shift;
+    }
+  }
+}
+
+/**
+ * Bytes that are common in text and source code, the most common one first.
+ * Every byte that isn't listed is considered rarer than all of them.
+ */
+static const char search_common[] =
+    " etaoinsrhldcumfpgwybvkxjqz\n\t_()*;,.=-/\"'>{}0123456789"
+    "ETAOINSRHLDCUMFPGWYBVKXJQZ";
+
+/**
+ * Picks the byte of the needle that is expected to occur the least in the
+ * haystack, the scalar kernel jumps from one occurrence of it to the next.
+ */
+static void search_init_rare(search_t *search) {
+  const size_t common_len = sizeof(search_common) - 1;
+  size_t rarest = 0;
+  search->rare = 0;
+
+  for (size_t i = 0; i < search->needle_len; i += 1) {
+    const char *common = memchr(search_common, search->needle[i], common_len);
+    size_t rarity = common != NULL ? (size_t)(common - search_common)
+                                   : common_len;
+
+    if (rarity > rarest) {
+      rarest = rarity;
+      search->rare = i;
+    }
+  }
+}
+
+void search_init(search_t *search, const char *needle, bool ignore_case) {
+  search->needle = needle;
+  search->needle_len = strlen(needle);
+  search->ignore_case = ignore_case;
+
+  bool ascii = true;
+  for (size_t i = 0; i < search->needle_len; i += 1) {
+    if ((unsigned char)needle[i] >= 0x80) {
+      ascii = false;
+    }
+  }
+
+  if (ignore_case && ascii == false) {
+    search->kernel = search_find_utf8_icase;
+    return;
+  }
+
+  const size_t needle_len = search->needle_len;
+  search_init_packed(search);
+  search_init_rare(search);
+
+  if (needle_len <= 1) {
+    // an empty needle is answered by 'search_find' itself
+    bool letter = needle_len == 1 && search_case_bit(needle[0]) != 0;
+    search->kernel =
+        ignore_case && letter ? search_find_byte_icase : search_find_byte;
+    return;
+  }
+
+  if (needle_len > SEARCH_HORSPOOL_MIN) {
+    search_init_shift(search);
+    search->kernel = search_find_horspool;
+    return;
+  }
+
+  // the scalar kernel jumps to the rare byte of a short case sensitive
+  // needle faster than the vector kernels can filter its first and last byte
+  search->kernel = ignore_case ? search_find_scalar_icase : search_find_scalar;
+  const bool packed = needle_len <= SEARCH_PACKED_MAX;
+  if (ignore_case == false && packed) {
+    return;
+  }
+
+#ifdef SEARCH_X86
+#ifdef __SSE2__
+  if (search_level >= E_SEARCH_SSE2) {
+    if (ignore_case) {
+      search->kernel =
+          packed ? search_find_sse2_packed_icase : search_find_sse2_icase;
+    } else {
+      search->kernel = search_find_sse2;
+    }
+  }
+#endif
+
+  if (search_level >= E_SEARCH_AVX2) {
+    if (ignore_case) {
+      search->kernel =
+          packed ? search_find_avx2_packed_icase : search_find_avx2_icase;
+    } else {
+      search->kernel = search_find_avx2;
+    }
+  }
+#endif
+}
+
+const char *search_find(const search_t *search, const char *haystack,
+                        size_t haystack_len) {
+  if (search->needle_len == 0) {
+    return haystack;
+  }
+
+  if (haystack_len < search->needle_len) {
+    return NULL;
+  }
+
+  return search->kernel(search, haystack, haystack_len);
+}
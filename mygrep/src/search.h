@@ -0,0 +1,142 @@
+/**
+ * @file search.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a vectorized substring search for the keyword.
+ */
+
+#ifndef _SEARCH_H
+#define _SEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct search;
+
+/**
+ * Signature of a substring search kernel.
+ * @param search the search_t the kernel has been picked for
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes, at least the needle length
+ * @return Returns a pointer to the first occurrence of the needle or NULL.
+ */
+typedef const char *(*search_kernel_fn)(const struct search *search,
+                                        const char *haystack,
+                                        size_t haystack_len);
+
+/**
+ * Needles of up to this many bytes are compared with a single word compare.
+ */
+#define SEARCH_PACKED_MAX (8)
+
+/**
+ * Needles longer than this are searched with the Horspool kernel.
+ */
+#define SEARCH_HORSPOOL_MIN (64)
+
+/**
+ * @brief The kernels that may be picked, from the slowest to the fastest.
+ */
+typedef enum search_level {
+  E_SEARCH_SCALAR, ///< scalar kernels only
+  E_SEARCH_SSE2,   ///< SSE2 kernels
+  E_SEARCH_AVX2    ///< AVX2 kernels
+} search_level_e;
+
+typedef struct search {
+  const char *needle; ///< bytes to search for, not owned by the search_t
+  size_t needle_len;  ///< length of needle in bytes
+  bool ignore_case;   ///< 'true' if the needle has been folded by 'search_fold'
+
+  search_kernel_fn kernel; ///< kernel picked by 'search_init'
+
+  size_t rare;              ///< index of the byte the scalar kernel jumps to
+  uint64_t packed;          ///< needle of up to 8 bytes packed into a word
+  uint64_t packed_mask;     ///< selects the needle bytes of a loaded word
+  uint64_t packed_case;     ///< case bits set on a loaded word before comparing
+  unsigned char shift[256]; ///< Horspool shifts of a long needle
+} search_t;
+
+/**
+ * Folds the given string to lowercase in place.
+ * @brief Folds ASCII letters and the two byte UTF-8 characters that have a
+ * simple lowercase mapping. The length of the string never changes.
+ * @param str NUL terminated string to fold
+ */
+void search_fold(char *str);
+
+/**
+ * Folds the character at the start of str like 'search_fold' does.
+ * @brief The folded character always has the same length as the input, so
+ * a haystack can be folded on the fly while it is compared with a folded
+ * needle.
+ * @param str bytes to fold
+ * @param len number of readable bytes at str, at least 1
+ * @param folded where to store the folded bytes, at least 2 bytes
+ * @return Returns how many bytes have been folded (1 or 2).
+ */
+size_t search_fold_char(const unsigned char *str, size_t len,
+                        unsigned char *folded);
+
+/**
+ * Prepares a search for the given needle.
+ * @brief Stores the needle and picks a kernel by its length: memchr for a
+ * single byte, a jump to the rarest byte and a packed word compare for up to
+ * 8 bytes, the fastest vector kernel the cpu supports (AVX2, SSE2 or the
+ * scalar fallback) for up to 64 bytes and Horspool for longer needles. Case
+ * insensitive needles of up to 8 bytes are filtered by the vector kernels and
+ * compared packed.
+ * @param search the search_t that should be initialized.
+ * @param needle NUL terminated string to search for, must outlive the search.
+ * If ignore_case is set it has to be folded with 'search_fold' already.
+ * @param ignore_case 'true' if the search should be case insensitive
+ */
+void search_init(search_t *search, const char *needle, bool ignore_case);
+
+/**
+ * Finds the first occurrence of the needle inside the haystack.
+ * @param search an initialized search_t
+ * @param haystack bytes to search in, does not have to be NUL terminated
+ * @param haystack_len length of haystack in bytes
+ * @return Returns a pointer to the first occurrence or NULL.
+ */
+const char *search_find(const search_t *search, const char *haystack,
+                        size_t haystack_len);
+
+/**
+ * Checks if the bytes are no text.
+ * @brief Bytes are binary if they contain a NUL byte or are no valid UTF-8.
+ * A character that is cut off at the end of the buffer is still valid. Plain
+ * ASCII is checked a whole vector at a time.
+ * @param buffer the bytes to check
+ * @param len length of buffer in bytes
+ * @return Returns true if the bytes are binary.
+ */
+bool search_is_binary(const char *buffer, size_t len);
+
+/**
+ * Counts the newlines in a buffer.
+ * @brief Compares a whole vector at a time and sums the results up without a
+ * popcount per vector.
+ * @param buffer the bytes to count in
+ * @param len length of buffer in bytes
+ * @return Returns how many '\\n' the buffer contains.
+ */
+size_t search_count_newlines(const char *buffer, size_t len);
+
+#ifdef SEARCH_TEST
+/**
+ * Limits the kernels to the given level, only built for the kernel tests.
+ * @brief Lets the tests run the fallback kernels on a cpu that supports
+ * faster ones. Applies to every 'search_init' after the call and to
+ * 'search_is_binary' and 'search_count_newlines'. The level is never raised
+ * above what the cpu supports.
+ * @param level the fastest kernels that may be picked
+ * @return Returns the level that is used from now on.
+ */
+search_level_e search_limit_level(search_level_e level);
+#endif
+
+#endif /* _SEARCH_H */
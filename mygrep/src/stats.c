@@ -0,0 +1,202 @@
+/**
+ * @file stats.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides the throughput and timing statistics of '--stats'.
+ *
+ * @details The statistics are printed as a single JSON object:
+ *
+ *     {"files": [{"name": ..., "bytes": ..., "lines": ..., "matches": ...,
+ *                 "io_ms": ..., "match_ms": ..., "output_ms": ...,
+ *                 "gb_per_s": ...}, ...],
+ *      "total": {"files": ..., "bytes": ..., "lines": ..., "matches": ...,
+ *                "io_ms": ..., "match_ms": ..., "output_ms": ...,
+ *                "wall_ms": ..., "gb_per_s": ...}}
+ *
+ * The throughput of an input is measured against the time spent on it, the
+ * total throughput against the wall time of the whole search. The lines of a
+ * mapped input are only counted with '-n', otherwise they are null.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+/**
+ * @brief A recorded input.
+ */
+typedef struct stats_entry {
+  char *name;    ///< name of the input
+  stats_t stats; ///< the statistics of the input
+} stats_entry_t;
+
+/**
+ * Guards the recorded inputs.
+ */
+static pthread_mutex_t stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+/**
+ * The recorded inputs in the order they have been finished.
+ */
+static stats_entry_t *stats_entries = NULL;
+/**
+ * How many inputs have been recorded.
+ */
+static int stats_entries_num = 0;
+/**
+ * The capacity of 'stats_entries'.
+ */
+static int stats_entries_capacity = 0;
+/**
+ * When 'stats_init' has been called.
+ */
+static long long stats_started = 0;
+
+long long stats_now(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+void stats_init(void) { stats_started = stats_now(); }
+
+int stats_add(const char *name, const stats_t *stats) {
+  char *copy = strdup(name);
+  if (copy == NULL) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&stats_mutex);
+
+  if (stats_entries_num >= stats_entries_capacity) {
+    int grown_capacity =
+        stats_entries_capacity == 0 ? 64 : stats_entries_capacity * 2;
+    stats_entry_t *grown =
+        realloc(stats_entries, grown_capacity * sizeof(stats_entry_t));
+    if (grown == NULL) {
+      pthread_mutex_unlock(&stats_mutex);
+      free(copy);
+      return -1;
+    }
+
+    stats_entries = grown;
+    stats_entries_capacity = grown_capacity;
+  }
+
+  stats_entries[stats_entries_num].name = copy;
+  stats_entries[stats_entries_num].stats = *stats;
+  stats_entries_num += 1;
+
+  pthread_mutex_unlock(&stats_mutex);
+
+  return 0;
+}
+
+/**
+ * Prints a string as a JSON string, bytes that aren't ASCII are passed on as
+ * they are.
+ */
+static void stats_print_string(FILE *out, const char *str) {
+  fputc('"', out);
+
+  for (; *str != '\0'; str += 1) {
+    unsigned char c = *str;
+    if (c == '"' || c == '\\') {
+      fprintf(out, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(out, "\\u%04x", c);
+    } else {
+      fputc(c, out);
+    }
+  }
+
+  fputc('"', out);
+}
+
+/**
+ * Returns the throughput in GB/s, 0 if no time has been measured.
+ */
+static double stats_throughput(unsigned long long bytes, long long ns) {
+  return ns > 0 ? (double)bytes / (double)ns : 0.0;
+}
+
+/**
+ * Prints the fields both an input and the total have, lines that haven't
+ * been counted are null.
+ */
+static void stats_print_fields(FILE *out, const stats_t *stats) {
+  fprintf(out, "\"bytes\": %llu, \"lines\": ", stats->bytes);
+  if (stats->lines_unknown) {
+    fprintf(out, "null");
+  } else {
+    fprintf(out, "%llu", stats->lines);
+  }
+  fprintf(out,
+          ", \"matches\": %ld, \"io_ms\": %.3f, \"match_ms\": %.3f, "
+          "\"output_ms\": %.3f",
+          stats->matches, stats->io_ns / 1e6, stats->match_ns / 1e6,
+          stats->output_ns / 1e6);
+}
+
+int stats_print(long long output_ns) {
+  long long wall_ns = stats_now() - stats_started;
+  stats_t total;
+  memset(&total, 0, sizeof(total));
+
+  // stderr is unbuffered, so everything is written at once in the end
+  char *json = NULL;
+  size_t json_len = 0;
+  FILE *out = open_memstream(&json, &json_len);
+  if (out == NULL) {
+    return -1;
+  }
+
+  fprintf(out, "{\"files\": [");
+
+  for (int i = 0; i < stats_entries_num; i += 1) {
+    const stats_t *stats = &stats_entries[i].stats;
+
+    fprintf(out, "%s\n  {\"name\": ", i == 0 ? "" : ",");
+    stats_print_string(out, stats_entries[i].name);
+    fprintf(out, ", ");
+    stats_print_fields(out, stats);
+    fprintf(out, ", \"gb_per_s\": %.3f}",
+            stats_throughput(stats->bytes, stats->io_ns + stats->match_ns +
+                                               stats->output_ns));
+
+    total.bytes += stats->bytes;
+    total.lines += stats->lines;
+    if (stats->lines_unknown) {
+      total.lines_unknown = true;
+    }
+    total.matches += stats->matches;
+    total.io_ns += stats->io_ns;
+    total.match_ns += stats->match_ns;
+
+    free(stats_entries[i].name);
+  }
+  total.output_ns = output_ns;
+
+  fprintf(out, "],\n \"total\": {\"files\": %d, ", stats_entries_num);
+  stats_print_fields(out, &total);
+  fprintf(out, ", \"wall_ms\": %.3f, \"gb_per_s\": %.3f}}\n", wall_ns / 1e6,
+          stats_throughput(total.bytes, wall_ns));
+
+  free(stats_entries);
+  stats_entries = NULL;
+  stats_entries_num = 0;
+  stats_entries_capacity = 0;
+
+  int result = fclose(out) == 0 ? 0 : -1;
+  if (result == 0 && fwrite(json, sizeof(char), json_len, stderr) != json_len) {
+    result = -1;
+  }
+  free(json);
+
+  return result;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file stats.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides the throughput and timing statistics of '--stats'.
+ */
+
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdbool.h>
+
+/**
+ * @brief Statistics of a single input.
+ */
+typedef struct stats {
+  unsigned long long bytes; ///< how many bytes have been searched
+  unsigned long long lines; ///< how many lines have been searched
+  bool lines_unknown;       ///< 'true' if the lines haven't been counted
+  long matches;             ///< how many lines have matched
+  long long io_ns;          ///< time spent mapping or reading the input
+  long long match_ns;       ///< time spent searching the input
+  long long output_ns;      ///< time spent writing the output of the input
+} stats_t;
+
+/**
+ * Returns the current time of a monotonic clock in nanoseconds.
+ */
+long long stats_now(void);
+
+/**
+ * Starts the statistics of the whole search, the total throughput is measured
+ * from now on.
+ */
+void stats_init(void);
+
+/**
+ * Records the statistics of a finished input.
+ * @brief Can be called from multiple threads at once, it only takes a lock
+ * once per input.
+ * @param name name of the input
+ * @param stats the statistics of the input
+ * @return Returns 0 if non error has been encountered.
+ */
+int stats_add(const char *name, const stats_t *stats);
+
+/**
+ * Prints all recorded inputs and their total as JSON to stderr and frees them.
+ * @param output_ns time spent writing the whole output, the output of
+ * parallel searches is written by a thread that no input knows of
+ * @return Returns 0 if non error has been encountered.
+ */
+int stats_print(long long output_ns);
+
+#endif /* _STATS_H */
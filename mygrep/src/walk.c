@@ -0,0 +1,481 @@
+/**
+ * @file walk.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a parallel walk over directory trees.
+ *
+ * @details Every walker owns a stack of directories. The owner pushes and pops
+ * at the top, so it walks depth first and mostly stays in directories it has
+ * just read. An idle walker steals from the bottom of the other stacks, which
+ * holds the directories closest to the root and therefore the most work.
+ * The walk is over once no directory is queued and none is being read.
+ */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "walk.h"
+
+/**
+ * Size of the buffer the directory entries are read into.
+ */
+#define WALK_BUFFER_SIZE (32 * 1024)
+
+/**
+ * @brief Layout of the entries returned by 'getdents64'.
+ */
+typedef struct walk_dirent {
+  uint64_t d_ino;          ///< inode number
+  int64_t d_off;           ///< offset of the next entry
+  unsigned short d_reclen; ///< size of this entry in bytes
+  unsigned char d_type;    ///< file type, DT_UNKNOWN if the fs doesn't know
+  char d_name[];           ///< NUL terminated name
+} walk_dirent_t;
+
+struct walk;
+
+/**
+ * @brief A walker thread and the directories it still has to read.
+ */
+typedef struct walker {
+  struct walk *walk; ///< the walk this walker belongs to
+
+  char **dirs;  ///< paths of the queued directories
+  int bottom;   ///< index of the oldest directory, stolen by other walkers
+  int top;      ///< index after the newest directory, popped by the owner
+  int capacity; ///< the capacity of 'dirs'
+
+  pthread_mutex_t mutex; ///< guards the members above
+} walker_t;
+
+/**
+ * @brief State shared between all walkers.
+ */
+typedef struct walk {
+  walker_t *walkers; ///< all walkers
+  int walkers_num;   ///< how many walkers there are
+
+  walk_file_fn on_file;           ///< called for every file
+  walk_directory_fn on_directory; ///< called for every directory or NULL
+  void *context;                  ///< passed to both callbacks
+
+  int queued; ///< how many directories are queued in all walkers
+  int active; ///< how many directories are read right now
+  int result; ///< first non zero result of a callback
+  bool failed; ///< 'true' if a directory couldn't be read
+
+  pthread_mutex_t mutex;  ///< guards the members above
+  pthread_cond_t changed; ///< signaled if a directory is queued or done
+} walk_t;
+
+char *walk_join(const char *dir, const char *name) {
+  size_t dir_len = strlen(dir);
+  size_t name_len = strlen(name);
+  bool separator = dir_len > 0 && dir[dir_len - 1] != '/';
+
+  char *path = malloc(dir_len + separator + name_len + 1);
+  if (path == NULL) {
+    return NULL;
+  }
+
+  memcpy(path, dir, dir_len);
+  if (separator) {
+    path[dir_len] = '/';
+  }
+  memcpy(path + dir_len + separator, name, name_len + 1);
+
+  return path;
+}
+
+/**
+ * Queues a directory on the stack of the walker, takes ownership of dir.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int walk_push(walker_t *walker, char *dir) {
+  walk_t *walk = walker->walk;
+
+  pthread_mutex_lock(&walker->mutex);
+  if (walker->top >= walker->capacity) {
+    if (walker->bottom > 0) {
+      // reuse the space of the stolen directories first
+      memmove(walker->dirs, walker->dirs + walker->bottom,
+              (walker->top - walker->bottom) * sizeof(char *));
+      walker->top -= walker->bottom;
+      walker->bottom = 0;
+    } else {
+      int grown_capacity = walker->capacity == 0 ? 64 : walker->capacity * 2;
+      char **grown = realloc(walker->dirs, grown_capacity * sizeof(char *));
+      if (grown == NULL) {
+        pthread_mutex_unlock(&walker->mutex);
+        free(dir);
+        return -1;
+      }
+
+      walker->dirs = grown;
+      walker->capacity = grown_capacity;
+    }
+  }
+
+  // counted before it can be taken, so 'queued' never drops below zero
+  pthread_mutex_lock(&walk->mutex);
+  walk->queued += 1;
+  pthread_cond_signal(&walk->changed);
+  pthread_mutex_unlock(&walk->mutex);
+
+  walker->dirs[walker->top] = dir;
+  walker->top += 1;
+  pthread_mutex_unlock(&walker->mutex);
+
+  return 0;
+}
+
+/**
+ * Takes a directory from the stack of victim.
+ * @param victim the walker to take the directory from
+ * @param steal 'true' to take the oldest instead of the newest directory
+ * @return Returns the path of the directory or NULL if the stack is empty.
+ */
+static char *walk_take(walker_t *victim, bool steal) {
+  walk_t *walk = victim->walk;
+  char *dir = NULL;
+
+  pthread_mutex_lock(&victim->mutex);
+  if (victim->bottom < victim->top) {
+    if (steal) {
+      dir = victim->dirs[victim->bottom];
+      victim->bottom += 1;
+    } else {
+      victim->top -= 1;
+      dir = victim->dirs[victim->top];
+    }
+
+    if (victim->bottom == victim->top) {
+      victim->bottom = 0;
+      victim->top = 0;
+    }
+
+    pthread_mutex_lock(&walk->mutex);
+    walk->queued -= 1;
+    walk->active += 1;
+    pthread_mutex_unlock(&walk->mutex);
+  }
+  pthread_mutex_unlock(&victim->mutex);
+
+  return dir;
+}
+
+/**
+ * Takes the next directory for walker, from its own stack or from another
+ * walker.
+ * @return Returns the path of the directory or NULL if nothing is queued.
+ */
+static char *walk_next(walker_t *walker) {
+  char *dir = walk_take(walker, false);
+  if (dir != NULL) {
+    return dir;
+  }
+
+  walk_t *walk = walker->walk;
+  int self = walker - walk->walkers;
+  for (int i = 1; i < walk->walkers_num; i += 1) {
+    dir = walk_take(&walk->walkers[(self + i) % walk->walkers_num], true);
+    if (dir != NULL) {
+      return dir;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Records the result of a callback or of a failed directory.
+ */
+static void walk_report(walk_t *walk, int result, bool failed) {
+  pthread_mutex_lock(&walk->mutex);
+  if (result != 0 && walk->result == 0) {
+    walk->result = result;
+    pthread_cond_broadcast(&walk->changed);
+  }
+  if (failed) {
+    walk->failed = true;
+  }
+  pthread_mutex_unlock(&walk->mutex);
+}
+
+/**
+ * Checks if on_file has stopped the walk.
+ */
+static bool walk_stopped(walk_t *walk) {
+  pthread_mutex_lock(&walk->mutex);
+  bool stopped = walk->result != 0;
+  pthread_mutex_unlock(&walk->mutex);
+
+  return stopped;
+}
+
+/**
+ * Finds out the type of an entry whose type the directory doesn't know.
+ * @return Returns the DT_* type of the entry.
+ */
+static unsigned char walk_stat_type(int dir_fd, const char *name) {
+  struct stat entry_stat;
+  if (fstatat(dir_fd, name, &entry_stat, AT_SYMLINK_NOFOLLOW) == -1) {
+    return DT_UNKNOWN;
+  }
+
+  if (S_ISDIR(entry_stat.st_mode)) {
+    return DT_DIR;
+  }
+  if (S_ISREG(entry_stat.st_mode)) {
+    return DT_REG;
+  }
+
+  return DT_UNKNOWN;
+}
+
+/**
+ * Reads a directory, queues its subdirectories and reports its files.
+ * @param walker the walker that reads the directory
+ * @param dir path of the directory
+ */
+static void walk_directory(walker_t *walker, const char *dir) {
+  walk_t *walk = walker->walk;
+
+  int fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    fprintf(stderr, "Failed to open the directory %s: %s\n", dir,
+            strerror(errno));
+    walk_report(walk, 0, true);
+    return;
+  }
+
+  if (walk->on_directory != NULL) {
+    // before the entries, so an entry added meanwhile changes the status
+    struct stat dir_stat;
+    int result = -1;
+    if (fstat(fd, &dir_stat) == 0) {
+      result = walk->on_directory(walk->context, dir, &dir_stat);
+    }
+    if (result != 0) {
+      walk_report(walk, result, false);
+      close(fd);
+      return;
+    }
+  }
+
+  // long aligned, the kernel aligns the entries inside to 8 bytes
+  long buffer[WALK_BUFFER_SIZE / sizeof(long)];
+
+  long read;
+  while ((read = syscall(SYS_getdents64, fd, buffer, sizeof(buffer))) > 0) {
+    for (long offset = 0; offset < read;) {
+      walk_dirent_t *entry = (walk_dirent_t *)((char *)buffer + offset);
+      offset += entry->d_reclen;
+
+      const char *name = entry->d_name;
+      if (name[0] == '.' &&
+          (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+
+      unsigned char type = entry->d_type;
+      if (type == DT_UNKNOWN) {
+        type = walk_stat_type(fd, name);
+      }
+      if (type != DT_DIR && type != DT_REG) {
+        continue;
+      }
+
+      char *path = walk_join(dir, name);
+      if (path == NULL) {
+        walk_report(walk, -1, false);
+        break;
+      }
+
+      int result;
+      if (type == DT_DIR) {
+        result = walk_push(walker, path);
+      } else {
+        result = walk->on_file(walk->context, path);
+      }
+
+      if (result != 0) {
+        walk_report(walk, result, false);
+        break;
+      }
+    }
+
+    if (walk_stopped(walk)) {
+      break;
+    }
+  }
+
+  if (read == -1) {
+    fprintf(stderr, "Failed to read the directory %s: %s\n", dir,
+            strerror(errno));
+    walk_report(walk, 0, true);
+  }
+
+  close(fd);
+}
+
+/**
+ * Reads directories until nothing is queued and no walker can queue more.
+ * @param arg pointer to the walker_t of this thread
+ * @return Always returns NULL.
+ */
+static void *walk_worker(void *arg) {
+  walker_t *walker = arg;
+  walk_t *walk = walker->walk;
+
+  while (true) {
+    char *dir = walk_next(walker);
+
+    if (dir == NULL) {
+      pthread_mutex_lock(&walk->mutex);
+      while (walk->result == 0 && walk->queued == 0 && walk->active > 0) {
+        pthread_cond_wait(&walk->changed, &walk->mutex);
+      }
+      bool done =
+          walk->result != 0 || (walk->queued == 0 && walk->active == 0);
+      pthread_mutex_unlock(&walk->mutex);
+
+      if (done) {
+        break;
+      }
+      continue;
+    }
+
+    if (walk_stopped(walk) == false) {
+      walk_directory(walker, dir);
+    }
+    free(dir);
+
+    pthread_mutex_lock(&walk->mutex);
+    walk->active -= 1;
+    if (walk->active == 0 && walk->queued == 0) {
+      pthread_cond_broadcast(&walk->changed);
+    }
+    pthread_mutex_unlock(&walk->mutex);
+  }
+
+  return NULL;
+}
+
+/**
+ * Reports a path given to 'walk_paths' or queues it if it is a directory.
+ * @return Returns 0 if non error has been encountered.
+ */
+static int walk_root(walker_t *walker, const char *root) {
+  walk_t *walk = walker->walk;
+
+  char *path = strdup(root);
+  if (path == NULL) {
+    return -1;
+  }
+
+  // follows symbolic links, the user asked for exactly this path
+  struct stat root_stat;
+  if (stat(root, &root_stat) == 0 && S_ISDIR(root_stat.st_mode)) {
+    return walk_push(walker, path);
+  }
+
+  return walk->on_file(walk->context, path);
+}
+
+int walk_paths(char **paths, int paths_num, int threads, walk_file_fn on_file,
+               walk_directory_fn on_directory, void *context) {
+  walk_t walk;
+  walk.walkers_num = threads;
+  walk.on_file = on_file;
+  walk.on_directory = on_directory;
+  walk.context = context;
+  walk.queued = 0;
+  walk.active = 0;
+  walk.result = 0;
+  walk.failed = false;
+
+  walk.walkers = malloc(threads * sizeof(walker_t));
+  if (walk.walkers == NULL) {
+    return -1;
+  }
+
+  pthread_mutex_init(&walk.mutex, NULL);
+  pthread_cond_init(&walk.changed, NULL);
+
+  for (int i = 0; i < threads; i += 1) {
+    walker_t *walker = &walk.walkers[i];
+    walker->walk = &walk;
+    walker->dirs = NULL;
+    walker->bottom = 0;
+    walker->top = 0;
+    walker->capacity = 0;
+    pthread_mutex_init(&walker->mutex, NULL);
+  }
+
+  for (int i = 0; i < paths_num && walk.result == 0; i += 1) {
+    walker_t *walker = &walk.walkers[i % threads];
+    walk_report(&walk, walk_root(walker, paths[i]), false);
+
+    if (threads == 1) {
+      // finish every path before the next one to keep the order
+      walk_worker(walker);
+    }
+  }
+
+  if (threads > 1) {
+    pthread_t *workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+
+    if (workers != NULL) {
+      while (started < threads &&
+             pthread_create(&workers[started], NULL, walk_worker,
+                            &walk.walkers[started]) == 0) {
+        started += 1;
+      }
+    }
+
+    if (started == 0) {
+      // nothing could be started, walk in the calling thread instead
+      walk_worker(&walk.walkers[0]);
+    }
+
+    for (int i = 0; i < started; i += 1) {
+      pthread_join(workers[i], NULL);
+    }
+    free(workers);
+  }
+
+  for (int i = 0; i < threads; i += 1) {
+    walker_t *walker = &walk.walkers[i];
+
+    // only left over if the walk has been stopped
+    for (int j = walker->bottom; j < walker->top; j += 1) {
+      free(walker->dirs[j]);
+    }
+    free(walker->dirs);
+    pthread_mutex_destroy(&walker->mutex);
+  }
+
+  pthread_cond_destroy(&walk.changed);
+  pthread_mutex_destroy(&walk.mutex);
+  free(walk.walkers);
+
+  if (walk.result != 0) {
+    return walk.result;
+  }
+
+  return walk.failed ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file walk.h
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Provides a parallel walk over directory trees.
+ */
+
+#ifndef _WALK_H
+#define _WALK_H
+
+#include <sys/stat.h>
+
+/**
+ * Called for every file the walk finds.
+ * @param context the context given to 'walk_paths'
+ * @param path path of the file, the callee takes ownership and has to free it
+ * @return Returns 0 to continue the walk, everything else stops it.
+ */
+typedef int (*walk_file_fn)(void *context, char *path);
+
+/**
+ * Called for every directory the walk reads, before its entries are read.
+ * @param context the context given to 'walk_paths'
+ * @param path path of the directory, still owned by the walk
+ * @param dir_stat status of the opened directory
+ * @return Returns 0 to continue the walk, everything else stops it.
+ */
+typedef int (*walk_directory_fn)(void *context, const char *path,
+                                 const struct stat *dir_stat);
+
+/**
+ * Walks all paths and calls on_file for every regular file below them.
+ * @brief Every walker thread keeps its own stack of directories it still has
+ * to read and takes from the stacks of the other walkers once its own is
+ * empty. Directories are read with 'getdents64', the type of an entry is
+ * taken from the directory itself, so most files are found without a 'stat'.
+ * Symbolic links and special files inside a directory are skipped, paths that
+ * are no directory are passed to on_file as they are. With a single thread
+ * the walk runs in the calling thread and on_file is called in a fixed order.
+ * @param paths the paths to walk
+ * @param paths_num how many paths there are
+ * @param threads how many walker threads should be used
+ * @param on_file called for every file, from different threads at once if
+ * threads is greater than 1
+ * @param on_directory called for every directory like on_file, may be NULL
+ * @param context passed to every call of on_file and on_directory
+ * @return Returns 0 if non error has been encountered, the first non zero
+ * result of on_file or on_directory, or 1 if a directory couldn't be read.
+ */
+int walk_paths(char **paths, int paths_num, int threads, walk_file_fn on_file,
+               walk_directory_fn on_directory, void *context);
+
+/**
+ * Joins a directory and the name of an entry with a single '/'.
+ * @param dir path of the directory
+ * @param name name of the entry
+ * @return Returns the new path, which has to be freed, or NULL if no memory is
+ * left.
+ */
+char *walk_join(const char *dir, const char *name);
+
+#endif /* _WALK_H */
@@ -0,0 +1,213 @@
+/**
+ * @file search_test.c
+ * @author Domenic Melcher <e12220857@student.tuwien.ac.at>
+ * @date 17.10.2026
+ *
+ * @brief Compares every kernel of search.c against a plain search.
+ *
+ * @details mygrep itself only ever runs the fastest kernels the cpu
+ * supports, so the fallbacks are run here on purpose: 'search_limit_level'
+ * lowers the level before the kernels are picked. For every level random
+ * needles are searched in random haystacks, the results of 'search_find' are
+ * compared with a plain search that folds ASCII letters for '-i'. Needles
+ * cover the byte, packed, vector and Horspool kernels, haystacks are shorter
+ * than a vector as well as many vectors long with a tail. Every haystack ends
+ * exactly at the end of its allocation, so a kernel that reads past it is
+ * caught by a build with '-fsanitize=address'. 'search_is_binary' and
+ * 'search_count_newlines' are compared with plain loops as well.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/search.h"
+
+/**
+ * How many needles are searched per level.
+ */
+#define TEST_ROUNDS 20000
+
+/**
+ * Length of the longest needle, longer than 'SEARCH_HORSPOOL_MIN'.
+ */
+#define TEST_NEEDLE_MAX (SEARCH_HORSPOOL_MIN + 16)
+
+/**
+ * Length of the longest haystack.
+ */
+#define TEST_HAYSTACK_MAX (4 * 1024)
+
+/**
+ * State of the xorshift generator, the tests are the same on every run.
+ */
+static uint64_t test_state = 1;
+
+/**
+ * Returns a pseudo random number below bound.
+ */
+static unsigned long test_below(unsigned long bound) {
+  test_state ^= test_state << 13;
+  test_state ^= test_state >> 7;
+  test_state ^= test_state << 17;
+
+  return (unsigned long)(test_state % bound);
+}
+
+/**
+ * Picks a byte out of a small alphabet, so the needles actually occur. Some
+ * alphabets contain capitals, newlines, NUL and non ASCII bytes.
+ */
+static char test_byte(int alphabet) {
+  static const char *const ALPHABETS[] = {"ab", "abA", "aAbBcC\n",
+                                          "xyz\0\x80\xc3\xa4\xff"};
+  static const size_t LENGTHS[] = {2, 3, 7, 8};
+
+  return ALPHABETS[alphabet][test_below(LENGTHS[alphabet])];
+}
+
+/**
+ * Folds an ASCII byte to lowercase.
+ */
+static unsigned char test_fold(unsigned char c) {
+  return c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+}
+
+/**
+ * Plain search for the reference result.
+ * @param ignore_case 'true' if ASCII letters of the haystack are folded, the
+ * needle has to be folded already
+ */
+static const char *test_find(const char *haystack, size_t haystack_len,
+                             const char *needle, size_t needle_len,
+                             bool ignore_case) {
+  for (size_t i = 0; i + needle_len <= haystack_len; i += 1) {
+    size_t j = 0;
+    while (j < needle_len) {
+      unsigned char c = haystack[i + j];
+      if ((ignore_case ? test_fold(c) : c) != (unsigned char)needle[j]) {
+        break;
+      }
+      j += 1;
+    }
+    if (j == needle_len) {
+      return haystack + i;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Searches a random needle in a random haystack with the current kernels.
+ * @return Returns 0 if 'search_find' agrees with the reference.
+ */
+static int test_round(void) {
+  int alphabet = (int)test_below(4);
+  bool ignore_case = alphabet != 3 && test_below(2) == 0;
+
+  char needle[TEST_NEEDLE_MAX + 1];
+  size_t needle_len = 1 + test_below(TEST_NEEDLE_MAX);
+  for (size_t i = 0; i < needle_len; i += 1) {
+    needle[i] = test_byte(alphabet);
+    if (needle[i] == '\0') {
+      needle[i] = 'x';
+    }
+  }
+  needle[needle_len] = '\0';
+  if (ignore_case) {
+    search_fold(needle);
+  }
+
+  // mostly short haystacks, they hit the tails of the kernels
+  size_t haystack_len = test_below(4) == 0 ? test_below(TEST_HAYSTACK_MAX)
+                                           : test_below(3 * 64);
+  char *haystack = malloc(haystack_len > 0 ? haystack_len : 1);
+  if (haystack == NULL) {
+    return -1;
+  }
+  for (size_t i = 0; i < haystack_len; i += 1) {
+    haystack[i] = test_byte(alphabet);
+  }
+  if (haystack_len >= needle_len && test_below(2) == 0) {
+    // plant the needle, in the other case it still occurs by chance
+    size_t at = test_below(haystack_len - needle_len + 1);
+    memcpy(haystack + at, needle, needle_len);
+  }
+
+  search_t search;
+  search_init(&search, needle, ignore_case);
+
+  int result = 0;
+  // every start inside the first vector, so all alignments are covered
+  size_t skip = haystack_len > 0 ? test_below(haystack_len < 32 ? haystack_len
+                                                                 : 32)
+                                 : 0;
+  const char *start = haystack + skip;
+  size_t len = haystack_len - skip;
+
+  const char *found = search_find(&search, start, len);
+  const char *expected = test_find(start, len, needle, needle_len,
+                                   ignore_case);
+  if (found != expected) {
+    fprintf(stderr,
+            "search_find: needle of %zu bytes, haystack of %zu bytes, "
+            "ignore_case %d: found %ld, expected %ld\n",
+            needle_len, len, ignore_case,
+            found == NULL ? -1L : (long)(found - start),
+            expected == NULL ? -1L : (long)(expected - start));
+    result = -1;
+  }
+
+  size_t newlines = 0;
+  bool nul = false;
+  for (size_t i = 0; i < len; i += 1) {
+    newlines += start[i] == '\n';
+    nul = nul || start[i] == '\0';
+  }
+  if (search_count_newlines(start, len) != newlines) {
+    fprintf(stderr, "search_count_newlines: wrong count in %zu bytes\n", len);
+    result = -1;
+  }
+  if (alphabet != 3 && search_is_binary(start, len)) {
+    fprintf(stderr, "search_is_binary: ASCII text of %zu bytes\n", len);
+    result = -1;
+  }
+  if (nul && search_is_binary(start, len) == false) {
+    fprintf(stderr, "search_is_binary: missed a NUL in %zu bytes\n", len);
+    result = -1;
+  }
+
+  free(haystack);
+
+  return result;
+}
+
+/**
+ * Program entry point.
+ * @return Returns EXIT_SUCCESS if every kernel agrees with the reference.
+ */
+int main(void) {
+  static const char *const NAMES[] = {"scalar", "SSE2", "AVX2"};
+  const search_level_e levels[] = {E_SEARCH_SCALAR, E_SEARCH_SSE2,
+                                   E_SEARCH_AVX2};
+
+  for (size_t i = 0; i < sizeof(levels) / sizeof(levels[0]); i += 1) {
+    if (search_limit_level(levels[i]) != levels[i]) {
+      printf("%s: not supported by the cpu, skipped\n", NAMES[i]);
+      continue;
+    }
+
+    for (int round = 0; round < TEST_ROUNDS; round += 1) {
+      if (test_round() != 0) {
+        fprintf(stderr, "failed with the %s kernels\n", NAMES[i]);
+        return EXIT_FAILURE;
+      }
+    }
+    printf("%s: %d rounds passed\n", NAMES[i], TEST_ROUNDS);
+  }
+
+  return EXIT_SUCCESS;
+}